@@ -0,0 +1,71 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+MonotonicArena::MonotonicArena(size_t initial_size) : m_offset(0), m_next_size(std::max<size_t>(initial_size, 64)), m_allocated(0)
+{
+}
+
+MonotonicArena::~MonotonicArena()
+{
+	for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+		::operator delete(it->data);
+}
+
+void *MonotonicArena::allocate(size_t size, size_t alignment)
+{
+	if (!m_blocks.empty())
+	{
+		const Block &block = m_blocks.back();
+		const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+		const size_t offset = ((base + m_offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base;
+		if (offset <= block.size && size <= block.size - offset)
+		{
+			m_offset = offset + size;
+			m_allocated += size;
+			return block.data + offset;
+		}
+	}
+
+	// Blocks double, and are always large enough for the request and its alignment
+	const size_t block_size = std::max(m_next_size, size + alignment);
+	Block block;
+	block.data = static_cast<char *>(::operator new(block_size));
+	block.size = block_size;
+	m_blocks.push_back(block);
+	m_next_size = block_size * 2;
+
+	const uintptr_t base = reinterpret_cast<uintptr_t>(block.data);
+	const size_t offset = ((base + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base;
+	m_offset = offset + size;
+	m_allocated += size;
+	return block.data + offset;
+}
+
+void MonotonicArena::release()
+{
+	if (m_blocks.size() > 1)
+	{
+		Block block;
+		block.size = capacity();
+		block.data = static_cast<char *>(::operator new(block.size));
+
+		for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+			::operator delete(it->data);
+		m_blocks.assign(1, block);
+		m_next_size = block.size * 2;
+	}
+
+	m_offset = 0;
+	m_allocated = 0;
+}
+
+size_t MonotonicArena::capacity() const
+{
+	size_t ret = 0;
+	for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it)
+		ret += it->size;
+	return ret;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+
+// Monotonic arena for the data a pass builds and throws away as a whole, like
+// the per level data of the subdivision engines. Allocations bump a pointer,
+// frees do nothing, and release() drops everything at once. The toolset has no
+// std::pmr, so containers reach the arena through ArenaAllocator.
+
+///<summary>
+///Hands out memory from large blocks until released. Not thread safe: one
+///arena per thread, or allocations from a single thread.
+///</summary>
+class MonotonicArena
+{
+private:
+	struct Block
+	{
+		char *data;
+		size_t size;
+	};
+
+	std::vector<Block> m_blocks; // the current block is the last one
+	size_t m_offset; // first free byte of the current block
+	size_t m_next_size; // size of the next block to allocate
+	size_t m_allocated; // bytes handed out since the last release
+
+public:
+	explicit MonotonicArena(size_t initial_size = 1 << 16);
+	~MonotonicArena();
+
+	MonotonicArena(const MonotonicArena &) = delete;
+	MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+	///<summary>
+	///size bytes aligned on alignment, a power of two. Throws std::bad_alloc when
+	///no block can be allocated.
+	///</summary>
+	void *allocate(size_t size, size_t alignment);
+
+	///<summary>
+	///Invalidates everything allocated so far. The memory is kept for the next
+	///pass; blocks are merged into one so that pass bumps through a single block.
+	///</summary>
+	void release();
+
+	size_t bytesAllocated() const { return m_allocated; }
+
+	size_t capacity() const;
+};
+
+
+///<summary>
+///Standard allocator over a MonotonicArena. Without an arena it falls back to
+///operator new, so arena backed containers also work where no arena is given.
+///Allocators compare equal when they share the same arena.
+///</summary>
+template<typename T>
+class ArenaAllocator
+{
+private:
+	MonotonicArena *m_arena;
+
+public:
+	typedef T value_type;
+
+	// Moved and swapped containers keep the arena their memory came from
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef ArenaAllocator<U> other;
+	};
+
+	ArenaAllocator() : m_arena(nullptr) {}
+	explicit ArenaAllocator(MonotonicArena *arena) : m_arena(arena) {}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U> &a) : m_arena(a.arena()) {}
+
+	MonotonicArena *arena() const { return m_arena; }
+
+	T *allocate(size_t n)
+	{
+		if (n > static_cast<size_t>(-1) / sizeof(T))
+			throw std::bad_alloc();
+		if (!m_arena)
+			return static_cast<T *>(::operator new(n * sizeof(T)));
+		return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *p, size_t)
+	{
+		if (!m_arena)
+			::operator delete(p);
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena() == b.arena(); }
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena() != b.arena(); }
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
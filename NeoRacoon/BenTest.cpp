@@ -8,9 +8,37 @@
 #include "Loops.h"
 
 
+namespace bentest_internal
+{
+	// Each level is built, data and mesh, in the arena the level before it does
+	// not use; that one is released right after, so no level touches the heap.
+	template<typename SubdivideT>
+	RenderableMesh BenTest_subdivide(const Mesh &cube, int iters, MonotonicArena &even, MonotonicArena &odd, const char *name, SubdivideT subdivide)
+	{
+		MonotonicArena *arenas[2] = { &even, &odd };
+		even.release();
+		odd.release();
+
+		MeshArenaF level(cube, MeshArena::allocator(&even));
+		for (int i = 0; i < iters; i++)
+		{
+			AllocationScope scope(name);
+			level = subdivide(level, *arenas[(i + 1) % 2]);
+			arenas[i % 2]->release();
+		}
+
+		return level.getRenderableMesh();
+	}
+}
 
 
 RenderableMesh testCatMull(int iters)
+{
+	MonotonicArena even, odd;
+	return testCatMull(iters, even, odd);
+}
+
+RenderableMesh testCatMull(int iters, MonotonicArena &even, MonotonicArena &odd)
 {
 	Mesh cube;
 	cube.vertices.insert(cube.vertices.begin(), {
@@ -54,12 +82,7 @@ RenderableMesh testCatMull(int iters)
 		Face({ 1, 2, 5, 6 }, { 1, 10, 5, 9 }),
 	});
 
-	for (int i = 0; i < iters; i++)
-	{
-		cube = CatMull(cube);
-	}
-
-	return cube.getRenderableMesh();
+	return bentest_internal::BenTest_subdivide(cube, iters, even, odd, "CatMull", [](const MeshArenaF &mesh, MonotonicArena &arena) { return CatMull(mesh, arena); });
 
 	
 }
@@ -67,6 +90,12 @@ RenderableMesh testCatMull(int iters)
 
 
 RenderableMesh testLoops(int iters)
+{
+	MonotonicArena even, odd;
+	return testLoops(iters, even, odd);
+}
+
+RenderableMesh testLoops(int iters, MonotonicArena &even, MonotonicArena &odd)
 {
 	Mesh cube;
 	cube.vertices.insert(cube.vertices.begin(), {
@@ -128,16 +157,17 @@ RenderableMesh testLoops(int iters)
 		Face({ 1, 5, 6 },{ 16, 6, 11 }),
 	});
 
-	for (int i = 0; i < iters; i++)
-	{
-		cube = Loops(cube);
-	}
-
-	return cube.getRenderableMesh();
+	return bentest_internal::BenTest_subdivide(cube, iters, even, odd, "Loops", [](const MeshArenaF &mesh, MonotonicArena &arena) { return Loops(mesh, arena); });
 
 }
 
 RenderableMesh testKobbelt(int iters)
+{
+	MonotonicArena even, odd;
+	return testKobbelt(iters, even, odd);
+}
+
+RenderableMesh testKobbelt(int iters, MonotonicArena &even, MonotonicArena &odd)
 {
 	Mesh cube;
 	cube.vertices.insert(cube.vertices.begin(), {
@@ -199,11 +229,6 @@ RenderableMesh testKobbelt(int iters)
 		Face({ 1, 5, 6 },{ 16, 6, 11 }),
 	});
 
-	for (int i = 0; i < iters; i++)
-	{
-		cube = Kobbelt(cube);
-	}
-
-	return cube.getRenderableMesh();
+	return bentest_internal::BenTest_subdivide(cube, iters, even, odd, "Kobbelt", [](const MeshArenaF &mesh, MonotonicArena &arena) { return Kobbelt(mesh, arena); });
 
 }
@@ -7,4 +7,16 @@ RenderableMesh testCatMull(int);
 
 RenderableMesh testLoops(int);
 
-RenderableMesh testKobbelt(int);
\ No newline at end of file
+RenderableMesh testKobbelt(int);
+
+///<summary>
+///Same, with every level, mesh and data, allocated from even or odd in turn;
+///each arena is released once the level after the one it holds is built.
+///Callers that subdivide repeatedly keep both arenas so their blocks are
+///reused instead of reallocated.
+///</summary>
+RenderableMesh testCatMull(int, MonotonicArena &even, MonotonicArena &odd);
+
+RenderableMesh testLoops(int, MonotonicArena &even, MonotonicArena &odd);
+
+RenderableMesh testKobbelt(int, MonotonicArena &even, MonotonicArena &odd);
\ No newline at end of file
@@ -1,9 +1,16 @@
 #include "CatMull.h"
 
-CatMullData::CatMullData(const Mesh &mesh) :
-	used_edge_points(mesh.edges.size(), -1),
-	used_face_points(mesh.faces.size(), -1),
-	used_vertex_points(mesh.vertices.size(), -1)
+template<typename VertexT>
+template<typename MeshT>
+CatMullData<VertexT>::CatMullData(const MeshT &mesh, MonotonicArena *arena) :
+	edge_points(ArenaAllocator<VertexT>(arena)),
+	mid_points(ArenaAllocator<VertexT>(arena)),
+	face_points(ArenaAllocator<VertexT>(arena)),
+	vertex_points(ArenaAllocator<VertexT>(arena)),
+	used_edge_points(mesh.edges.size(), -1, ArenaAllocator<int>(arena)),
+	used_face_points(mesh.faces.size(), -1, ArenaAllocator<int>(arena)),
+	used_vertex_points(mesh.vertices.size(), -1, ArenaAllocator<int>(arena)),
+	adjacency(ArenaAllocator<int>(arena))
 {
 	edge_points.reserve(mesh.edges.size());
 	mid_points.reserve(mesh.edges.size());
@@ -14,7 +21,9 @@ CatMullData::CatMullData(const Mesh &mesh) :
 }
 
 
-void CatMullData::build(const Mesh &mesh)
+template<typename VertexT>
+template<typename MeshT>
+void CatMullData<VertexT>::build(const MeshT &mesh)
 {
 	for (int i = 0; i < mesh.edges.size(); ++i)
 	{
@@ -29,16 +38,18 @@ void CatMullData::build(const Mesh &mesh)
 		vertex_points.push_back(getVertexPoint(mesh, i));
 }
 
-Vertex CatMullData::getFaceCenter(const Mesh &mesh, int face_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT CatMullData<VertexT>::getFaceCenter(const MeshT &mesh, int face_id)
 {
 	if (face_id < 0 || face_id >= mesh.faces.size())
-		return Vertex();
+		return VertexT();
 
-	Vertex ret;
+	VertexT ret;
 
 	for (auto it = mesh.faces[face_id].vertices.begin(); it != mesh.faces[face_id].vertices.end(); ++it)
 	{
-		const Vertex &ref(mesh.vertices[*it]);
+		const VertexT &ref(mesh.vertices[*it]);
 		ret.x += ref.x;
 		ret.y += ref.y;
 		ret.z += ref.z;
@@ -53,26 +64,28 @@ Vertex CatMullData::getFaceCenter(const Mesh &mesh, int face_id)
 	return ret;
 }
 
-Vertex CatMullData::getEdgePoint(const Mesh &mesh, int edge_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT CatMullData<VertexT>::getEdgePoint(const MeshT &mesh, int edge_id)
 {
 	if (edge_id < 0 || edge_id >= mesh.edges.size())
-		return Vertex();
+		return VertexT();
 
 	const Edge &edge = mesh.edges[edge_id];
-	Vertex ret(mesh.vertices[edge.vertices[0]]);
+	VertexT ret(mesh.vertices[edge.vertices[0]]);
 	{
-		const Vertex &ref(mesh.vertices[edge.vertices[1]]);
+		const VertexT &ref(mesh.vertices[edge.vertices[1]]);
 		ret.x += ref.x;
 		ret.y += ref.y;
 		ret.z += ref.z;
 	}
 
 	size_t nb_points = 2;
-	auto edge_faces = mesh.getConnectedFacesToEdge(edge_id);
+	mesh.getConnectedFacesToEdge(edge_id, adjacency);
 
-	for (auto it = edge_faces.begin(); it != edge_faces.end(); ++it)
+	for (auto it = adjacency.begin(); it != adjacency.end(); ++it)
 	{
-		Vertex p = getFaceCenter(mesh, *it);
+		VertexT p = getFaceCenter(mesh, *it);
 		ret.x += p.x;
 		ret.y += p.y;
 		ret.z += p.z;
@@ -87,12 +100,14 @@ Vertex CatMullData::getEdgePoint(const Mesh &mesh, int edge_id)
 	return ret;
 }
 
-Vertex CatMullData::getEdgeMidPoint(const Mesh &mesh, int edge_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT CatMullData<VertexT>::getEdgeMidPoint(const MeshT &mesh, int edge_id)
 {
-	Vertex ret;
+	VertexT ret;
 	const Edge &ref(mesh.edges[edge_id]);
-	const Vertex &v0(mesh.vertices[ref.vertices[0]]);
-	const Vertex &v1(mesh.vertices[ref.vertices[1]]);
+	const VertexT &v0(mesh.vertices[ref.vertices[0]]);
+	const VertexT &v1(mesh.vertices[ref.vertices[1]]);
 
 	ret.x = 0.5f * v0.x + 0.5f * v1.x;
 	ret.y = 0.5f * v0.y + 0.5f * v1.y;
@@ -101,44 +116,48 @@ Vertex CatMullData::getEdgeMidPoint(const Mesh &mesh, int edge_id)
 	return ret;
 }
 
-Vertex CatMullData::getVertexPoint(const Mesh &mesh, int vert_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT CatMullData<VertexT>::getVertexPoint(const MeshT &mesh, int vert_id)
 {
-	Vertex ret;
-	Vertex Q; // moyenne des points de faces
-	Vertex R; // moyenne des points milieux des edges
-	Vertex v; // vertex courant
-	float n; // nombre d'edges incidents
+	typedef typename VertexT::value_type T;
+
+	VertexT ret;
+	VertexT Q; // moyenne des points de faces
+	VertexT R; // moyenne des points milieux des edges
+	VertexT v; // vertex courant
+	T n; // nombre d'edges incidents
 
 				// Compute R
 	{
-		auto edge_ids = mesh.getConnectedEdges(vert_id);
-		for (auto it = edge_ids.begin(); it != edge_ids.end(); ++it)
+		mesh.getConnectedEdges(vert_id, adjacency);
+		for (auto it = adjacency.begin(); it != adjacency.end(); ++it)
 		{
-			Vertex m = mid_points[*it];
+			VertexT m = mid_points[*it];
 			R.x += m.x;
 			R.y += m.y;
 			R.z += m.z;
 		}
 
-		n = static_cast<float>(edge_ids.size());
+		n = static_cast<T>(adjacency.size());
 
-		R.x *= 2.0f / pow(n, 2.0f);
-		R.y *= 2.0f / pow(n, 2.0f);
-		R.z *= 2.0f / pow(n, 2.0f);
+		R.x *= T(2) / pow(n, T(2));
+		R.y *= T(2) / pow(n, T(2));
+		R.z *= T(2) / pow(n, T(2));
 	}
 
 	// Compute Q
 	{
-		auto face_ids = mesh.getConnectedFaces(vert_id);
-		for (auto it = face_ids.begin(); it != face_ids.end(); ++it)
+		mesh.getConnectedFaces(vert_id, adjacency);
+		for (auto it = adjacency.begin(); it != adjacency.end(); ++it)
 		{
-			Vertex f = face_points[*it];
+			VertexT f = face_points[*it];
 			Q.x += f.x;
 			Q.y += f.y;
 			Q.z += f.z;
 		}
 
-		float f_n = static_cast<float>(face_ids.size());
+		T f_n = static_cast<T>(adjacency.size());
 
 		Q.x /= n * f_n;
 		Q.y /= n * f_n;
@@ -148,9 +167,9 @@ Vertex CatMullData::getVertexPoint(const Mesh &mesh, int vert_id)
 	// Compute v
 	{
 		v = mesh.vertices[vert_id];
-		v.x *= (n - 3.0f) / n;
-		v.y *= (n - 3.0f) / n;
-		v.z *= (n - 3.0f) / n;
+		v.x *= (n - T(3)) / n;
+		v.y *= (n - T(3)) / n;
+		v.z *= (n - T(3)) / n;
 	}
 
 
@@ -175,7 +194,8 @@ int catmull_internal::CatMull_get_vert_id(const Edge &edge0, const Edge &edge1)
 }
 
 
-void catmull_internal::CatMull_add_vertices(CatMullData &data, int edge0_id, int edge1_id, int vert_id, Mesh &out)
+template<typename MeshOutT>
+void catmull_internal::CatMull_add_vertices(CatMullData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, int vert_id, MeshOutT &out)
 {
 	if (data.used_edge_points[edge0_id] == -1)
 	{
@@ -201,7 +221,8 @@ void catmull_internal::CatMull_add_vertices(CatMullData &data, int edge0_id, int
 }
 
 
-void catmull_internal::CatMull_add_edge(CatMullData &data, int edgepoint0_id, int edgepoint1_id, int vert_id, Mesh &out)
+template<typename MeshOutT>
+void catmull_internal::CatMull_add_edge(CatMullData<typename MeshOutT::vertex_type> &data, int edgepoint0_id, int edgepoint1_id, int vert_id, MeshOutT &out)
 {
 	int facepoint_id = out.faces.back().vertices.front();
 	
@@ -247,19 +268,24 @@ void catmull_internal::CatMull_add_edge(CatMullData &data, int edgepoint0_id, in
 }
 
 
-void catmull_internal::CatMull_connect_edge(const Mesh &mesh, CatMullData &data, int edge0_id, int edge1_id, Mesh &out)
+template<typename MeshT, typename MeshOutT>
+void catmull_internal::CatMull_connect_edge(const MeshT &mesh, CatMullData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, MeshOutT &out)
 {
 	CatMull_add_vertices(data, edge0_id, edge1_id, CatMull_get_vert_id(mesh.edges[edge0_id], mesh.edges[edge1_id]), out);
-	const Face &face = out.faces.back();
+	const auto &face = out.faces.back();
 	int current_index = static_cast<int>(face.vertices.size());
 	CatMull_add_edge(data, face.vertices[current_index - 3], face.vertices[current_index - 1], face.vertices[current_index - 2], out);
 }
 
 
 
-void catmull_internal::CatMull_connect_face(const Mesh &mesh, CatMullData &data, int face_id, Mesh &out)
+template<typename MeshT, typename MeshOutT>
+void catmull_internal::CatMull_connect_face(const MeshT &mesh, CatMullData<typename MeshOutT::vertex_type> &data, int face_id, MeshOutT &out)
 {
-	out.faces.push_back(Face());
+	// Every new face is a quad: face point, edge point, vertex point, edge point
+	out.faces.push_back(out.makeFace());
+	out.faces.back().vertices.reserve(4);
+	out.faces.back().edges.reserve(4);
 	if (data.used_face_points[face_id] == -1)
 	{
 		out.vertices.push_back(data.face_points[face_id]);
@@ -271,23 +297,70 @@ void catmull_internal::CatMull_connect_face(const Mesh &mesh, CatMullData &data,
 	int facepoint_id = data.used_face_points[face_id];
 
 
-	const Face &face = mesh.faces[face_id];
+	const auto &face = mesh.faces[face_id];
 	CatMull_connect_edge(mesh, data, face.edges.back(), face.edges.front(), out);
 	for (int i = 0, imax = static_cast<int>(face.edges.size() - 1); i < imax; ++i)
 	{
-		out.faces.push_back(Face());
+		out.faces.push_back(out.makeFace());
+		out.faces.back().vertices.reserve(4);
+		out.faces.back().edges.reserve(4);
 		out.faces.back().vertices.push_back(facepoint_id);
 		CatMull_connect_edge(mesh, data, face.edges[i], face.edges[i + 1], out);
 	}
 }
 
-Mesh CatMull(const Mesh &mesh)
+template<typename MeshT>
+typename MeshT::mesh_type catmull_internal::CatMull_subdivide(const MeshT &mesh, MonotonicArena *arena)
 {
-	Mesh ret;
-	CatMullData cm_data(mesh);
+	typedef typename MeshT::mesh_type MeshOutT;
+	MeshOutT ret(MeshOutT::layout_type::allocator(arena));
+	CatMullData<typename MeshT::vertex_type> cm_data(mesh, arena);
+
+	// One quad per face corner, one new vertex per vertex, edge and face, two
+	// edges per old edge plus one per quad
+	size_t nb_corners = 0;
+	for (int i = 0; i < static_cast<int>(mesh.faces.size()); ++i)
+		nb_corners += mesh.faces[i].edges.size();
+	ret.faces.reserve(nb_corners);
+	ret.vertices.reserve(mesh.vertices.size() + mesh.edges.size() + mesh.faces.size());
+	ret.edges.reserve(mesh.edges.size() * 2 + nb_corners);
 
 	for (int i = 0; i < mesh.faces.size(); ++i)
-		catmull_internal::CatMull_connect_face(mesh, cm_data, i, ret);
+		CatMull_connect_face(mesh, cm_data, i, ret);
 
 	return ret;
 }
+
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> CatMull(const BasicMesh<T, LayoutT> &mesh)
+{
+	return catmull_internal::CatMull_subdivide(mesh, nullptr);
+}
+
+Mesh CatMull(const MeshView &mesh)
+{
+	return catmull_internal::CatMull_subdivide(mesh, nullptr);
+}
+
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> CatMull(const BasicMesh<T, LayoutT> &mesh, MonotonicArena &arena)
+{
+	return catmull_internal::CatMull_subdivide(mesh, &arena);
+}
+
+Mesh CatMull(const MeshView &mesh, MonotonicArena &arena)
+{
+	return catmull_internal::CatMull_subdivide(mesh, &arena);
+}
+
+
+template Mesh CatMull(const Mesh &mesh);
+template MeshD CatMull(const MeshD &mesh);
+template MeshSoAF CatMull(const MeshSoAF &mesh);
+template MeshSoAD CatMull(const MeshSoAD &mesh);
+template Mesh CatMull(const Mesh &mesh, MonotonicArena &arena);
+template MeshD CatMull(const MeshD &mesh, MonotonicArena &arena);
+template MeshSoAF CatMull(const MeshSoAF &mesh, MonotonicArena &arena);
+template MeshSoAD CatMull(const MeshSoAD &mesh, MonotonicArena &arena);
+template MeshArenaF CatMull(const MeshArenaF &mesh, MonotonicArena &arena);
+
@@ -1,32 +1,63 @@
 #pragma once
 
 #include "MeshUtils.h"
+#include "MeshView.h"
+#include "Arena.h"
 
+template<typename VertexT>
 struct CatMullData
 {
-	std::vector<Vertex> edge_points;
-	std::vector<Vertex> mid_points;
-	std::vector<Vertex> face_points;
-	std::vector<Vertex> vertex_points;
+	ArenaVector<VertexT> edge_points;
+	ArenaVector<VertexT> mid_points;
+	ArenaVector<VertexT> face_points;
+	ArenaVector<VertexT> vertex_points;
 	
-	std::vector<int> used_edge_points;
-	std::vector<int> used_face_points;
-	std::vector<int> used_vertex_points;
-
-
-	CatMullData(const Mesh &mesh);
+	ArenaVector<int> used_edge_points;
+	ArenaVector<int> used_face_points;
+	ArenaVector<int> used_vertex_points;
+
+	ArenaVector<int> adjacency; // result of the adjacency queries, reused by every vertex and edge
+
+
+	///<summary>
+	///Points of one level of mesh, allocated from arena when one is given.
+	///</summary>
+	template<typename MeshT>
+	CatMullData(const MeshT &mesh, MonotonicArena *arena = nullptr);
+
+	///<summary>
+	///Heap held by the points of one level, released when the level is done.
+	///</summary>
+	MemoryReport memoryUsage() const
+	{
+		MemoryReport ret;
+		ret.add("edge_points", vectorMemory(edge_points));
+		ret.add("mid_points", vectorMemory(mid_points));
+		ret.add("face_points", vectorMemory(face_points));
+		ret.add("vertex_points", vectorMemory(vertex_points));
+		ret.add("used_edge_points", vectorMemory(used_edge_points));
+		ret.add("used_face_points", vectorMemory(used_face_points));
+		ret.add("used_vertex_points", vectorMemory(used_vertex_points));
+		ret.add("adjacency", vectorMemory(adjacency));
+		return ret;
+	}
 
 
 	private:
-		void build(const Mesh &mesh);
+		template<typename MeshT>
+		void build(const MeshT &mesh);
 
-		Vertex getFaceCenter(const Mesh &mesh, int face_id);
+		template<typename MeshT>
+		VertexT getFaceCenter(const MeshT &mesh, int face_id);
 
-		Vertex getEdgePoint(const Mesh &mesh, int edge_id);
+		template<typename MeshT>
+		VertexT getEdgePoint(const MeshT &mesh, int edge_id);
 
-		Vertex getEdgeMidPoint(const Mesh &mesh, int edge_id);
+		template<typename MeshT>
+		VertexT getEdgeMidPoint(const MeshT &mesh, int edge_id);
 
-		Vertex getVertexPoint(const Mesh &mesh, int vert_id);
+		template<typename MeshT>
+		VertexT getVertexPoint(const MeshT &mesh, int vert_id);
 };
 
 
@@ -34,13 +65,38 @@ namespace catmull_internal
 {
 	int CatMull_get_vert_id(const Edge &edge0, const Edge &edge1);
 
-	void CatMull_add_vertices(CatMullData &data, int edge0_id, int edge1_id, int vert_id, Mesh &out);
+	template<typename MeshOutT>
+	void CatMull_add_vertices(CatMullData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, int vert_id, MeshOutT &out);
+
+	template<typename MeshOutT>
+	void CatMull_add_edge(CatMullData<typename MeshOutT::vertex_type> &data, int edgepoint0_id, int edgepoint1_id, int vert_id, MeshOutT &out);
 
-	void CatMull_add_edge(CatMullData &data, int edgepoint0_id, int edgepoint1_id, int vert_id, Mesh &out);
+	template<typename MeshT, typename MeshOutT>
+	void CatMull_connect_edge(const MeshT &mesh, CatMullData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, MeshOutT &out);
 
-	void CatMull_connect_edge(const Mesh &mesh, CatMullData &data, int edge0_id, int edge1_id, Mesh &out);
+	template<typename MeshT, typename MeshOutT>
+	void CatMull_connect_face(const MeshT &mesh, CatMullData<typename MeshOutT::vertex_type> &data, int face_id, MeshOutT &out);
 
-	void CatMull_connect_face(const Mesh &mesh, CatMullData &data, int face_id, Mesh &out);
+	template<typename MeshT>
+	typename MeshT::mesh_type CatMull_subdivide(const MeshT &mesh, MonotonicArena *arena);
 }
 
-Mesh CatMull(const Mesh &mesh);
\ No newline at end of file
+///<summary>
+///Instantiated for Mesh, MeshD, MeshSoAF and MeshSoAD, and MeshArenaF with an
+///arena below; the result keeps the precision and layout of mesh.
+///</summary>
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> CatMull(const BasicMesh<T, LayoutT> &mesh);
+
+Mesh CatMull(const MeshView &mesh);
+
+///<summary>
+///Same, with the points of the level and the adjacency query results allocated
+///from arena. A MeshArenaF result is allocated from arena too, so the whole
+///level lives there and the caller releases arena once the result is no longer
+///used; other layouts return a heap mesh and arena can be released right away.
+///</summary>
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> CatMull(const BasicMesh<T, LayoutT> &mesh, MonotonicArena &arena);
+
+Mesh CatMull(const MeshView &mesh, MonotonicArena &arena);
\ No newline at end of file
@@ -1,9 +1,15 @@
 #include "Chunk.h"
 
+#include <stdexcept>
+
+#include "MeshVoxelize.h"
+#include "Parallel.h"
+
 
 Chunk::Chunk(int size, glm::vec3 pos)
 {
 	this->size = size;
+	this->origin = pos;
 	voxels = std::vector<std::vector<std::vector<Voxel>>>();
 	for (int x = 0; x < size; x++)
 	{
@@ -31,48 +37,68 @@ void Chunk::setVisiblity(bool visibility)
 	visible = false;
 }
 
-std::vector<glm::vec3> Chunk::getVertices()
+namespace chunk_internal
 {
-	std::vector<glm::vec3> returnedVertices;
-	for (int x = 0; x < size; x++)
-	{		
-		for (int y = 0; y < size; y++)
-		{	
-			for (int z = 0; z < size; z++)
+	// Geometry of the visible voxels, appended to out in x, y, z order. Sizes are
+	// summed first so out grows once.
+	template<typename VectorT, typename GetT>
+	void Chunk_gather(const std::vector<std::vector<std::vector<Voxel>>> &voxels, GetT get, VectorT &out)
+	{
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			size_t count = 0;
+			for (auto x = voxels.begin(); x != voxels.end(); ++x)
 			{
-				if (voxels[x][y][z].visible)
+				for (auto y = x->begin(); y != x->end(); ++y)
 				{
-					std::vector<glm::vec3> v = voxels[x][y][z].getPoints();
-					returnedVertices.insert(returnedVertices.end(), v.begin(), v.end()); // voxels[x][y][z]
+					for (auto z = y->begin(); z != y->end(); ++z)
+					{
+						if (!z->visible)
+							continue;
+						const std::vector<glm::vec3> &part = ((*z).*get)();
+						if (pass == 0)
+							count += part.size();
+						else
+							out.insert(out.end(), part.begin(), part.end());
+					}
 				}
-				
 			}
+			if (pass == 0)
+				out.reserve(out.size() + count);
 		}
 	}
+}
+
+std::vector<glm::vec3> Chunk::getVertices()
+{
+	AllocationScope scope("Chunk meshing");
+	std::vector<glm::vec3> returnedVertices;
+	chunk_internal::Chunk_gather(voxels, &Voxel::getPoints, returnedVertices);
 	return returnedVertices;
 }
 
 std::vector<glm::vec3> Chunk::getNormals()
 {
 	std::vector<glm::vec3> returnedNormals;
-	for (int x = 0; x < size; x++)
-	{
-		for (int y = 0; y < size; y++)
-		{
-			for (int z = 0; z < size; z++)
-			{
-				if (voxels[x][y][z].visible)
-				{
-					std::vector<glm::vec3> v = voxels[x][y][z].getNormals();
-					returnedNormals.insert(returnedNormals.end(), v.begin(), v.end()); // voxels[x][y][z]
-				}
-
-			}
-		}
-	}
+	chunk_internal::Chunk_gather(voxels, &Voxel::getNormals, returnedNormals);
 	return returnedNormals;
 }
 
+ArenaVector<glm::vec3> Chunk::getVertices(MonotonicArena &arena) const
+{
+	AllocationScope scope("Chunk meshing");
+	ArenaVector<glm::vec3> ret((ArenaAllocator<glm::vec3>(&arena)));
+	chunk_internal::Chunk_gather(voxels, &Voxel::getPoints, ret);
+	return ret;
+}
+
+ArenaVector<glm::vec3> Chunk::getNormals(MonotonicArena &arena) const
+{
+	ArenaVector<glm::vec3> ret((ArenaAllocator<glm::vec3>(&arena)));
+	chunk_internal::Chunk_gather(voxels, &Voxel::getNormals, ret);
+	return ret;
+}
+
 std::vector<glm::vec3> Chunk::getPositions()
 {
 	return positions;
@@ -117,3 +143,51 @@ void Chunk::Spherize()
 		}
 	}
 }
+
+MemoryReport Chunk::memoryUsage() const
+{
+	MemoryUsage grid = vectorMemory(voxels), cubes;
+	for (auto x = voxels.begin(); x != voxels.end(); ++x)
+	{
+		grid += vectorMemory(*x);
+		for (auto y = x->begin(); y != x->end(); ++y)
+		{
+			grid += vectorMemory(*y);
+			for (auto z = y->begin(); z != y->end(); ++z)
+				cubes += z->memoryUsage();
+		}
+	}
+
+	MemoryReport ret;
+	ret.add("voxel grid", grid);
+	ret.add("voxel geometry", cubes);
+	ret.add("positions", vectorMemory(positions));
+	return ret;
+}
+
+void Chunk::setVoxels(const std::vector<uint8_t> &occupancy)
+{
+	if (occupancy.size() != static_cast<size_t>(size) * size * size)
+		throw std::invalid_argument("Chunk::setVoxels: occupancy must hold size^3 voxels");
+
+	// Every block owns whole x planes of voxels
+	parallel::parallelFor(0, size, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t x = first; x < last; x++)
+		{
+			for (int y = 0; y < size; y++)
+			{
+				const uint8_t *row = occupancy.data() + static_cast<size_t>(y) * size + x;
+				for (int z = 0; z < size; z++)
+					voxels[x][y][z].visible = row[static_cast<size_t>(z) * size * size] != 0;
+			}
+		}
+	}, 1);
+}
+
+void Chunk::voxelize(const Mesh &mesh, bool solid)
+{
+	VoxelGrid grid(origin - glm::vec3(0.5f), 1.0f, size, size, size);
+	voxelizeMesh(mesh, grid, solid);
+	setVoxels(grid.voxels);
+}
@@ -1,13 +1,17 @@
 #pragma once
 #include <vector>
+#include <cstdint>
 #include "Voxel.h"
 #include "glm.hpp"
+#include "MeshUtils.h"
+#include "Arena.h"
 
 class Chunk
 {
 private:
 	bool visible;
 	int size;
+	glm::vec3 origin;
 	std::vector<glm::vec3> positions;
 
 public:
@@ -23,9 +27,40 @@ public:
 	bool getVisibility() { return visible; }
 	std::vector<glm::vec3> getVertices();
 	std::vector<glm::vec3> getNormals();
+
+	///<summary>
+	///Same, in buffers allocated from arena, for meshing passes that upload
+	///the buffers and drop them. The caller releases arena afterwards.
+	///</summary>
+	ArenaVector<glm::vec3> getVertices(MonotonicArena &arena) const;
+	ArenaVector<glm::vec3> getNormals(MonotonicArena &arena) const;
 	std::vector<glm::vec3> getPositions();
 	void deleteRandomVoxels(float probability);
 	void Spherize();
 
+	int getSize() const { return size; }
+	///<summary>
+	///Position of voxel (0, 0, 0). Voxels are unit cubes centered on their position.
+	///</summary>
+	glm::vec3 getOrigin() const { return origin; }
+
+	///<summary>
+	///Sets the visibility of every voxel at once from size^3 bytes, x fastest
+	///(the VoxelGrid order), non zero for visible.
+	///</summary>
+	void setVoxels(const std::vector<uint8_t> &occupancy);
+
+	///<summary>
+	///Shows the voxels covered by mesh, given in the same space as the voxel
+	///positions: its surface, and its inside too with solid. Hides the others.
+	///</summary>
+	void voxelize(const Mesh &mesh, bool solid = true);
+
+	///<summary>
+	///Heap held by the chunk. Every voxel keeps its own cube geometry, which
+	///"voxel geometry" sums up.
+	///</summary>
+	MemoryReport memoryUsage() const;
+
 };
 
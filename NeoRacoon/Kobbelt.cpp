@@ -4,9 +4,15 @@
 #define M___PI 3.14159265358979323846
 #endif
 
-KobbeltData::KobbeltData(const Mesh &mesh) :
-	used_face_points(mesh.faces.size(), -1),
-	used_vertex_points(mesh.vertices.size(), -1)
+template<typename VertexT>
+template<typename MeshT>
+KobbeltData<VertexT>::KobbeltData(const MeshT &mesh, MonotonicArena *arena) :
+	face_points(ArenaAllocator<VertexT>(arena)),
+	vertex_points(ArenaAllocator<VertexT>(arena)),
+	used_face_points(mesh.faces.size(), -1, ArenaAllocator<int>(arena)),
+	used_vertex_points(mesh.vertices.size(), -1, ArenaAllocator<int>(arena)),
+	adjacency(ArenaAllocator<int>(arena)),
+	adjacency_faces(ArenaAllocator<int>(arena))
 {
 	face_points.reserve(mesh.faces.size());
 	vertex_points.reserve(mesh.vertices.size());
@@ -16,7 +22,9 @@ KobbeltData::KobbeltData(const Mesh &mesh) :
 
 
 
-void KobbeltData::build(const Mesh &mesh)
+template<typename VertexT>
+template<typename MeshT>
+void KobbeltData<VertexT>::build(const MeshT &mesh)
 {
 	for (int i = 0; i < mesh.faces.size(); ++i)
 		face_points.push_back(getFaceCenter(mesh, i));
@@ -26,16 +34,18 @@ void KobbeltData::build(const Mesh &mesh)
 }
 
 
-Vertex KobbeltData::getFaceCenter(const Mesh &mesh, int face_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT KobbeltData<VertexT>::getFaceCenter(const MeshT &mesh, int face_id)
 {
 	if (face_id < 0 || face_id >= mesh.faces.size())
-		return Vertex();
+		return VertexT();
 
-	Vertex ret;
+	VertexT ret;
 
 	for (auto it = mesh.faces[face_id].vertices.begin(); it != mesh.faces[face_id].vertices.end(); ++it)
 	{
-		const Vertex &ref(mesh.vertices[*it]);
+		const VertexT &ref(mesh.vertices[*it]);
 		ret.x += ref.x;
 		ret.y += ref.y;
 		ret.z += ref.z;
@@ -53,20 +63,24 @@ Vertex KobbeltData::getFaceCenter(const Mesh &mesh, int face_id)
 
 
 
-Vertex KobbeltData::getVertexPoint(const Mesh &mesh, int vert_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT KobbeltData<VertexT>::getVertexPoint(const MeshT &mesh, int vert_id)
 {
-	const Vertex &v = mesh.vertices[vert_id];
+	typedef typename VertexT::value_type T;
 
-	auto v_ids = mesh.getConnectedVertices(vert_id);
-	float n = v_ids.size();
-	float alpha = kobbelt_internal::Kobbelt_getAlpha(n);
-	float n_alpha = 1 - alpha;
+	const VertexT &v = mesh.vertices[vert_id];
 
-	Vertex ret(n_alpha * v.x, n_alpha * v.y, n_alpha * v.z);
-	Vertex vs;
-	for (size_t i = 0; i < n; ++i)
+	mesh.getConnectedVertices(vert_id, adjacency);
+	T n = static_cast<T>(adjacency.size());
+	T alpha = kobbelt_internal::Kobbelt_getAlpha<T>(adjacency.size());
+	T n_alpha = 1 - alpha;
+
+	VertexT ret(n_alpha * v.x, n_alpha * v.y, n_alpha * v.z);
+	VertexT vs;
+	for (size_t i = 0; i < adjacency.size(); ++i)
 	{
-		const Vertex &v_i = mesh.vertices[v_ids[i]];
+		const VertexT &v_i = mesh.vertices[adjacency[i]];
 		vs.x += v_i.x;
 		vs.y += v_i.y;
 		vs.z += v_i.z;
@@ -84,17 +98,21 @@ Vertex KobbeltData::getVertexPoint(const Mesh &mesh, int vert_id)
 
 
 
-float kobbelt_internal::Kobbelt_getAlpha(size_t n)
+template<typename T>
+T kobbelt_internal::Kobbelt_getAlpha(size_t n)
 {
-	return 1.0f / 9.0f * (4.0f - (2.0f * cos((2.0f * M___PI) / n)));
+	return static_cast<T>(1.0 / 9.0 * (4.0 - (2.0 * cos((2.0 * M___PI) / n))));
 }
 
 
 
 
-void kobbelt_internal::Kobbelt_connect_face(const Mesh &mesh, KobbeltData &data, int vert_id, Mesh &out)
+template<typename MeshT, typename MeshOutT>
+void kobbelt_internal::Kobbelt_connect_face(const MeshT &mesh, KobbeltData<typename MeshOutT::vertex_type> &data, int vert_id, MeshOutT &out)
 {
-	auto edge_ids = mesh.getConnectedEdges(vert_id);
+	ArenaVector<int> &edge_ids = data.adjacency;
+	ArenaVector<int> &face_ids = data.adjacency_faces;
+	mesh.getConnectedEdges(vert_id, edge_ids);
 
 	if (data.used_vertex_points[vert_id] == -1)
 	{
@@ -105,8 +123,10 @@ void kobbelt_internal::Kobbelt_connect_face(const Mesh &mesh, KobbeltData &data,
 
 	for (size_t i = 0; i < edge_ids.size(); ++i)
 	{
-		auto face_ids = mesh.getConnectedFacesToEdge(vert_id);
-		Face f;
+		mesh.getConnectedFacesToEdge(vert_id, face_ids);
+		auto f = out.makeFace();
+		f.vertices.reserve(face_ids.size() + 1);
+		f.edges.reserve(face_ids.size() + 1);
 		f.vertices.push_back(v);
 		for (size_t j = 0; j < face_ids.size(); ++j)
 		{
@@ -138,18 +158,58 @@ void kobbelt_internal::Kobbelt_connect_face(const Mesh &mesh, KobbeltData &data,
 		else
 			f.edges.push_back(e_id);
 
-		out.faces.push_back(f);
+		out.faces.push_back(std::move(f));
 	}
 }
 
-Mesh Kobbelt(const Mesh &mesh)
+template<typename MeshT>
+typename MeshT::mesh_type kobbelt_internal::Kobbelt_subdivide(const MeshT &mesh, MonotonicArena *arena)
 {
-	Mesh ret;
-	KobbeltData cm_data(mesh);
+	typedef typename MeshT::mesh_type MeshOutT;
+	MeshOutT ret(MeshOutT::layout_type::allocator(arena));
+	KobbeltData<typename MeshT::vertex_type> cm_data(mesh, arena);
+
+	// One face per vertex and connected edge, one new vertex per vertex and face
+	ret.faces.reserve(mesh.edges.size() * 2);
+	ret.vertices.reserve(mesh.vertices.size() + mesh.faces.size());
 
 	for (int i = 0; i < mesh.vertices.size(); ++i)
-		kobbelt_internal::Kobbelt_connect_face(mesh, cm_data, i, ret);
+		Kobbelt_connect_face(mesh, cm_data, i, ret);
 
 	return ret;
 }
 
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Kobbelt(const BasicMesh<T, LayoutT> &mesh)
+{
+	return kobbelt_internal::Kobbelt_subdivide(mesh, nullptr);
+}
+
+Mesh Kobbelt(const MeshView &mesh)
+{
+	return kobbelt_internal::Kobbelt_subdivide(mesh, nullptr);
+}
+
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Kobbelt(const BasicMesh<T, LayoutT> &mesh, MonotonicArena &arena)
+{
+	return kobbelt_internal::Kobbelt_subdivide(mesh, &arena);
+}
+
+Mesh Kobbelt(const MeshView &mesh, MonotonicArena &arena)
+{
+	return kobbelt_internal::Kobbelt_subdivide(mesh, &arena);
+}
+
+
+template Mesh Kobbelt(const Mesh &mesh);
+template MeshD Kobbelt(const MeshD &mesh);
+template MeshSoAF Kobbelt(const MeshSoAF &mesh);
+template MeshSoAD Kobbelt(const MeshSoAD &mesh);
+template Mesh Kobbelt(const Mesh &mesh, MonotonicArena &arena);
+template MeshD Kobbelt(const MeshD &mesh, MonotonicArena &arena);
+template MeshSoAF Kobbelt(const MeshSoAF &mesh, MonotonicArena &arena);
+template MeshSoAD Kobbelt(const MeshSoAD &mesh, MonotonicArena &arena);
+template MeshArenaF Kobbelt(const MeshArenaF &mesh, MonotonicArena &arena);
+
+
@@ -4,43 +4,98 @@
 #pragma once
 
 #include "MeshUtils.h"
+#include "MeshView.h"
+#include "Arena.h"
 
+template<typename VertexT>
 struct KobbeltData
 {
-	std::vector<Vertex> face_points;
-	std::vector<Vertex> vertex_points;
-
-	std::vector<int> used_face_points;
-	std::vector<int> used_vertex_points;
-
-
-	KobbeltData(const Mesh &mesh);
+	ArenaVector<VertexT> face_points;
+	ArenaVector<VertexT> vertex_points;
+
+	ArenaVector<int> used_face_points;
+	ArenaVector<int> used_vertex_points;
+
+	// Results of the adjacency queries, reused by every vertex
+	ArenaVector<int> adjacency;
+	ArenaVector<int> adjacency_faces;
+
+
+	///<summary>
+	///Points of one level of mesh, allocated from arena when one is given.
+	///</summary>
+	template<typename MeshT>
+	KobbeltData(const MeshT &mesh, MonotonicArena *arena = nullptr);
+
+	///<summary>
+	///Heap held by the points of one level, released when the level is done.
+	///</summary>
+	MemoryReport memoryUsage() const
+	{
+		MemoryReport ret;
+		ret.add("face_points", vectorMemory(face_points));
+		ret.add("vertex_points", vectorMemory(vertex_points));
+		ret.add("used_face_points", vectorMemory(used_face_points));
+		ret.add("used_vertex_points", vectorMemory(used_vertex_points));
+		ret.add("adjacency", vectorMemory(adjacency));
+		ret.add("adjacency_faces", vectorMemory(adjacency_faces));
+		return ret;
+	}
 
 
 private:
-	void build(const Mesh &mesh);
+	template<typename MeshT>
+	void build(const MeshT &mesh);
 
-	Vertex getFaceCenter(const Mesh &mesh, int edge_id);
+	template<typename MeshT>
+	VertexT getFaceCenter(const MeshT &mesh, int edge_id);
 
-	Vertex getVertexPoint(const Mesh &mesh, int vert_id);
+	template<typename MeshT>
+	VertexT getVertexPoint(const MeshT &mesh, int vert_id);
 };
 
 
 
 namespace kobbelt_internal
 {
-	float Kobbelt_getAlpha(size_t n);
+	template<typename T>
+	T Kobbelt_getAlpha(size_t n);
 
 	int Kobbelt_get_vert_id(const Edge &edge0, const Edge &edge1);
 
-	void Kobbelt_add_vertices(KobbeltData &data, int edge0_id, int edge1_id, int vert_id, Mesh &out);
+	template<typename MeshOutT>
+	void Kobbelt_add_vertices(KobbeltData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, int vert_id, MeshOutT &out);
+
+	template<typename MeshOutT>
+	void Kobbelt_add_edge(KobbeltData<typename MeshOutT::vertex_type> &data, int edgepoint0_id, int edgepoint1_id, int vert_id, MeshOutT &out);
 
-	void Kobbelt_add_edge(KobbeltData &data, int edgepoint0_id, int edgepoint1_id, int vert_id, Mesh &out);
+	template<typename MeshT, typename MeshOutT>
+	void Kobbelt_connect_edge(const MeshT &mesh, KobbeltData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, MeshOutT &out);
 
-	void Kobbelt_connect_edge(const Mesh &mesh, KobbeltData &data, int edge0_id, int edge1_id, Mesh &out);
+	template<typename MeshT, typename MeshOutT>
+	void Kobbelt_connect_face(const MeshT &mesh, KobbeltData<typename MeshOutT::vertex_type> &data, int face_id, MeshOutT &out);
 
-	void Kobbelt_connect_face(const Mesh &mesh, KobbeltData &data, int face_id, Mesh &out);
+	template<typename MeshT>
+	typename MeshT::mesh_type Kobbelt_subdivide(const MeshT &mesh, MonotonicArena *arena);
 }
 
-Mesh Kobbelt(const Mesh &mesh);
+///<summary>
+///Instantiated for Mesh, MeshD, MeshSoAF and MeshSoAD, and MeshArenaF with an
+///arena below; the result keeps the precision and layout of mesh.
+///</summary>
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Kobbelt(const BasicMesh<T, LayoutT> &mesh);
+
+Mesh Kobbelt(const MeshView &mesh);
+
+///<summary>
+///Same, with the points of the level and the adjacency query results allocated
+///from arena. A MeshArenaF result is allocated from arena too, so the whole
+///level lives there and the caller releases arena once the result is no longer
+///used; other layouts return a heap mesh and arena can be released right away.
+///</summary>
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Kobbelt(const BasicMesh<T, LayoutT> &mesh, MonotonicArena &arena);
+
+Mesh Kobbelt(const MeshView &mesh, MonotonicArena &arena);
 
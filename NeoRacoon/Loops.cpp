@@ -5,9 +5,14 @@
 #endif
 
 
-LoopsData::LoopsData(const Mesh &mesh) :
-	used_edge_points(mesh.edges.size(), -1),
-	used_vertex_points(mesh.vertices.size(), -1)
+template<typename VertexT>
+template<typename MeshT>
+LoopsData<VertexT>::LoopsData(const MeshT &mesh, MonotonicArena *arena) :
+	edge_points(ArenaAllocator<VertexT>(arena)),
+	vertex_points(ArenaAllocator<VertexT>(arena)),
+	used_edge_points(mesh.edges.size(), -1, ArenaAllocator<int>(arena)),
+	used_vertex_points(mesh.vertices.size(), -1, ArenaAllocator<int>(arena)),
+	adjacency(ArenaAllocator<int>(arena))
 {
 	edge_points.reserve(mesh.edges.size());
 	vertex_points.reserve(mesh.vertices.size());
@@ -17,7 +22,9 @@ LoopsData::LoopsData(const Mesh &mesh) :
 
 
 
-void LoopsData::build(const Mesh &mesh)
+template<typename VertexT>
+template<typename MeshT>
+void LoopsData<VertexT>::build(const MeshT &mesh)
 {
 	for (int i = 0; i < static_cast<int>(mesh.vertices.size()); ++i)
 		vertex_points.push_back(getVertexPoint(mesh, i));
@@ -26,43 +33,43 @@ void LoopsData::build(const Mesh &mesh)
 		edge_points.push_back(getEdgePoint(mesh, i));
 }
 
-Vertex LoopsData::getEdgePoint(const Mesh &mesh, int edge_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT LoopsData<VertexT>::getEdgePoint(const MeshT &mesh, int edge_id)
 {
 	if (edge_id < 0 || edge_id >= mesh.edges.size())
-		return Vertex();
+		return VertexT();
 
-	Vertex ret;
+	typedef typename VertexT::value_type T;
+
+	VertexT ret;
 	int v1_id = mesh.edges[edge_id].vertices[0], v2_id = mesh.edges[edge_id].vertices[1];
-	const Vertex &v1(mesh.vertices[v1_id]), &v2(mesh.vertices[v2_id]);
-	auto face_ids = mesh.getConnectedFacesToEdge(edge_id);
-	std::vector<int> v_ids;
-	for (size_t i = 0; i < face_ids.size(); ++i)
+	const VertexT &v1(mesh.vertices[v1_id]), &v2(mesh.vertices[v2_id]);
+	mesh.getConnectedFacesToEdge(edge_id, adjacency);
+
+	// Vertex opposite the edge in each of its faces
+	VertexT v1v2(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z);
+	VertexT v_other;
+	for (size_t i = 0; i < adjacency.size(); ++i)
 	{
-		const Face &face = mesh.faces[face_ids[i]];
+		const auto &face = mesh.faces[adjacency[i]];
 		auto it = std::find_if(face.vertices.begin(), face.vertices.end(), [v1_id, v2_id](int v_id) { return v_id != v1_id && v_id != v2_id; });
 		if (it == face.vertices.end())
 			continue;
 
-		v_ids.push_back(*it);
-	}
-
-	Vertex v1v2(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z);
-	Vertex v_other;
-	for (auto it = v_ids.begin(); it != v_ids.end(); ++it)
-	{
-		const Vertex &v = mesh.vertices[*it];
+		const VertexT &v = mesh.vertices[*it];
 		v_other.x += v.x;
 		v_other.y += v.y;
 		v_other.z += v.z;
 	}
 
-	v_other.x /= 8.0f;
-	v_other.y /= 8.0f;
-	v_other.z /= 8.0f;
+	v_other.x /= T(8);
+	v_other.y /= T(8);
+	v_other.z /= T(8);
 
-	v1v2.x *= 3.0f / 8.0f;
-	v1v2.y *= 3.0f / 8.0f;
-	v1v2.z *= 3.0f / 8.0f;
+	v1v2.x *= T(3) / T(8);
+	v1v2.y *= T(3) / T(8);
+	v1v2.z *= T(3) / T(8);
 
 	ret.x = v_other.x + v1v2.x;
 	ret.y = v_other.y + v1v2.y;
@@ -71,18 +78,22 @@ Vertex LoopsData::getEdgePoint(const Mesh &mesh, int edge_id)
 	return ret;
 }
 
-Vertex LoopsData::getVertexPoint(const Mesh &mesh, int vert_id)
+template<typename VertexT>
+template<typename MeshT>
+VertexT LoopsData<VertexT>::getVertexPoint(const MeshT &mesh, int vert_id)
 {
-	const Vertex &v = mesh.vertices[vert_id];
+	typedef typename VertexT::value_type T;
+
+	const VertexT &v = mesh.vertices[vert_id];
 
-	auto v_ids = mesh.getConnectedVertices(vert_id);
-	float alpha = loops_internal::Loops_getAlpha(v_ids.size());
-	float n_alpha = 1 - (v_ids.size() * alpha);
+	mesh.getConnectedVertices(vert_id, adjacency);
+	T alpha = loops_internal::Loops_getAlpha<T>(adjacency.size());
+	T n_alpha = 1 - (adjacency.size() * alpha);
 
-	Vertex ret(n_alpha * v.x, n_alpha * v.y, n_alpha * v.z);
-	for (size_t i = 0; i < v_ids.size(); ++i)
+	VertexT ret(n_alpha * v.x, n_alpha * v.y, n_alpha * v.z);
+	for (size_t i = 0; i < adjacency.size(); ++i)
 	{
-		const Vertex &v_i = mesh.vertices[v_ids[i]];
+		const VertexT &v_i = mesh.vertices[adjacency[i]];
 		ret.x += alpha * v_i.x;
 		ret.y += alpha * v_i.y;
 		ret.z += alpha * v_i.z;
@@ -96,12 +107,13 @@ Vertex LoopsData::getVertexPoint(const Mesh &mesh, int vert_id)
 
 
 
-float loops_internal::Loops_getAlpha(size_t n)
+template<typename T>
+T loops_internal::Loops_getAlpha(size_t n)
 {
 	if (n == 3)
-		return 3.0f / 16.0f;
+		return T(3) / T(16);
 
-	return 1.0f / n * (5.0f / 8.0f - pow(3.0f / 8.0f + (1.0f / 4.0f * cos((2.0f * M___PI) / n)), 2.0f));
+	return static_cast<T>(1.0 / n * (5.0 / 8.0 - pow(3.0 / 8.0 + (1.0 / 4.0 * cos((2.0 * M___PI) / n)), 2.0)));
 }
 
 
@@ -118,7 +130,8 @@ int loops_internal::Loops_get_vert_id(const Edge &edge0, const Edge &edge1)
 }
 
 
-void loops_internal::Loops_add_vertices(LoopsData &data, int edge0_id, int edge1_id, int vert_id, Mesh &out)
+template<typename MeshOutT>
+void loops_internal::Loops_add_vertices(LoopsData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, int vert_id, MeshOutT &out)
 {
 	if (data.used_edge_points[edge0_id] == -1)
 	{
@@ -144,7 +157,8 @@ void loops_internal::Loops_add_vertices(LoopsData &data, int edge0_id, int edge1
 }
 
 
-void loops_internal::Loops_add_edge(LoopsData &data, int edgepoint0_id, int edgepoint1_id, int vert_id, Mesh &out)
+template<typename MeshOutT>
+void loops_internal::Loops_add_edge(LoopsData<typename MeshOutT::vertex_type> &data, int edgepoint0_id, int edgepoint1_id, int vert_id, MeshOutT &out)
 {
 	int facepoint_id = out.faces.back().vertices.front();
 
@@ -180,29 +194,37 @@ void loops_internal::Loops_add_edge(LoopsData &data, int edgepoint0_id, int edge
 }
 
 
-void loops_internal::Loops_connect_edge(const Mesh &mesh, LoopsData &data, int edge0_id, int edge1_id, Mesh &out)
+template<typename MeshT, typename MeshOutT>
+void loops_internal::Loops_connect_edge(const MeshT &mesh, LoopsData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, MeshOutT &out)
 {
 	Loops_add_vertices(data, edge0_id, edge1_id, Loops_get_vert_id(mesh.edges[edge0_id], mesh.edges[edge1_id]), out);
-	const Face &face = out.faces.back();
+	const auto &face = out.faces.back();
 	int current_index = static_cast<int>(face.vertices.size());
 	Loops_add_edge(data, face.vertices[current_index - 3], face.vertices[current_index - 1], face.vertices[current_index - 2], out);
 }
 
 
 
-void loops_internal::Loops_connect_face(const Mesh &mesh, LoopsData &data, int face_id, Mesh &out)
+template<typename MeshT, typename MeshOutT>
+void loops_internal::Loops_connect_face(const MeshT &mesh, LoopsData<typename MeshOutT::vertex_type> &data, int face_id, MeshOutT &out)
 {
-	out.faces.push_back(Face());
+	// Corner triangles: edge point, vertex point, edge point
+	out.faces.push_back(out.makeFace());
+	out.faces.back().vertices.reserve(3);
+	out.faces.back().edges.reserve(3);
 
-	const Face &face = mesh.faces[face_id];
+	const auto &face = mesh.faces[face_id];
 	Loops_connect_edge(mesh, data, face.edges.back(), face.edges.front(), out);
 	for (int i = 0, imax = static_cast<int>(face.edges.size() - 1); i < imax; ++i)
 	{
-		out.faces.push_back(Face());
+		out.faces.push_back(out.makeFace());
+		out.faces.back().vertices.reserve(3);
+		out.faces.back().edges.reserve(3);
 		Loops_connect_edge(mesh, data, face.edges[i], face.edges[i + 1], out);
 	}
 
-	Face edge_face;
+	auto edge_face = out.makeFace();
+	edge_face.edges.reserve(face.edges.size());
 	Edge e(data.used_edge_points[face.edges.back()], data.used_edge_points[face.edges.front()]);
 	int e_id = out.getEdgeId(e);
 	if (e_id < 0)
@@ -226,16 +248,61 @@ void loops_internal::Loops_connect_face(const Mesh &mesh, LoopsData &data, int f
 			edge_face.edges.push_back(e_id);
 	}
 
-	out.faces.push_back(edge_face);
+	out.faces.push_back(std::move(edge_face));
 }
 
-Mesh Loops(const Mesh &mesh)
+template<typename MeshT>
+typename MeshT::mesh_type loops_internal::Loops_subdivide(const MeshT &mesh, MonotonicArena *arena)
 {
-	Mesh ret;
-	LoopsData cm_data(mesh);
+	typedef typename MeshT::mesh_type MeshOutT;
+	MeshOutT ret(MeshOutT::layout_type::allocator(arena));
+	LoopsData<typename MeshT::vertex_type> cm_data(mesh, arena);
+
+	// One triangle per face corner plus the middle one, one new vertex per vertex
+	// and edge, two edges per old edge plus the ones inside the faces
+	size_t nb_corners = 0;
+	for (int i = 0; i < static_cast<int>(mesh.faces.size()); ++i)
+		nb_corners += mesh.faces[i].edges.size();
+	ret.faces.reserve(nb_corners + mesh.faces.size());
+	ret.vertices.reserve(mesh.vertices.size() + mesh.edges.size());
+	ret.edges.reserve(mesh.edges.size() * 2 + nb_corners);
 
 	for (int i = 0; i < mesh.faces.size(); ++i)
-		loops_internal::Loops_connect_face(mesh, cm_data, i, ret);
+		Loops_connect_face(mesh, cm_data, i, ret);
 
 	return ret;
 }
+
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Loops(const BasicMesh<T, LayoutT> &mesh)
+{
+	return loops_internal::Loops_subdivide(mesh, nullptr);
+}
+
+Mesh Loops(const MeshView &mesh)
+{
+	return loops_internal::Loops_subdivide(mesh, nullptr);
+}
+
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Loops(const BasicMesh<T, LayoutT> &mesh, MonotonicArena &arena)
+{
+	return loops_internal::Loops_subdivide(mesh, &arena);
+}
+
+Mesh Loops(const MeshView &mesh, MonotonicArena &arena)
+{
+	return loops_internal::Loops_subdivide(mesh, &arena);
+}
+
+
+template Mesh Loops(const Mesh &mesh);
+template MeshD Loops(const MeshD &mesh);
+template MeshSoAF Loops(const MeshSoAF &mesh);
+template MeshSoAD Loops(const MeshSoAD &mesh);
+template Mesh Loops(const Mesh &mesh, MonotonicArena &arena);
+template MeshD Loops(const MeshD &mesh, MonotonicArena &arena);
+template MeshSoAF Loops(const MeshSoAF &mesh, MonotonicArena &arena);
+template MeshSoAD Loops(const MeshSoAD &mesh, MonotonicArena &arena);
+template MeshArenaF Loops(const MeshArenaF &mesh, MonotonicArena &arena);
+
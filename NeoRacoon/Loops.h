@@ -1,42 +1,94 @@
 #pragma once
 
 #include "MeshUtils.h"
+#include "MeshView.h"
+#include "Arena.h"
 
+template<typename VertexT>
 struct LoopsData
 {
-	std::vector<Vertex> edge_points;
-	std::vector<Vertex> vertex_points;
+	ArenaVector<VertexT> edge_points;
+	ArenaVector<VertexT> vertex_points;
 
-	std::vector<int> used_edge_points;
-	std::vector<int> used_vertex_points;
+	ArenaVector<int> used_edge_points;
+	ArenaVector<int> used_vertex_points;
 
+	ArenaVector<int> adjacency; // result of the adjacency queries, reused by every vertex and edge
 
-	LoopsData(const Mesh &mesh);
+
+	///<summary>
+	///Points of one level of mesh, allocated from arena when one is given.
+	///</summary>
+	template<typename MeshT>
+	LoopsData(const MeshT &mesh, MonotonicArena *arena = nullptr);
+
+	///<summary>
+	///Heap held by the points of one level, released when the level is done.
+	///</summary>
+	MemoryReport memoryUsage() const
+	{
+		MemoryReport ret;
+		ret.add("edge_points", vectorMemory(edge_points));
+		ret.add("vertex_points", vectorMemory(vertex_points));
+		ret.add("used_edge_points", vectorMemory(used_edge_points));
+		ret.add("used_vertex_points", vectorMemory(used_vertex_points));
+		ret.add("adjacency", vectorMemory(adjacency));
+		return ret;
+	}
 
 
 private:
-	void build(const Mesh &mesh);
+	template<typename MeshT>
+	void build(const MeshT &mesh);
 
-	Vertex getEdgePoint(const Mesh &mesh, int edge_id);
+	template<typename MeshT>
+	VertexT getEdgePoint(const MeshT &mesh, int edge_id);
 
-	Vertex getVertexPoint(const Mesh &mesh, int vert_id);
+	template<typename MeshT>
+	VertexT getVertexPoint(const MeshT &mesh, int vert_id);
 };
 
 
 
 namespace loops_internal
 {
-	float Loops_getAlpha(size_t n);
+	template<typename T>
+	T Loops_getAlpha(size_t n);
 
 	int Loops_get_vert_id(const Edge &edge0, const Edge &edge1);
 
-	void Loops_add_vertices(LoopsData &data, int edge0_id, int edge1_id, int vert_id, Mesh &out);
+	template<typename MeshOutT>
+	void Loops_add_vertices(LoopsData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, int vert_id, MeshOutT &out);
+
+	template<typename MeshOutT>
+	void Loops_add_edge(LoopsData<typename MeshOutT::vertex_type> &data, int edgepoint0_id, int edgepoint1_id, int vert_id, MeshOutT &out);
 
-	void Loops_add_edge(LoopsData &data, int edgepoint0_id, int edgepoint1_id, int vert_id, Mesh &out);
+	template<typename MeshT, typename MeshOutT>
+	void Loops_connect_edge(const MeshT &mesh, LoopsData<typename MeshOutT::vertex_type> &data, int edge0_id, int edge1_id, MeshOutT &out);
 
-	void Loops_connect_edge(const Mesh &mesh, LoopsData &data, int edge0_id, int edge1_id, Mesh &out);
+	template<typename MeshT, typename MeshOutT>
+	void Loops_connect_face(const MeshT &mesh, LoopsData<typename MeshOutT::vertex_type> &data, int face_id, MeshOutT &out);
 
-	void Loops_connect_face(const Mesh &mesh, LoopsData &data, int face_id, Mesh &out);
+	template<typename MeshT>
+	typename MeshT::mesh_type Loops_subdivide(const MeshT &mesh, MonotonicArena *arena);
 }
 
-Mesh Loops(const Mesh &mesh);
+///<summary>
+///Instantiated for Mesh, MeshD, MeshSoAF and MeshSoAD, and MeshArenaF with an
+///arena below; the result keeps the precision and layout of mesh.
+///</summary>
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Loops(const BasicMesh<T, LayoutT> &mesh);
+
+Mesh Loops(const MeshView &mesh);
+
+///<summary>
+///Same, with the points of the level and the adjacency query results allocated
+///from arena. A MeshArenaF result is allocated from arena too, so the whole
+///level lives there and the caller releases arena once the result is no longer
+///used; other layouts return a heap mesh and arena can be released right away.
+///</summary>
+template<typename T, typename LayoutT>
+BasicMesh<T, LayoutT> Loops(const BasicMesh<T, LayoutT> &mesh, MonotonicArena &arena);
+
+Mesh Loops(const MeshView &mesh, MonotonicArena &arena);
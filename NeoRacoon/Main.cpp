@@ -5,6 +5,7 @@
 #include "imgui\imgui.h"
 #include "imgui_impl_glfw_gl3.h"
 #include <cstdio>
+#include <stdexcept>
 #include <gl3w\GL\gl3w.h>
 #include <glfw\include\GLFW\glfw3.h>
 
@@ -19,6 +20,7 @@
 #include "SimpleCornerCutting.h"
 
 #include "BenTest.h"
+#include "MemoryStats.h"
 
 GLFWwindow* window;
 GLuint vertexBufferPoints , vaoPoints , colorbuffer;
@@ -114,6 +116,7 @@ int main ( int , char** )
 	bool addCatmull = false;
 	bool addLoop = false;
 	bool addKobbelt = false;
+	bool exportMemoryStats = false;
 	ImVec4 clear_color = ImColor ( 12 , 14 , 17 );
 
 	Initialize ( );
@@ -170,6 +173,7 @@ int main ( int , char** )
 		ImGui::ColorEdit3 ( "Catmull/Loops color" , ( float* ) &mainScene->catmullFragmentColor );
 		ImGui::Separator ( );
 		if ( ImGui::Button ( "Reset" ) ) reset ^= 1;
+		if ( ImGui::Button ( "Export Memory Stats" ) ) exportMemoryStats ^= 1;
 		ImGui::ColorEdit3 ( "Clear color" , ( float* ) &clear_color );
 		if ( ImGui::Button ( "Test Window" ) ) show_test_window ^= 1;
 		ImGui::End ( );
@@ -186,6 +190,20 @@ int main ( int , char** )
 		ImGui::Text ( "%.3f ms/frame (%.1f FPS)" , 1000.0f / ImGui::GetIO ( ).Framerate , ImGui::GetIO ( ).Framerate );
 		ImGui::Separator ( );
 		ImGui::Text ( "Vertex Count : %d" , mainScene->getVertexCount ( ) );
+		ImGui::Text ( "ACMR : %.3f -> %.3f" , mainScene->getRawCacheStats ( ).acmr , mainScene->getCacheStats ( ).acmr );
+		ImGui::Text ( "ATVR : %.3f -> %.3f" , mainScene->getRawCacheStats ( ).atvr , mainScene->getCacheStats ( ).atvr );
+		ImGui::Text ( "Clusters : %d / %d" , ( int ) mainScene->getVisibleClusterCount ( ) , ( int ) mainScene->getClusterCount ( ) );
+		ImGui::Text ( "Lines : %d" , ( int ) mainScene->getLineCount ( ) );
+		ImGui::Separator ( );
+		MemoryUsage meshMemory = mainScene->getMeshMemoryUsage ( ).total ( );
+		ImGui::Text ( "Mesh memory : %.1f / %.1f KB" , meshMemory.used / 1024.0f , meshMemory.reserved / 1024.0f );
+		if ( allocationTrackingEnabled ( ) )
+		{
+			//Last run of every scope: allocations, bytes asked for, peak heap above the scope entry
+			std::vector<AllocationRecord> records = getAllocationStats ( );
+			for ( auto it = records.begin ( ); it != records.end ( ); ++it )
+				ImGui::Text ( "%s : %d allocs, %.1f KB, peak %.1f KB" , it->name , ( int ) it->last.count , it->last.bytes / 1024.0f , it->last.peak / 1024.0f );
+		}
 		ImGui::End ( );
 
 		if ( show_test_window )
@@ -225,6 +243,19 @@ int main ( int , char** )
 			addKobbelt = false;
 		}
 
+		if ( exportMemoryStats )
+		{
+			try
+			{
+				saveAllocationStats ( "memory_stats.csv" );
+			}
+			catch ( const std::runtime_error &e )
+			{
+				fprintf ( stderr , "%s\n" , e.what ( ) );
+			}
+			exportMemoryStats = false;
+		}
+
 		if ( reset )
 		{
 			mainScene->resetScene ( );
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (m_file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Can not open " + path);
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size))
+	{
+		CloseHandle(m_file);
+		throw std::runtime_error("Can not read the size of " + path);
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	// An empty file can not be mapped, it simply has no data
+	if (m_size == 0)
+		return;
+
+	m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping)
+		m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!m_data)
+	{
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::runtime_error("Can not map " + path);
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) : m_data(nullptr), m_size(0), m_fd(-1)
+{
+	m_fd = open(path.c_str(), O_RDONLY);
+	if (m_fd < 0)
+		throw std::runtime_error("Can not open " + path);
+
+	struct stat st;
+	if (fstat(m_fd, &st) != 0)
+	{
+		close(m_fd);
+		throw std::runtime_error("Can not read the size of " + path);
+	}
+	m_size = static_cast<size_t>(st.st_size);
+
+	if (m_size == 0)
+		return;
+
+	void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	if (p == MAP_FAILED)
+	{
+		close(m_fd);
+		throw std::runtime_error("Can not map " + path);
+	}
+
+	madvise(p, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const char *>(p);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		munmap(const_cast<char *>(m_data), m_size);
+	if (m_fd >= 0)
+		close(m_fd);
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+///<summary>
+///Read-only memory mapping of a whole file.
+///Throws std::runtime_error if the file can not be opened or mapped.
+///</summary>
+class MappedFile
+{
+private:
+	const char *m_data;
+	size_t m_size;
+#ifdef _WIN32
+	void *m_file;
+	void *m_mapping;
+#else
+	int m_fd;
+#endif
+
+public:
+	MappedFile(const std::string &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const char *data() const { return m_data; }
+	size_t size() const { return m_size; }
+	const char *end() const { return m_data + m_size; }
+};
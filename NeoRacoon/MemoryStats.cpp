@@ -0,0 +1,223 @@
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+
+MemoryUsage MemoryReport::total() const
+{
+	MemoryUsage ret;
+	for (auto it = parts.begin(); it != parts.end(); ++it)
+		ret += it->second;
+	return ret;
+}
+
+
+namespace memorystats_internal
+{
+	// Process wide heap counters, only moved by the replaced operator new and delete
+	std::atomic<size_t> count(0);
+	std::atomic<size_t> bytes(0);
+	std::atomic<size_t> live(0);
+	std::atomic<size_t> peak(0);
+
+	void raisePeak(size_t level)
+	{
+		size_t current = peak.load(std::memory_order_relaxed);
+		while (level > current && !peak.compare_exchange_weak(current, level, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	std::mutex records_mutex;
+	std::vector<AllocationRecord> &records()
+	{
+		static std::vector<AllocationRecord> ret;
+		return ret;
+	}
+}
+
+void memorystats_internal::MemoryStats_record(const char *name, const AllocationStats &stats)
+{
+	std::lock_guard<std::mutex> lock(records_mutex);
+	std::vector<AllocationRecord> &all = records();
+
+	auto it = all.begin();
+	while (it != all.end() && std::strcmp(it->name, name) != 0)
+		++it;
+	if (it == all.end())
+	{
+		AllocationRecord record;
+		record.name = name;
+		record.runs = 0;
+		all.push_back(record);
+		it = all.end() - 1;
+	}
+
+	++it->runs;
+	it->last = stats;
+	it->total.count += stats.count;
+	it->total.bytes += stats.bytes;
+	it->total.peak = std::max(it->total.peak, stats.peak);
+}
+
+
+AllocationScope::AllocationScope(const char *name) : m_name(name)
+{
+	using namespace memorystats_internal;
+
+	m_count = count.load();
+	m_bytes = bytes.load();
+	m_live = live.load();
+	// The peak restarts from the current level, the enclosing scope gets it back on exit
+	m_outer_peak = peak.exchange(m_live);
+}
+
+AllocationScope::~AllocationScope()
+{
+	using namespace memorystats_internal;
+
+	AllocationStats stats;
+	stats.count = count.load() - m_count;
+	stats.bytes = bytes.load() - m_bytes;
+	const size_t reached = peak.load();
+	stats.peak = reached > m_live ? reached - m_live : 0;
+	raisePeak(m_outer_peak);
+
+	MemoryStats_record(m_name, stats);
+}
+
+
+bool allocationTrackingEnabled()
+{
+#ifdef RACOONS_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::vector<AllocationRecord> getAllocationStats()
+{
+	std::lock_guard<std::mutex> lock(memorystats_internal::records_mutex);
+	return memorystats_internal::records();
+}
+
+void resetAllocationStats()
+{
+	std::lock_guard<std::mutex> lock(memorystats_internal::records_mutex);
+	memorystats_internal::records().clear();
+}
+
+void writeAllocationStats(std::ostream &out)
+{
+	const std::vector<AllocationRecord> records = getAllocationStats();
+
+	out << "scope,runs,count,bytes,peak,total_count,total_bytes,max_peak\n";
+	for (auto it = records.begin(); it != records.end(); ++it)
+	{
+		out << it->name << ',' << it->runs << ','
+			<< it->last.count << ',' << it->last.bytes << ',' << it->last.peak << ','
+			<< it->total.count << ',' << it->total.bytes << ',' << it->total.peak << '\n';
+	}
+}
+
+void saveAllocationStats(const std::string &path)
+{
+	std::ofstream file(path.c_str());
+	if (!file)
+		throw std::runtime_error("saveAllocationStats: can not open " + path);
+
+	writeAllocationStats(file);
+	if (!file)
+		throw std::runtime_error("saveAllocationStats: can not write " + path);
+}
+
+
+#ifdef RACOONS_TRACK_ALLOCATIONS
+
+namespace memorystats_internal
+{
+	void *allocate(size_t size)
+	{
+		char *block = static_cast<char *>(std::malloc(size + MemoryStats_HEADER));
+		if (!block)
+			return nullptr;
+		*reinterpret_cast<size_t *>(block) = size;
+
+		count.fetch_add(1, std::memory_order_relaxed);
+		bytes.fetch_add(size, std::memory_order_relaxed);
+		raisePeak(live.fetch_add(size, std::memory_order_relaxed) + size);
+		return block + MemoryStats_HEADER;
+	}
+
+	void release(void *p)
+	{
+		if (!p)
+			return;
+		char *block = static_cast<char *>(p) - MemoryStats_HEADER;
+		live.fetch_sub(*reinterpret_cast<size_t *>(block), std::memory_order_relaxed);
+		std::free(block);
+	}
+}
+
+void *operator new(size_t size)
+{
+	void *p = memorystats_internal::allocate(size);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	return memorystats_internal::allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return memorystats_internal::allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+	memorystats_internal::release(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	memorystats_internal::release(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	memorystats_internal::release(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+	memorystats_internal::release(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+	memorystats_internal::release(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+	memorystats_internal::release(p);
+}
+
+#endif
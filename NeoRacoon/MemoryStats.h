@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstddef>
+
+
+// Memory instrumentation. memoryUsage() on the main structures tells what they
+// hold on the heap right now; an AllocationScope counts the heap allocations a
+// pass makes. Counting replaces the global operator new and delete, so it is
+// only compiled in when RACOONS_TRACK_ALLOCATIONS is defined; without it the
+// scopes are still valid and report zeros.
+
+///<summary>
+///Heap memory of one part of a structure.
+///</summary>
+struct MemoryUsage
+{
+	size_t used; // bytes of the live elements
+	size_t reserved; // bytes allocated, unused capacity included
+	size_t allocations; // heap blocks
+
+	MemoryUsage() : used(0), reserved(0), allocations(0) {}
+	MemoryUsage(size_t used, size_t reserved, size_t allocations) : used(used), reserved(reserved), allocations(allocations) {}
+
+	MemoryUsage &operator+=(const MemoryUsage &m)
+	{
+		used += m.used;
+		reserved += m.reserved;
+		allocations += m.allocations;
+		return *this;
+	}
+};
+
+template<typename T, typename AllocatorT>
+MemoryUsage vectorMemory(const std::vector<T, AllocatorT> &v)
+{
+	return MemoryUsage(v.size() * sizeof(T), v.capacity() * sizeof(T), v.capacity() != 0 ? 1 : 0);
+}
+
+///<summary>
+///Breakdown returned by the memoryUsage methods, one named part per member.
+///Part names are string literals.
+///</summary>
+struct MemoryReport
+{
+	std::vector<std::pair<const char *, MemoryUsage>> parts;
+
+	void add(const char *name, const MemoryUsage &usage) { parts.push_back(std::make_pair(name, usage)); }
+
+	MemoryUsage total() const;
+};
+
+
+///<summary>
+///Heap traffic inside a scope: allocations made and bytes asked for, by any
+///thread, and the highest heap level reached above the one at scope entry.
+///</summary>
+struct AllocationStats
+{
+	size_t count;
+	size_t bytes;
+	size_t peak;
+
+	AllocationStats() : count(0), bytes(0), peak(0) {}
+};
+
+///<summary>
+///Last run and running total of every scope name, totals keep the highest peak.
+///</summary>
+struct AllocationRecord
+{
+	const char *name;
+	size_t runs;
+	AllocationStats last;
+	AllocationStats total;
+};
+
+
+namespace memorystats_internal
+{
+	// Allocations reserve a 16 byte header holding their size, so frees know what they give back
+	const size_t MemoryStats_HEADER = 16;
+
+	void MemoryStats_record(const char *name, const AllocationStats &stats);
+}
+
+
+///<summary>
+///Counts the allocations made between its construction and its destruction
+///and adds them to the record of name, a string literal. Scopes nest; they are
+///meant to be opened by the thread driving a pass, but count the allocations of
+///the worker threads it starts too. Code that may itself run on a worker, like
+///the subdivision engines, opens none: concurrent scopes would count each
+///other's allocations.
+///</summary>
+class AllocationScope
+{
+private:
+	const char *m_name;
+	size_t m_count;
+	size_t m_bytes;
+	size_t m_live;
+	size_t m_outer_peak;
+
+public:
+	explicit AllocationScope(const char *name);
+	~AllocationScope();
+
+	AllocationScope(const AllocationScope &) = delete;
+	AllocationScope &operator=(const AllocationScope &) = delete;
+};
+
+
+///<summary>
+///True when the build counts allocations (RACOONS_TRACK_ALLOCATIONS).
+///</summary>
+bool allocationTrackingEnabled();
+
+///<summary>
+///Records of every scope name run so far, in order of first run.
+///</summary>
+std::vector<AllocationRecord> getAllocationStats();
+
+void resetAllocationStats();
+
+///<summary>
+///Writes the records as CSV, one line per scope name.
+///</summary>
+void writeAllocationStats(std::ostream &out);
+
+///<summary>
+///Same, into a file. Throws std::runtime_error if the file can not be written.
+///</summary>
+void saveAllocationStats(const std::string &path);
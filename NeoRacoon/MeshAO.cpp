@@ -0,0 +1,121 @@
+#include "MeshAO.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "Parallel.h"
+#include "PointLayout.h"
+#include "MeshNormals.h"
+
+
+void meshao_internal::MeshAO_hemisphere(unsigned int samples, std::vector<glm::vec3> &directions)
+{
+	const float golden_angle = 2.39996323f;
+
+	directions.resize(samples);
+	for (unsigned int i = 0; i < samples; ++i)
+	{
+		// Equal area rings of the disk project to equal cosine weighted solid angles
+		const float r2 = (i + 0.5f) / samples;
+		const float r = std::sqrt(r2), phi = i * golden_angle;
+		directions[i] = glm::vec3(r * std::cos(phi), r * std::sin(phi), std::sqrt(std::max(1.0f - r2, 0.0f)));
+	}
+}
+
+void meshao_internal::MeshAO_basis(const glm::vec3 &n, glm::vec3 &tangent, glm::vec3 &bitangent)
+{
+	// Duff et al., branchless apart from the sign
+	const float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+	const float a = -1.0f / (sign + n.z);
+	const float b = n.x * n.y * a;
+	tangent = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	bitangent = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+float meshao_internal::MeshAO_rotation(uint32_t vertex, uint32_t seed)
+{
+	uint32_t h = vertex * 0x9E3779B9u ^ seed * 0x85EBCA6Bu;
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return (h >> 8) * (6.28318531f / 16777216.0f);
+}
+
+
+void bakeAmbientOcclusion(RenderableMesh &mesh, const MeshBVH &bvh, const AOOptions &options)
+{
+	using namespace meshao_internal;
+
+	if (options.samples == 0)
+		throw std::invalid_argument("bakeAmbientOcclusion: samples must be positive");
+	if (options.max_distance < 0.0f)
+		throw std::invalid_argument("bakeAmbientOcclusion: max_distance must not be negative");
+
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	mesh.occlusion.assign(nb_vertices, 1.0f);
+	if (nb_vertices == 0 || bvh.triangles.empty())
+		return;
+	if (mesh.normals.size() != mesh.vertices.size())
+		computeNormals(mesh);
+
+	float max_distance = options.max_distance;
+	if (max_distance == 0.0f)
+	{
+		const BVHNode &root = bvh.nodes[0];
+		max_distance = 0.25f * glm::length(glm::vec3(root.max[0] - root.min[0], root.max[1] - root.min[1], root.max[2] - root.min[2]));
+		if (!(max_distance > 0.0f))
+			return;
+	}
+	const float lift = options.bias * max_distance;
+
+	std::vector<glm::vec3> directions;
+	MeshAO_hemisphere(options.samples, directions);
+
+	ArrayView<glm::vec3> positions = viewPoints<glm::vec3>(mesh.vertices);
+	ArrayView<glm::vec3> normals = viewPoints<glm::vec3>(mesh.normals);
+
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t v = first; v < last; ++v)
+		{
+			const glm::vec3 &n = normals[v];
+			const float length = glm::length(n);
+			if (!(length > 0.0f))
+				continue;
+
+			// Tangent frame turned by the vertex's own angle, so neighbouring
+			// vertices do not share the banding of the spiral
+			glm::vec3 tangent, bitangent;
+			const glm::vec3 normal = n / length;
+			MeshAO_basis(normal, tangent, bitangent);
+			const float angle = MeshAO_rotation(static_cast<uint32_t>(v), options.seed);
+			const float c = std::cos(angle), s = std::sin(angle);
+			const glm::vec3 tx = c * tangent + s * bitangent, ty = c * bitangent - s * tangent;
+
+			const glm::vec3 origin = positions[v] + lift * normal;
+			unsigned int open = 0;
+			for (auto it = directions.begin(); it != directions.end(); ++it)
+			{
+				const glm::vec3 direction = it->x * tx + it->y * ty + it->z * normal;
+				if (!occludesRay(bvh, origin, direction, lift, max_distance))
+					++open;
+			}
+			mesh.occlusion[v] = static_cast<float>(open) / options.samples;
+		}
+	}, 64);
+}
+
+void bakeAmbientOcclusion(RenderableMesh &mesh, const AOOptions &options)
+{
+	if (mesh.vertices.empty())
+	{
+		mesh.occlusion.clear();
+		return;
+	}
+
+	const MeshBVH bvh = buildBVH(mesh);
+	bakeAmbientOcclusion(mesh, bvh, options);
+}
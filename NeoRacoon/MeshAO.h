@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+#include "MeshBVH.h"
+
+
+// Ambient occlusion baked once per vertex on the CPU: every vertex casts a
+// fixed set of cosine weighted rays over its hemisphere against the mesh BVH,
+// and keeps the fraction that escapes. Subdivided meshes only change when the
+// shape does, so this replaces the per pixel, per frame sampling of ssao.fs.
+
+struct AOOptions
+{
+	unsigned int samples; // rays per vertex
+	float max_distance; // occluders further than this do not count, 0 for a quarter of the bounds diagonal
+	float bias; // ray origins are lifted along the normal by bias * max_distance to clear their own triangles
+	uint32_t seed; // rotation of the sample set of every vertex, the same seed gives the same result
+
+	AOOptions() : samples(32), max_distance(0.0f), bias(1e-3f), seed(1) {}
+};
+
+
+namespace meshao_internal
+{
+	// Cosine weighted directions around +z: a Fibonacci spiral over the unit
+	// disk, lifted onto the hemisphere
+	void MeshAO_hemisphere(unsigned int samples, std::vector<glm::vec3> &directions);
+
+	// Tangent and bitangent completing the unit normal n into an orthonormal basis
+	void MeshAO_basis(const glm::vec3 &n, glm::vec3 &tangent, glm::vec3 &bitangent);
+
+	// Angle in [0, 2 pi) turning the sample set of vertex, from a hash of vertex and seed
+	float MeshAO_rotation(uint32_t vertex, uint32_t seed);
+}
+
+
+///<summary>
+///Fills mesh.occlusion with the share of the hemisphere around every vertex
+///normal that is open within max_distance: 1 in the open, 0 fully enclosed.
+///mesh.normals is computed first when missing. Vertices run in parallel, each
+///one on its own rotation of the sample set, so the result does not depend on
+///the thread count.
+///Throws std::invalid_argument when samples is 0 or max_distance is negative.
+///</summary>
+void bakeAmbientOcclusion(RenderableMesh &mesh, const AOOptions &options = AOOptions());
+
+///<summary>
+///Same, against the triangles of bvh, which may hold more geometry than mesh
+///(a whole scene) as long as it contains the mesh surface.
+///</summary>
+void bakeAmbientOcclusion(RenderableMesh &mesh, const MeshBVH &bvh, const AOOptions &options = AOOptions());
@@ -0,0 +1,725 @@
+#include "MeshBVH.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define MESHBVH_SSE
+#endif
+
+#include "Parallel.h"
+#include "PointLayout.h"
+#include "VertexCache.h"
+
+
+namespace meshbvh_internal
+{
+	struct Box
+	{
+		glm::vec3 min, max;
+
+		Box() : min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max()) {}
+
+		void grow(const glm::vec3 &p) { min = glm::min(min, p); max = glm::max(max, p); }
+
+		void grow(const Box &b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+
+		float area() const
+		{
+			glm::vec3 d = max - min;
+			return d.x < 0.0f ? 0.0f : d.x * d.y + d.y * d.z + d.z * d.x;
+		}
+	};
+
+	struct Bin
+	{
+		Box box;
+		uint32_t count;
+
+		Bin() : count(0) {}
+	};
+
+	// A subtree left to a worker thread, rooted at nodes[slot]
+	struct Task
+	{
+		uint32_t slot;
+		size_t begin, end;
+		int depth;
+	};
+
+	struct Builder
+	{
+		std::vector<Box> bounds; // per triangle id
+		std::vector<glm::vec3> centroids;
+		std::vector<uint32_t> &prims;
+		size_t max_leaf;
+
+		Builder(std::vector<uint32_t> &prims, size_t max_leaf) : prims(prims), max_leaf(max_leaf) {}
+	};
+
+	const size_t PARALLEL_RANGE = 1 << 16; // nodes binned in parallel above this many triangles
+
+	Box triangleBox(const MeshBVH &bvh, uint32_t t)
+	{
+		Box b;
+		for (int k = 0; k < 3; ++k)
+			b.grow(bvh.positions[bvh.indices[t * 3 + k]]);
+		return b;
+	}
+
+	void rangeBounds(const Builder &b, size_t begin, size_t end, Box &box, Box &cbox)
+	{
+		const size_t nb_blocks = end - begin >= PARALLEL_RANGE ? parallel::blockCount(end - begin, PARALLEL_RANGE / 4) : 1;
+		std::vector<Box> boxes(nb_blocks), cboxes(nb_blocks);
+		parallel::parallelFor(begin, end, [&](size_t first, size_t last, unsigned int block)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				boxes[block].grow(b.bounds[b.prims[i]]);
+				cboxes[block].grow(b.centroids[b.prims[i]]);
+			}
+		}, nb_blocks > 1 ? PARALLEL_RANGE / 4 : end - begin + 1);
+
+		for (size_t k = 0; k < nb_blocks; ++k)
+		{
+			box.grow(boxes[k]);
+			cbox.grow(cboxes[k]);
+		}
+	}
+
+	int binOf(const glm::vec3 &c, const Box &cbox, int axis)
+	{
+		float extent = cbox.max[axis] - cbox.min[axis];
+		int bin = static_cast<int>((c[axis] - cbox.min[axis]) * MeshBVH_BINS / extent);
+		return std::max(0, std::min(MeshBVH_BINS - 1, bin));
+	}
+
+	void binRange(const Builder &b, size_t begin, size_t end, const Box &cbox, Bin (&bins)[3][MeshBVH_BINS])
+	{
+		const size_t nb_blocks = end - begin >= PARALLEL_RANGE ? parallel::blockCount(end - begin, PARALLEL_RANGE / 4) : 1;
+		std::vector<Bin> block_bins(nb_blocks * 3 * MeshBVH_BINS);
+		parallel::parallelFor(begin, end, [&](size_t first, size_t last, unsigned int block)
+		{
+			Bin *out = &block_bins[block * 3 * MeshBVH_BINS];
+			for (size_t i = first; i < last; ++i)
+			{
+				uint32_t t = b.prims[i];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					if (cbox.max[axis] <= cbox.min[axis])
+						continue;
+					Bin &bin = out[axis * MeshBVH_BINS + binOf(b.centroids[t], cbox, axis)];
+					bin.box.grow(b.bounds[t]);
+					++bin.count;
+				}
+			}
+		}, nb_blocks > 1 ? PARALLEL_RANGE / 4 : end - begin + 1);
+
+		for (size_t k = 0; k < nb_blocks; ++k)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				for (int i = 0; i < MeshBVH_BINS; ++i)
+				{
+					const Bin &src = block_bins[(k * 3 + axis) * MeshBVH_BINS + i];
+					bins[axis][i].box.grow(src.box);
+					bins[axis][i].count += src.count;
+				}
+			}
+		}
+	}
+
+	void setBox(BVHNode &node, const Box &box)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			node.min[k] = box.min[k];
+			node.max[k] = box.max[k];
+		}
+	}
+
+	// Builds nodes[slot] over prims[begin, end). With tasks, ranges of at most
+	// task_size triangles are queued there instead of being built.
+	void buildNode(Builder &b, std::vector<BVHNode> &nodes, uint32_t slot, size_t begin, size_t end, int depth, size_t task_size, std::vector<Task> *tasks)
+	{
+		Box box, cbox;
+		rangeBounds(b, begin, end, box, cbox);
+		setBox(nodes[slot], box);
+
+		const size_t count = end - begin;
+		glm::vec3 extent = cbox.max - cbox.min;
+		if (count <= b.max_leaf || (extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f))
+		{
+			nodes[slot].offset = static_cast<uint32_t>(begin);
+			nodes[slot].count = static_cast<uint32_t>(count);
+			return;
+		}
+
+		if (tasks && count <= task_size)
+		{
+			Task task = { slot, begin, end, depth };
+			tasks->push_back(task);
+			return;
+		}
+
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+		size_t middle = begin;
+
+		if (depth < MeshBVH_MAX_DEPTH)
+		{
+			// Binned SAH: sweep every axis from both sides
+			Bin bins[3][MeshBVH_BINS];
+			binRange(b, begin, end, cbox, bins);
+
+			float best_cost = std::numeric_limits<float>::max();
+			int best_axis = -1, best_split = 0;
+			for (int a = 0; a < 3; ++a)
+			{
+				if (extent[a] <= 0.0f)
+					continue;
+
+				float right_area[MeshBVH_BINS];
+				uint32_t right_count[MeshBVH_BINS];
+				Box acc;
+				uint32_t n = 0;
+				for (int i = MeshBVH_BINS - 1; i > 0; --i)
+				{
+					acc.grow(bins[a][i].box);
+					n += bins[a][i].count;
+					right_area[i] = acc.area();
+					right_count[i] = n;
+				}
+
+				acc = Box();
+				n = 0;
+				for (int i = 0; i < MeshBVH_BINS - 1; ++i)
+				{
+					acc.grow(bins[a][i].box);
+					n += bins[a][i].count;
+					if (n == 0 || right_count[i + 1] == 0)
+						continue;
+					float cost = acc.area() * n + right_area[i + 1] * right_count[i + 1];
+					if (cost < best_cost)
+					{
+						best_cost = cost;
+						best_axis = a;
+						best_split = i + 1;
+					}
+				}
+			}
+
+			if (best_axis >= 0)
+			{
+				const Box &cb = cbox;
+				middle = std::partition(b.prims.begin() + begin, b.prims.begin() + end, [&](uint32_t t)
+				{
+					return binOf(b.centroids[t], cb, best_axis) < best_split;
+				}) - b.prims.begin();
+			}
+		}
+
+		// Too deep, or every centroid landed in one bin: object median
+		if (middle == begin || middle == end)
+		{
+			middle = begin + count / 2;
+			std::nth_element(b.prims.begin() + begin, b.prims.begin() + middle, b.prims.begin() + end, [&](uint32_t l, uint32_t r)
+			{
+				return b.centroids[l][axis] < b.centroids[r][axis];
+			});
+		}
+
+		const uint32_t children = static_cast<uint32_t>(nodes.size());
+		nodes.resize(nodes.size() + 2);
+		nodes[slot].offset = children;
+		nodes[slot].count = 0;
+
+		buildNode(b, nodes, children, begin, middle, depth + 1, task_size, tasks);
+		buildNode(b, nodes, children + 1, middle, end, depth + 1, task_size, tasks);
+	}
+
+	void fillTriangles(MeshBVH &bvh, const RenderableMesh &mesh)
+	{
+		copyPoints(mesh.vertices, bvh.positions);
+
+		bvh.indices = vertexcache_internal::VertexCache_read_indices(mesh);
+		bvh.indices.resize(bvh.indices.size() / 3 * 3);
+		bvh.faces.clear();
+	}
+
+	void fillTriangles(MeshBVH &bvh, const Mesh &mesh)
+	{
+		copyPoints(mesh.vertices, bvh.positions);
+
+		bvh.indices.clear();
+		bvh.faces.clear();
+		std::vector<int> loop;
+		for (size_t f = 0; f < mesh.faces.size(); ++f)
+		{
+			mesh.getFaceLoop(static_cast<int>(f), loop);
+			for (size_t i = 1; i + 1 < loop.size(); ++i)
+			{
+				bvh.indices.push_back(loop[0]);
+				bvh.indices.push_back(loop[i]);
+				bvh.indices.push_back(loop[i + 1]);
+				bvh.faces.push_back(static_cast<uint32_t>(f));
+			}
+		}
+	}
+
+	// Slab test of a node box against a ray, origin and inv_dir in lanes 0-2.
+	// Returns the entry distance, or a negative value on a miss.
+#ifdef MESHBVH_SSE
+	inline float rayBox(const BVHNode &node, __m128 origin, __m128 inv_dir, float t_max)
+	{
+		__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.min), origin), inv_dir);
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.max), origin), inv_dir);
+		__m128 lo = _mm_min_ps(t0, t1), hi = _mm_max_ps(t0, t1);
+
+		// Lane 3 holds offset and count, only lanes 0-2 are reduced
+		__m128 near_t = _mm_max_ss(_mm_max_ss(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 2, 2, 2)));
+		__m128 far_t = _mm_min_ss(_mm_min_ss(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 2, 2, 2)));
+		near_t = _mm_max_ss(near_t, _mm_setzero_ps());
+		far_t = _mm_min_ss(far_t, _mm_set_ss(t_max));
+
+		float n = _mm_cvtss_f32(near_t);
+		return n <= _mm_cvtss_f32(far_t) ? n : -1.0f;
+	}
+#else
+	inline float rayBox(const BVHNode &node, const glm::vec3 &origin, const glm::vec3 &inv_dir, float t_max)
+	{
+		float n = 0.0f, f = t_max;
+		for (int k = 0; k < 3; ++k)
+		{
+			float t0 = (node.min[k] - origin[k]) * inv_dir[k];
+			float t1 = (node.max[k] - origin[k]) * inv_dir[k];
+			n = std::max(n, std::min(t0, t1));
+			f = std::min(f, std::max(t0, t1));
+		}
+		return n <= f ? n : -1.0f;
+	}
+#endif
+
+	// Moller-Trumbore, two sided
+	bool rayTriangle(const glm::vec3 &origin, const glm::vec3 &dir, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, float &t, float &u, float &v)
+	{
+		glm::vec3 e1 = b - a, e2 = c - a;
+		glm::vec3 p = glm::cross(dir, e2);
+		float det = glm::dot(e1, p);
+		if (det == 0.0f)
+			return false;
+
+		float inv = 1.0f / det;
+		glm::vec3 s = origin - a;
+		u = glm::dot(s, p) * inv;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		glm::vec3 q = glm::cross(s, e1);
+		v = glm::dot(dir, q) * inv;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		t = glm::dot(e2, q) * inv;
+		return true;
+	}
+
+	float boxDistance2(const BVHNode &node, const glm::vec3 &p)
+	{
+		float d2 = 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			float d = std::max(0.0f, std::max(node.min[k] - p[k], p[k] - node.max[k]));
+			d2 += d * d;
+		}
+		return d2;
+	}
+}
+
+
+void meshbvh_internal::MeshBVH_build(MeshBVH &bvh, size_t max_leaf)
+{
+	if (max_leaf == 0)
+		throw std::invalid_argument("buildBVH: max_leaf must be at least 1");
+
+	const size_t nb_triangles = bvh.indices.size() / 3;
+	bvh.nodes.clear();
+	bvh.triangles.resize(nb_triangles);
+	for (size_t t = 0; t < nb_triangles; ++t)
+		bvh.triangles[t] = static_cast<uint32_t>(t);
+
+	Builder b(bvh.triangles, max_leaf);
+	b.bounds.resize(nb_triangles);
+	b.centroids.resize(nb_triangles);
+	parallel::parallelFor(0, nb_triangles, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t t = first; t < last; ++t)
+		{
+			b.bounds[t] = triangleBox(bvh, static_cast<uint32_t>(t));
+			b.centroids[t] = (b.bounds[t].min + b.bounds[t].max) * 0.5f;
+		}
+	});
+
+	bvh.nodes.resize(1);
+	if (nb_triangles == 0)
+		return;
+
+	// Top of the tree on this thread, then the subtrees below it in parallel
+	const size_t task_size = std::max<size_t>(1024, nb_triangles / (parallel::threadCount() * 4));
+	std::vector<Task> tasks;
+	buildNode(b, bvh.nodes, 0, 0, nb_triangles, 0, task_size, &tasks);
+
+	std::vector<std::vector<BVHNode>> subtrees(tasks.size());
+	parallel::parallelFor(0, tasks.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			subtrees[i].resize(1);
+			buildNode(b, subtrees[i], 0, tasks[i].begin, tasks[i].end, tasks[i].depth, 0, nullptr);
+		}
+	}, 1);
+
+	// Splice every subtree: its root goes to the task slot, the rest is
+	// appended, so children still come after their parent
+	for (size_t i = 0; i < tasks.size(); ++i)
+	{
+		const uint32_t base = static_cast<uint32_t>(bvh.nodes.size()) - 1;
+		std::vector<BVHNode> &sub = subtrees[i];
+		for (auto it = sub.begin(); it != sub.end(); ++it)
+		{
+			if (!it->isLeaf())
+				it->offset += base;
+		}
+
+		bvh.nodes[tasks[i].slot] = sub[0];
+		bvh.nodes.insert(bvh.nodes.end(), sub.begin() + 1, sub.end());
+	}
+}
+
+void meshbvh_internal::MeshBVH_refit(MeshBVH &bvh)
+{
+	std::vector<BVHNode> &nodes = bvh.nodes;
+	parallel::parallelFor(0, nodes.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			if (!nodes[i].isLeaf())
+				continue;
+			Box box;
+			for (uint32_t k = 0; k < nodes[i].count; ++k)
+				box.grow(triangleBox(bvh, bvh.triangles[nodes[i].offset + k]));
+			setBox(nodes[i], box);
+		}
+	});
+
+	for (size_t i = nodes.size(); i-- > 0;)
+	{
+		if (nodes[i].isLeaf())
+			continue;
+		const BVHNode &l = nodes[nodes[i].offset], &r = nodes[nodes[i].offset + 1];
+		for (int k = 0; k < 3; ++k)
+		{
+			nodes[i].min[k] = std::min(l.min[k], r.min[k]);
+			nodes[i].max[k] = std::max(l.max[k], r.max[k]);
+		}
+	}
+}
+
+glm::vec3 meshbvh_internal::MeshBVH_closest_point(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+	// Voronoi regions of the triangle, as in Ericson's Real-Time Collision Detection
+	glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+		return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+		return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		return a + ab * (d1 / (d1 - d3));
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+		return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+
+MeshBVH buildBVH(const RenderableMesh &mesh, size_t max_leaf)
+{
+	MeshBVH bvh;
+	meshbvh_internal::fillTriangles(bvh, mesh);
+	meshbvh_internal::MeshBVH_build(bvh, max_leaf);
+	return bvh;
+}
+
+MeshBVH buildBVH(const Mesh &mesh, size_t max_leaf)
+{
+	MeshBVH bvh;
+	meshbvh_internal::fillTriangles(bvh, mesh);
+	meshbvh_internal::MeshBVH_build(bvh, max_leaf);
+	return bvh;
+}
+
+
+void refitBVH(MeshBVH &bvh, const RenderableMesh &mesh)
+{
+	if (mesh.vertices.size() != bvh.positions.size() * 3)
+		throw std::invalid_argument("refitBVH: vertex count differs from the built mesh");
+
+	copyPoints(mesh.vertices, bvh.positions);
+	meshbvh_internal::MeshBVH_refit(bvh);
+}
+
+void refitBVH(MeshBVH &bvh, const Mesh &mesh)
+{
+	if (mesh.vertices.size() != bvh.positions.size())
+		throw std::invalid_argument("refitBVH: vertex count differs from the built mesh");
+
+	copyPoints(mesh.vertices, bvh.positions);
+	meshbvh_internal::MeshBVH_refit(bvh);
+}
+
+
+bool intersectRay(const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, BVHHit &hit, float t_max)
+{
+	return intersectRay(bvh, origin, direction, hit, 0.0f, t_max);
+}
+
+bool intersectRay(const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, BVHHit &hit, float t_min, float t_max)
+{
+	using namespace meshbvh_internal;
+
+	if (bvh.triangles.empty())
+		return false;
+
+	// Zero components are nudged so that no slab computes 0 * inf
+	glm::vec3 inv_dir;
+	for (int k = 0; k < 3; ++k)
+	{
+		float d = direction[k];
+		if (std::fabs(d) < 1e-20f)
+			d = d < 0.0f ? -1e-20f : 1e-20f;
+		inv_dir[k] = 1.0f / d;
+	}
+
+#ifdef MESHBVH_SSE
+	const __m128 o = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+	const __m128 inv = _mm_setr_ps(inv_dir.x, inv_dir.y, inv_dir.z, 0.0f);
+#else
+	const glm::vec3 &o = origin;
+	const glm::vec3 &inv = inv_dir;
+#endif
+
+	bool found = false;
+	float best = t_max;
+	uint32_t stack[MeshBVH_STACK];
+	int top = 0;
+	if (rayBox(bvh.nodes[0], o, inv, best) < 0.0f)
+		return false;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const BVHNode &node = bvh.nodes[stack[--top]];
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t tri = bvh.triangles[node.offset + i];
+				const uint32_t *id = &bvh.indices[tri * 3];
+				float t, u, v;
+				if (rayTriangle(origin, direction, bvh.positions[id[0]], bvh.positions[id[1]], bvh.positions[id[2]], t, u, v) && t >= t_min && t <= best)
+				{
+					best = t;
+					found = true;
+					hit.triangle = tri;
+					hit.face = bvh.getFace(tri);
+					hit.t = t;
+					hit.u = u;
+					hit.v = v;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first, skip the ones behind the current hit
+		float tl = rayBox(bvh.nodes[node.offset], o, inv, best);
+		float tr = rayBox(bvh.nodes[node.offset + 1], o, inv, best);
+		if (tl >= 0.0f && tr >= 0.0f)
+		{
+			bool left_first = tl <= tr;
+			stack[top++] = node.offset + (left_first ? 1 : 0);
+			stack[top++] = node.offset + (left_first ? 0 : 1);
+		}
+		else if (tl >= 0.0f)
+			stack[top++] = node.offset;
+		else if (tr >= 0.0f)
+			stack[top++] = node.offset + 1;
+	}
+
+	return found;
+}
+
+bool occludesRay(const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, float t_min, float t_max)
+{
+	using namespace meshbvh_internal;
+
+	if (bvh.triangles.empty())
+		return false;
+
+	glm::vec3 inv_dir;
+	for (int k = 0; k < 3; ++k)
+	{
+		float d = direction[k];
+		if (std::fabs(d) < 1e-20f)
+			d = d < 0.0f ? -1e-20f : 1e-20f;
+		inv_dir[k] = 1.0f / d;
+	}
+
+#ifdef MESHBVH_SSE
+	const __m128 o = _mm_setr_ps(origin.x, origin.y, origin.z, 0.0f);
+	const __m128 inv = _mm_setr_ps(inv_dir.x, inv_dir.y, inv_dir.z, 0.0f);
+#else
+	const glm::vec3 &o = origin;
+	const glm::vec3 &inv = inv_dir;
+#endif
+
+	uint32_t stack[MeshBVH_STACK];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const BVHNode &node = bvh.nodes[stack[--top]];
+		if (rayBox(node, o, inv, t_max) < 0.0f)
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				const uint32_t *id = &bvh.indices[bvh.triangles[node.offset + i] * 3];
+				float t, u, v;
+				if (rayTriangle(origin, direction, bvh.positions[id[0]], bvh.positions[id[1]], bvh.positions[id[2]], t, u, v) && t >= t_min && t <= t_max)
+					return true;
+			}
+			continue;
+		}
+
+		stack[top++] = node.offset + 1;
+		stack[top++] = node.offset;
+	}
+
+	return false;
+}
+
+bool findNearestPoint(const MeshBVH &bvh, const glm::vec3 &p, BVHNearest &nearest, float max_distance)
+{
+	using namespace meshbvh_internal;
+
+	if (bvh.triangles.empty())
+		return false;
+
+	bool found = false;
+	float best2 = max_distance < std::sqrt(std::numeric_limits<float>::max()) ? max_distance * max_distance : std::numeric_limits<float>::max();
+	uint32_t stack[MeshBVH_STACK];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const BVHNode &node = bvh.nodes[stack[--top]];
+		if (boxDistance2(node, p) > best2)
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				uint32_t tri = bvh.triangles[node.offset + i];
+				const uint32_t *id = &bvh.indices[tri * 3];
+				glm::vec3 q = MeshBVH_closest_point(p, bvh.positions[id[0]], bvh.positions[id[1]], bvh.positions[id[2]]);
+				glm::vec3 d = q - p;
+				float d2 = glm::dot(d, d);
+				if (d2 <= best2)
+				{
+					best2 = d2;
+					found = true;
+					nearest.triangle = tri;
+					nearest.face = bvh.getFace(tri);
+					nearest.point = q;
+				}
+			}
+			continue;
+		}
+
+		float dl = boxDistance2(bvh.nodes[node.offset], p);
+		float dr = boxDistance2(bvh.nodes[node.offset + 1], p);
+		bool left_first = dl <= dr;
+		stack[top++] = node.offset + (left_first ? 1 : 0);
+		stack[top++] = node.offset + (left_first ? 0 : 1);
+	}
+
+	if (found)
+		nearest.distance = std::sqrt(best2);
+	return found;
+}
+
+size_t queryBox(const MeshBVH &bvh, const glm::vec3 &min, const glm::vec3 &max, std::vector<uint32_t> &triangles)
+{
+	using namespace meshbvh_internal;
+
+	triangles.clear();
+	if (bvh.triangles.empty())
+		return 0;
+
+	auto overlaps = [&](const float *lo, const float *hi)
+	{
+		return lo[0] <= max.x && hi[0] >= min.x && lo[1] <= max.y && hi[1] >= min.y && lo[2] <= max.z && hi[2] >= min.z;
+	};
+
+	uint32_t stack[MeshBVH_STACK];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const BVHNode &node = bvh.nodes[stack[--top]];
+		if (!overlaps(node.min, node.max))
+			continue;
+
+		if (!node.isLeaf())
+		{
+			stack[top++] = node.offset + 1;
+			stack[top++] = node.offset;
+			continue;
+		}
+
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			uint32_t tri = bvh.triangles[node.offset + i];
+			Box box = triangleBox(bvh, tri);
+			if (overlaps(&box.min.x, &box.max.x))
+				triangles.push_back(tri);
+		}
+	}
+
+	return triangles.size();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+
+
+// Bounding volume hierarchy over the triangles of a mesh, for picking and tool
+// ray queries. Polygon faces are fan triangulated and every triangle remembers
+// its face.
+
+///<summary>
+///32 bytes, two 16 byte rows so a box loads as two SSE registers. The children
+///of an inner node are stored side by side at offset and offset + 1, always
+///after their parent.
+///</summary>
+struct BVHNode
+{
+	float min[3];
+	uint32_t offset; // inner node: first child, leaf: first triangle in MeshBVH::triangles
+	float max[3];
+	uint32_t count; // triangles in the leaf, 0 for inner nodes
+
+	bool isLeaf() const { return count != 0; }
+};
+
+struct MeshBVH
+{
+	std::vector<BVHNode> nodes; // root first
+	std::vector<uint32_t> triangles; // triangle ids in leaf order
+	std::vector<uint32_t> indices; // 3 vertex ids per triangle id
+	std::vector<uint32_t> faces; // face of every triangle id, empty when built from a RenderableMesh
+	std::vector<glm::vec3> positions;
+
+	uint32_t getFace(uint32_t triangle) const { return faces.empty() ? triangle : faces[triangle]; }
+};
+
+struct BVHHit
+{
+	uint32_t triangle;
+	uint32_t face;
+	float t; // hit point is origin + t * direction
+	float u, v; // barycentric coordinates of the hit on the triangle's 2nd and 3rd vertices
+};
+
+struct BVHNearest
+{
+	uint32_t triangle;
+	uint32_t face;
+	glm::vec3 point;
+	float distance;
+};
+
+
+namespace meshbvh_internal
+{
+	const int MeshBVH_BINS = 16; // SAH bins per axis
+	const int MeshBVH_MAX_DEPTH = 48; // deeper nodes split at the median, which bounds the traversal stacks
+	const int MeshBVH_STACK = 128;
+
+	void MeshBVH_build(MeshBVH &bvh, size_t max_leaf);
+
+	// Recomputes the node bounds from positions, leaves first
+	void MeshBVH_refit(MeshBVH &bvh);
+
+	glm::vec3 MeshBVH_closest_point(const glm::vec3 &p, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+}
+
+
+///<summary>
+///Builds a BVH over the triangles of mesh with binned SAH splits, leaves of up
+///to max_leaf triangles (more only when their centroids coincide). Large nodes
+///are binned in parallel and the subtrees below them are built in parallel.
+///</summary>
+MeshBVH buildBVH(const RenderableMesh &mesh, size_t max_leaf = 4);
+
+MeshBVH buildBVH(const Mesh &mesh, size_t max_leaf = 4);
+
+///<summary>
+///Updates the positions of bvh and refits its boxes without changing the tree,
+///for meshes whose vertices moved but whose triangles did not change. Throws
+///std::invalid_argument when the vertex count differs from the one bvh was built with.
+///</summary>
+void refitBVH(MeshBVH &bvh, const RenderableMesh &mesh);
+
+void refitBVH(MeshBVH &bvh, const Mesh &mesh);
+
+///<summary>
+///Closest triangle hit by the ray along direction (not necessarily normalized)
+///with t in [0, t_max]. Both sides of the triangles are hit. Returns false when nothing is hit.
+///</summary>
+bool intersectRay(const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, BVHHit &hit, float t_max = std::numeric_limits<float>::max());
+
+///<summary>
+///Same, with t in [t_min, t_max]. Walking every triangle along one ray keeps its
+///origin and passes the next float after the last hit's t as t_min, so nothing
+///depends on a distance epsilon or on moving the origin.
+///</summary>
+bool intersectRay(const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, BVHHit &hit, float t_min, float t_max);
+
+///<summary>
+///True as soon as any triangle is hit by the ray with t in [t_min, t_max], which
+///is all shadow and occlusion queries need: no closest hit, no child ordering.
+///</summary>
+bool occludesRay(const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, float t_min, float t_max);
+
+///<summary>
+///Closest point of the mesh to p within max_distance. Returns false when no triangle is that close.
+///</summary>
+bool findNearestPoint(const MeshBVH &bvh, const glm::vec3 &p, BVHNearest &nearest, float max_distance = std::numeric_limits<float>::max());
+
+///<summary>
+///Fills triangles with the ids of the triangles whose bounds overlap the box
+///[min, max] and returns their count.
+///</summary>
+size_t queryBox(const MeshBVH &bvh, const glm::vec3 &min, const glm::vec3 &max, std::vector<uint32_t> &triangles);
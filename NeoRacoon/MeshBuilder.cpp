@@ -0,0 +1,190 @@
+#include "MeshBuilder.h"
+
+#include <stdexcept>
+#include <atomic>
+
+#include "Parallel.h"
+
+
+uint64_t meshbuilder_internal::MeshBuilder_edge_key(int v0, int v1)
+{
+	uint32_t lo = static_cast<uint32_t>(std::min(v0, v1));
+	uint32_t hi = static_cast<uint32_t>(std::max(v0, v1));
+	return (static_cast<uint64_t>(lo) << 32) | hi;
+}
+
+
+void meshbuilder_internal::MeshBuilder_check_input(const std::vector<Vertex> &positions, const std::vector<int> &face_indices, const std::vector<int> &face_offsets)
+{
+	if (face_offsets.empty())
+		throw std::invalid_argument("face_offsets must contain at least one entry.");
+	if (face_offsets.front() != 0 || face_offsets.back() != static_cast<int>(face_indices.size()))
+		throw std::invalid_argument("face_offsets does not cover face_indices.");
+
+	const size_t nb_faces = face_offsets.size() - 1;
+	const int nb_vertices = static_cast<int>(positions.size());
+	std::atomic<bool> bad_face(false), bad_index(false);
+
+	parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t f = first; f < last; ++f)
+		{
+			if (face_offsets[f + 1] - face_offsets[f] < 3)
+			{
+				bad_face = true;
+				return;
+			}
+
+			for (int i = face_offsets[f]; i < face_offsets[f + 1]; ++i)
+			{
+				if (face_indices[i] < 0 || face_indices[i] >= nb_vertices)
+				{
+					bad_index = true;
+					return;
+				}
+			}
+		}
+	});
+
+	if (bad_face)
+		throw std::invalid_argument("A face has less than 3 vertices.");
+	if (bad_index)
+		throw std::invalid_argument("A face references a vertex out of range.");
+}
+
+
+Mesh buildMesh(const std::vector<Vertex> &positions, const std::vector<int> &face_indices, const std::vector<int> &face_offsets, MeshBuildStats *stats)
+{
+	using namespace meshbuilder_internal;
+
+	MeshBuilder_check_input(positions, face_indices, face_offsets);
+
+	const size_t nb_faces = face_offsets.size() - 1;
+	const size_t nb_half_edges = face_indices.size();
+
+	// One key per half-edge: half-edge h goes from face_indices[h] to the next vertex of its face
+	std::vector<uint64_t> keys(nb_half_edges);
+	std::vector<uint32_t> half_edges(nb_half_edges);
+	std::vector<int> half_edge_end(nb_half_edges);
+
+	parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t f = first; f < last; ++f)
+		{
+			int begin = face_offsets[f], end = face_offsets[f + 1];
+			for (int h = begin; h < end; ++h)
+			{
+				int next = (h + 1 == end) ? begin : h + 1;
+				half_edge_end[h] = face_indices[next];
+				keys[h] = MeshBuilder_edge_key(face_indices[h], face_indices[next]);
+				half_edges[h] = static_cast<uint32_t>(h);
+			}
+		}
+	}, 1024);
+
+	parallel::radixSort(keys, half_edges);
+
+	// Number the runs of equal keys: each run is one unique edge
+	const size_t grain = 1 << 14;
+	const size_t nb_blocks = parallel::blockCount(nb_half_edges, grain);
+	std::vector<size_t> block_edges(nb_blocks + 1, 0);
+
+	parallel::parallelFor(0, nb_half_edges, [&](size_t first, size_t last, unsigned int block)
+	{
+		size_t count = 0;
+		for (size_t i = first; i < last; ++i)
+		{
+			if (i == 0 || keys[i] != keys[i - 1])
+				++count;
+		}
+		block_edges[block + 1] = count;
+	}, grain);
+
+	for (size_t b = 0; b < nb_blocks; ++b)
+		block_edges[b + 1] += block_edges[b];
+
+	Mesh ret;
+	ret.vertices = positions;
+	ret.edges.resize(block_edges[nb_blocks]);
+	std::vector<int> half_edge_to_edge(nb_half_edges);
+	std::vector<MeshBuildStats> block_stats(nb_blocks);
+
+	parallel::parallelFor(0, nb_half_edges, [&](size_t first, size_t last, unsigned int block)
+	{
+		// A block starting in the middle of a run keeps the id of that run
+		int edge_id = static_cast<int>(block_edges[block]) - 1;
+		MeshBuildStats &local = block_stats[block];
+
+		for (size_t i = first; i < last; ++i)
+		{
+			bool run_start = (i == 0 || keys[i] != keys[i - 1]);
+			if (run_start)
+				++edge_id;
+
+			half_edge_to_edge[half_edges[i]] = edge_id;
+
+			if (!run_start)
+				continue;
+
+			// The sort is stable, so the run starts with the lowest half-edge: keep its orientation
+			uint32_t h = half_edges[i];
+			ret.edges[edge_id] = Edge(face_indices[h], half_edge_end[h]);
+
+			size_t run_end = i + 1;
+			while (run_end < nb_half_edges && keys[run_end] == keys[i])
+				++run_end;
+
+			size_t run_length = run_end - i;
+			if (face_indices[h] == half_edge_end[h])
+				++local.degenerate_edges;
+			else if (run_length == 1)
+				++local.boundary_edges;
+			else if (run_length > 2)
+				++local.non_manifold_edges;
+			else if (face_indices[h] == face_indices[half_edges[i + 1]])
+				++local.flipped_edges;
+		}
+	}, grain);
+
+	ret.faces.resize(nb_faces);
+	parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t f = first; f < last; ++f)
+		{
+			Face &face = ret.faces[f];
+			face.vertices.assign(face_indices.begin() + face_offsets[f], face_indices.begin() + face_offsets[f + 1]);
+			face.edges.assign(half_edge_to_edge.begin() + face_offsets[f], half_edge_to_edge.begin() + face_offsets[f + 1]);
+		}
+	}, 1024);
+
+	if (stats)
+	{
+		*stats = MeshBuildStats();
+		for (auto it = block_stats.begin(); it != block_stats.end(); ++it)
+		{
+			stats->boundary_edges += it->boundary_edges;
+			stats->non_manifold_edges += it->non_manifold_edges;
+			stats->flipped_edges += it->flipped_edges;
+			stats->degenerate_edges += it->degenerate_edges;
+		}
+	}
+
+	return ret;
+}
+
+
+Mesh buildMesh(const std::vector<Vertex> &positions, const std::vector<std::vector<int>> &faces, MeshBuildStats *stats)
+{
+	std::vector<int> face_indices;
+	std::vector<int> face_offsets;
+	face_offsets.reserve(faces.size() + 1);
+	face_offsets.push_back(0);
+
+	for (auto it = faces.begin(); it != faces.end(); ++it)
+	{
+		face_indices.insert(face_indices.end(), it->begin(), it->end());
+		face_offsets.push_back(static_cast<int>(face_indices.size()));
+	}
+
+	return buildMesh(positions, face_indices, face_offsets, stats);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "MeshUtils.h"
+
+struct MeshBuildStats
+{
+	size_t boundary_edges; // edges used by a single face
+	size_t non_manifold_edges; // edges shared by more than two faces
+	size_t flipped_edges; // edges walked twice in the same direction
+	size_t degenerate_edges; // edges whose two ends are the same vertex
+
+	MeshBuildStats() : boundary_edges(0), non_manifold_edges(0), flipped_edges(0), degenerate_edges(0) {}
+
+	bool isManifold() const { return non_manifold_edges == 0 && degenerate_edges == 0; }
+
+	bool isClosed() const { return boundary_edges == 0; }
+
+	bool isOriented() const { return flipped_edges == 0; }
+};
+
+
+namespace meshbuilder_internal
+{
+	uint64_t MeshBuilder_edge_key(int v0, int v1);
+
+	void MeshBuilder_check_input(const std::vector<Vertex> &positions, const std::vector<int> &face_indices, const std::vector<int> &face_offsets);
+}
+
+///<summary>
+///Builds a Mesh from a polygon soup given as flat face-vertex indices.
+///Face i uses face_indices[face_offsets[i] .. face_offsets[i + 1]), so face_offsets
+///holds one more entry than there are faces. Vertices of a face must be given in loop order.
+///Unique edges are found by radix-sorting (min, max) vertex keys, and the face edges are
+///emitted in loop order as CatMull, Loops and Kobbelt expect.
+///Throws std::invalid_argument on out of range indices or faces with less than 3 vertices.
+///</summary>
+Mesh buildMesh(const std::vector<Vertex> &positions, const std::vector<int> &face_indices, const std::vector<int> &face_offsets, MeshBuildStats *stats = nullptr);
+
+Mesh buildMesh(const std::vector<Vertex> &positions, const std::vector<std::vector<int>> &faces, MeshBuildStats *stats = nullptr);
@@ -0,0 +1,411 @@
+#include "MeshCodec.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#include "MappedFile.h"
+#include "MeshIO.h"
+#include "Parallel.h"
+
+
+void meshcodec_internal::MeshCodec_put_varint(std::vector<uint8_t> &out, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back(static_cast<uint8_t>(v | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<uint8_t>(v));
+}
+
+const uint8_t *meshcodec_internal::MeshCodec_get_varint(const uint8_t *p, const uint8_t *end, uint64_t &v)
+{
+	// Fast path for the single byte values that make up most of the stream
+	if (p < end && *p < 0x80)
+	{
+		v = *p;
+		return p + 1;
+	}
+
+	v = 0;
+	for (unsigned int shift = 0; p < end && shift < 64; shift += 7)
+	{
+		uint8_t b = *p++;
+		v |= static_cast<uint64_t>(b & 0x7F) << shift;
+		if (b < 0x80)
+			return p;
+	}
+
+	return nullptr;
+}
+
+uint64_t meshcodec_internal::MeshCodec_zigzag(int64_t v)
+{
+	return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t meshcodec_internal::MeshCodec_unzigzag(uint64_t v)
+{
+	return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+void meshcodec_internal::MeshCodec_predict(const int64_t *quantized, const int *loop, const bool *known, size_t n, size_t i, const int64_t *last, int64_t *out)
+{
+	if (n == 4)
+	{
+		size_t prev = (i + 3) % 4, next = (i + 1) % 4, opp = (i + 2) % 4;
+		if (known[prev] && known[next] && known[opp])
+		{
+			for (int k = 0; k < 3; ++k)
+				out[k] = quantized[loop[prev] * 3 + k] + quantized[loop[next] * 3 + k] - quantized[loop[opp] * 3 + k];
+			return;
+		}
+	}
+
+	int64_t sum[3] = { 0, 0, 0 };
+	int64_t count = 0;
+	for (size_t j = 0; j < n; ++j)
+	{
+		if (j == i || !known[j])
+			continue;
+		for (int k = 0; k < 3; ++k)
+			sum[k] += quantized[loop[j] * 3 + k];
+		++count;
+	}
+
+	for (int k = 0; k < 3; ++k)
+		out[k] = count ? sum[k] / count : last[k];
+}
+
+
+std::vector<uint8_t> encodeMesh(const Mesh &mesh, int position_bits)
+{
+	using namespace meshcodec_internal;
+
+	if (position_bits < 1 || position_bits > 24)
+		throw std::invalid_argument("position_bits must be between 1 and 24.");
+
+	const size_t nb_vertices = mesh.vertices.size();
+	const size_t nb_faces = mesh.faces.size();
+
+	std::vector<std::vector<int>> loops(nb_faces);
+	parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t f = first; f < last; ++f)
+			loops[f] = mesh.getFaceLoop(static_cast<int>(f));
+	}, 1024);
+
+	MeshCodecHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESHCODEC_MAGIC, sizeof(MESHCODEC_MAGIC));
+	header.version = MESHCODEC_VERSION;
+	header.position_bits = position_bits;
+	header.nb_vertices = nb_vertices;
+	header.nb_faces = nb_faces;
+
+	// Quantize on the bounding box
+	for (int k = 0; k < 3; ++k)
+	{
+		header.bbox_min[k] = nb_vertices ? (&mesh.vertices[0].x)[k] : 0.0f;
+		header.bbox_max[k] = header.bbox_min[k];
+	}
+	for (auto it = mesh.vertices.begin(); it != mesh.vertices.end(); ++it)
+	{
+		const float *p = &it->x;
+		for (int k = 0; k < 3; ++k)
+		{
+			header.bbox_min[k] = std::min(header.bbox_min[k], p[k]);
+			header.bbox_max[k] = std::max(header.bbox_max[k], p[k]);
+		}
+	}
+
+	const double max_q = static_cast<double>((1 << position_bits) - 1);
+	std::vector<int64_t> quantized(nb_vertices * 3);
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t v = first; v < last; ++v)
+		{
+			const float *p = &mesh.vertices[v].x;
+			for (int k = 0; k < 3; ++k)
+			{
+				double range = static_cast<double>(header.bbox_max[k]) - header.bbox_min[k];
+				quantized[v * 3 + k] = range > 0.0 ? static_cast<int64_t>(std::floor((p[k] - header.bbox_min[k]) / range * max_q + 0.5)) : 0;
+			}
+		}
+	});
+
+	// Face sizes, run-length coded
+	std::vector<uint8_t> face_sizes;
+	for (size_t f = 0; f < nb_faces;)
+	{
+		size_t run = 1;
+		while (f + run < nb_faces && loops[f + run].size() == loops[f].size())
+			++run;
+		MeshCodec_put_varint(face_sizes, run);
+		MeshCodec_put_varint(face_sizes, loops[f].size());
+		f += run;
+	}
+
+	// Connectivity and positions, in the order vertices are first used
+	std::vector<uint8_t> connectivity, positions;
+	connectivity.reserve(nb_faces * 4);
+	positions.reserve(nb_vertices * 6);
+
+	std::vector<int> new_id(nb_vertices, -1);
+	std::vector<int64_t> decoded_order(nb_vertices * 3);
+	int counter = 0;
+	int64_t last[3] = { 0, 0, 0 };
+	std::vector<int> renamed;
+	std::vector<char> known;
+
+	auto emitPosition = [&](int v, const int64_t *prediction)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			MeshCodec_put_varint(positions, MeshCodec_zigzag(quantized[v * 3 + k] - prediction[k]));
+			decoded_order[static_cast<size_t>(counter) * 3 + k] = quantized[v * 3 + k];
+			last[k] = quantized[v * 3 + k];
+		}
+		new_id[v] = counter++;
+	};
+
+	for (size_t f = 0; f < nb_faces; ++f)
+	{
+		const std::vector<int> &loop = loops[f];
+		const size_t n = loop.size();
+		renamed.resize(n);
+		known.resize(n);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			renamed[i] = new_id[loop[i]];
+			known[i] = renamed[i] >= 0;
+		}
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			int v = loop[i];
+			if (new_id[v] >= 0)
+			{
+				MeshCodec_put_varint(connectivity, static_cast<uint64_t>(counter - new_id[v]));
+				continue;
+			}
+
+			MeshCodec_put_varint(connectivity, 0);
+
+			int64_t prediction[3];
+			MeshCodec_predict(decoded_order.data(), renamed.data(), reinterpret_cast<const bool *>(known.data()), n, i, last, prediction);
+			emitPosition(v, prediction);
+
+			// Later slots of the same face referencing this vertex see it as known
+			for (size_t j = i; j < n; ++j)
+			{
+				if (loop[j] == v)
+				{
+					renamed[j] = new_id[v];
+					known[j] = 1;
+				}
+			}
+		}
+	}
+
+	// Vertices no face uses
+	for (size_t v = 0; v < nb_vertices; ++v)
+	{
+		if (new_id[v] < 0)
+			emitPosition(static_cast<int>(v), last);
+	}
+
+	header.face_sizes_bytes = face_sizes.size();
+	header.connectivity_bytes = connectivity.size();
+	header.positions_bytes = positions.size();
+
+	std::vector<uint8_t> ret(sizeof(header));
+	memcpy(ret.data(), &header, sizeof(header));
+	ret.insert(ret.end(), face_sizes.begin(), face_sizes.end());
+	ret.insert(ret.end(), connectivity.begin(), connectivity.end());
+	ret.insert(ret.end(), positions.begin(), positions.end());
+	return ret;
+}
+
+
+Mesh decodeMesh(const uint8_t *data, size_t size, MeshBuildStats *stats)
+{
+	using namespace meshcodec_internal;
+
+	MeshCodecHeader header;
+	if (size < sizeof(header))
+		throw std::runtime_error("Truncated compressed mesh");
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, MESHCODEC_MAGIC, sizeof(MESHCODEC_MAGIC)) != 0)
+		throw std::runtime_error("Not a compressed mesh");
+	if (header.version == 0 || header.version > MESHCODEC_VERSION)
+		throw std::runtime_error("Unsupported compressed mesh version " + std::to_string(header.version));
+	if (header.position_bits < 1 || header.position_bits > 24 || header.nb_vertices > INT32_MAX || header.nb_faces > INT32_MAX)
+		throw std::runtime_error("Corrupted compressed mesh header");
+	const uint64_t payload = size - sizeof(header);
+	if (header.face_sizes_bytes > payload || header.connectivity_bytes > payload || header.positions_bytes > payload
+		|| header.face_sizes_bytes + header.connectivity_bytes + header.positions_bytes > payload)
+		throw std::runtime_error("Truncated compressed mesh");
+
+	const uint8_t *p = data + sizeof(header);
+	const uint8_t *face_sizes_end = p + header.face_sizes_bytes;
+	const uint8_t *c = face_sizes_end;
+	const uint8_t *connectivity_end = c + header.connectivity_bytes;
+	const uint8_t *q = connectivity_end;
+	const uint8_t *positions_end = q + header.positions_bytes;
+
+	// Every face index takes at least one connectivity byte and every vertex three
+	// position bytes, which bounds the counts by the payload before anything is allocated
+	if (header.nb_faces > header.connectivity_bytes / 3 || header.nb_vertices > header.positions_bytes / 3)
+		throw std::runtime_error("Corrupted compressed mesh header");
+
+	const size_t nb_vertices = static_cast<size_t>(header.nb_vertices);
+	const size_t nb_faces = static_cast<size_t>(header.nb_faces);
+	const uint64_t max_indices = std::min<uint64_t>(header.connectivity_bytes, INT32_MAX);
+
+	std::vector<int> face_offsets;
+	face_offsets.reserve(nb_faces + 1);
+	face_offsets.push_back(0);
+	uint64_t nb_indices = 0;
+	while (p < face_sizes_end)
+	{
+		uint64_t run, n;
+		p = MeshCodec_get_varint(p, face_sizes_end, run);
+		if (p)
+			p = MeshCodec_get_varint(p, face_sizes_end, n);
+		if (!p || n < 3 || run > nb_faces - (face_offsets.size() - 1) || (run != 0 && n > (max_indices - nb_indices) / run))
+			throw std::runtime_error("Corrupted compressed mesh face sizes");
+		nb_indices += run * n;
+		for (uint64_t r = 0; r < run; ++r)
+			face_offsets.push_back(face_offsets.back() + static_cast<int>(n));
+	}
+	if (face_offsets.size() != nb_faces + 1)
+		throw std::runtime_error("Corrupted compressed mesh face sizes");
+
+	std::vector<int> face_indices(face_offsets.back());
+	std::vector<int64_t> quantized(nb_vertices * 3);
+	std::vector<char> known;
+	int64_t last[3] = { 0, 0, 0 };
+	int counter = 0;
+	const int64_t max_value = (int64_t(1) << header.position_bits) - 1;
+
+	// Decoded values stay in the quantization range, which keeps every later
+	// prediction far from overflowing; the sum wraps instead of overflowing
+	auto readPosition = [&](const int64_t *prediction)
+	{
+		if (static_cast<size_t>(counter) >= nb_vertices)
+			throw std::runtime_error("Corrupted compressed mesh connectivity");
+		for (int k = 0; k < 3; ++k)
+		{
+			uint64_t residual;
+			q = MeshCodec_get_varint(q, positions_end, residual);
+			if (!q)
+				throw std::runtime_error("Corrupted compressed mesh positions");
+			const int64_t value = static_cast<int64_t>(static_cast<uint64_t>(prediction[k]) + static_cast<uint64_t>(MeshCodec_unzigzag(residual)));
+			if (value < 0 || value > max_value)
+				throw std::runtime_error("Corrupted compressed mesh positions");
+			last[k] = quantized[static_cast<size_t>(counter) * 3 + k] = value;
+		}
+		++counter;
+	};
+
+	for (size_t f = 0; f < nb_faces; ++f)
+	{
+		int *loop = face_indices.data() + face_offsets[f];
+		const size_t n = static_cast<size_t>(face_offsets[f + 1] - face_offsets[f]);
+		known.resize(n);
+
+		// Resolve the whole loop first: only vertices decoded before this face are known
+		int next = counter;
+		bool has_new = false;
+		for (size_t i = 0; i < n; ++i)
+		{
+			uint64_t s;
+			c = MeshCodec_get_varint(c, connectivity_end, s);
+			if (!c || s > static_cast<uint64_t>(next))
+				throw std::runtime_error("Corrupted compressed mesh connectivity");
+
+			loop[i] = s == 0 ? next++ : next - static_cast<int>(s);
+			known[i] = loop[i] < counter;
+			has_new |= s == 0;
+		}
+
+		if (!has_new)
+			continue;
+
+		// New vertices, with the same prediction context the encoder had
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (loop[i] != counter)
+				continue;
+
+			int64_t prediction[3];
+			MeshCodec_predict(quantized.data(), loop, reinterpret_cast<const bool *>(known.data()), n, i, last, prediction);
+			readPosition(prediction);
+
+			for (size_t j = i; j < n; ++j)
+			{
+				if (loop[j] == loop[i])
+					known[j] = 1;
+			}
+		}
+	}
+
+	while (static_cast<size_t>(counter) < nb_vertices)
+		readPosition(last);
+
+	// Dequantize
+	std::vector<Vertex> vertices(nb_vertices);
+	const double max_q = static_cast<double>((1 << header.position_bits) - 1);
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last_v, unsigned int)
+	{
+		for (size_t v = first; v < last_v; ++v)
+		{
+			float *out = &vertices[v].x;
+			for (int k = 0; k < 3; ++k)
+			{
+				double range = static_cast<double>(header.bbox_max[k]) - header.bbox_min[k];
+				out[k] = static_cast<float>(header.bbox_min[k] + quantized[v * 3 + k] * (range / max_q));
+			}
+		}
+	});
+
+	Mesh ret;
+	try
+	{
+		ret = buildMesh(vertices, face_indices, face_offsets, stats);
+	}
+	catch (const std::invalid_argument &e)
+	{
+		throw std::runtime_error(std::string("Corrupted compressed mesh: ") + e.what());
+	}
+
+	meshio_internal::MeshIO_validate(ret, "Invalid compressed mesh: ");
+	return ret;
+}
+
+
+void saveCompressedMesh(const Mesh &mesh, const std::string &path, int position_bits)
+{
+	std::vector<uint8_t> data = encodeMesh(mesh, position_bits);
+	meshio_internal::FileWriter out(path);
+	out.write(data.data(), data.size());
+	out.close();
+}
+
+Mesh loadCompressedMesh(const std::string &path, MeshBuildStats *stats)
+{
+	MappedFile file(path);
+	try
+	{
+		return decodeMesh(reinterpret_cast<const uint8_t *>(file.data()), file.size(), stats);
+	}
+	catch (const std::runtime_error &e)
+	{
+		throw std::runtime_error(std::string(e.what()) + ": " + path);
+	}
+}
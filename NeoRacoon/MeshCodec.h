@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "MeshUtils.h"
+#include "MeshBuilder.h"
+
+
+// Compressed mesh stream (.rmc). Edges are not stored: they are rebuilt from the
+// faces on decode. Vertices are renumbered in order of first use by the faces so
+// that connectivity becomes "new vertex" symbols plus short back references, and
+// positions are quantized on the bounding box and coded as the residual of a
+// prediction made from the already decoded vertices of the same face.
+
+const char MESHCODEC_MAGIC[8] = { 'R', 'A', 'C', 'M', 'C', 'M', 'P', '\0' };
+const uint32_t MESHCODEC_VERSION = 1;
+
+struct MeshCodecHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t position_bits;
+	uint64_t nb_vertices;
+	uint64_t nb_faces;
+	float bbox_min[3];
+	float bbox_max[3];
+	uint64_t face_sizes_bytes;
+	uint64_t connectivity_bytes;
+	uint64_t positions_bytes;
+};
+
+
+namespace meshcodec_internal
+{
+	void MeshCodec_put_varint(std::vector<uint8_t> &out, uint64_t v);
+
+	const uint8_t *MeshCodec_get_varint(const uint8_t *p, const uint8_t *end, uint64_t &v);
+
+	uint64_t MeshCodec_zigzag(int64_t v);
+
+	int64_t MeshCodec_unzigzag(uint64_t v);
+
+	///<summary>
+	///Prediction of vertex slot i of a face from its other, already known, slots:
+	///parallelogram rule when the two neighbours and the opposite corner of a quad
+	///are known, else the mean of the known slots, else the last decoded vertex.
+	///</summary>
+	void MeshCodec_predict(const int64_t *quantized, const int *loop, const bool *known, size_t n, size_t i, const int64_t *last, int64_t *out);
+}
+
+///<summary>
+///Encodes a Mesh, positions quantized on position_bits bits per axis (1 to 24).
+///Vertex and edge order are not preserved, the topology is.
+///</summary>
+std::vector<uint8_t> encodeMesh(const Mesh &mesh, int position_bits = 16);
+
+///<summary>
+///Decodes a stream made by encodeMesh. Throws std::runtime_error on malformed data
+///and on meshes that fail validateMesh.
+///</summary>
+Mesh decodeMesh(const uint8_t *data, size_t size, MeshBuildStats *stats = nullptr);
+
+inline Mesh decodeMesh(const std::vector<uint8_t> &data, MeshBuildStats *stats = nullptr) { return decodeMesh(data.data(), data.size(), stats); }
+
+void saveCompressedMesh(const Mesh &mesh, const std::string &path, int position_bits = 16);
+
+Mesh loadCompressedMesh(const std::string &path, MeshBuildStats *stats = nullptr);
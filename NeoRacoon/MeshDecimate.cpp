@@ -0,0 +1,448 @@
+#include "MeshDecimate.h"
+
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <cmath>
+
+#include "MeshBuilder.h"
+#include "Parallel.h"
+#include "PointLayout.h"
+
+
+meshdecimate_internal::Quadric &meshdecimate_internal::Quadric::operator+=(const Quadric &q)
+{
+	a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+	b2 += q.b2; bc += q.bc; bd += q.bd;
+	c2 += q.c2; cd += q.cd;
+	d2 += q.d2;
+	weight += q.weight;
+	return *this;
+}
+
+double meshdecimate_internal::Quadric::evaluate(const glm::dvec3 &p) const
+{
+	const double x = p.x, y = p.y, z = p.z;
+	return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+		+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+		+ c2 * z * z + 2 * cd * z
+		+ d2;
+}
+
+meshdecimate_internal::Quadric meshdecimate_internal::MeshDecimate_plane(const glm::dvec3 &n, double d, double weight)
+{
+	Quadric q;
+	q.a2 = weight * n.x * n.x; q.ab = weight * n.x * n.y; q.ac = weight * n.x * n.z; q.ad = weight * n.x * d;
+	q.b2 = weight * n.y * n.y; q.bc = weight * n.y * n.z; q.bd = weight * n.y * d;
+	q.c2 = weight * n.z * n.z; q.cd = weight * n.z * d;
+	q.d2 = weight * d * d;
+	q.weight = weight;
+	return q;
+}
+
+bool meshdecimate_internal::MeshDecimate_optimum(const Quadric &q, glm::dvec3 &p)
+{
+	// Cramer's rule on the 3x3 block, singular when its determinant is tiny
+	// next to the scale of the quadric
+	const double det = q.a2 * (q.b2 * q.c2 - q.bc * q.bc) - q.ab * (q.ab * q.c2 - q.bc * q.ac) + q.ac * (q.ab * q.bc - q.b2 * q.ac);
+	const double trace = q.a2 + q.b2 + q.c2;
+	if (std::fabs(det) <= 1e-9 * trace * trace * trace)
+		return false;
+
+	const double bx = -q.ad, by = -q.bd, bz = -q.cd;
+	p.x = (bx * (q.b2 * q.c2 - q.bc * q.bc) - q.ab * (by * q.c2 - q.bc * bz) + q.ac * (by * q.bc - q.b2 * bz)) / det;
+	p.y = (q.a2 * (by * q.c2 - q.bc * bz) - bx * (q.ab * q.c2 - q.bc * q.ac) + q.ac * (q.ab * bz - by * q.ac)) / det;
+	p.z = (q.a2 * (q.b2 * bz - by * q.bc) - q.ab * (q.ab * bz - by * q.ac) + bx * (q.ab * q.bc - q.b2 * q.ac)) / det;
+	return true;
+}
+
+
+namespace meshdecimate_internal
+{
+	const double BOUNDARY_WEIGHT = 10.0;
+
+	// A queued collapse of v1 into v0, stale once either vertex changed since
+	struct Collapse
+	{
+		float cost; // mean squared distance
+		uint32_t v0, v1;
+		uint32_t stamp0, stamp1;
+		glm::vec3 position;
+	};
+
+	struct CollapseOrder
+	{
+		bool operator()(const Collapse &a, const Collapse &b) const { return a.cost > b.cost; }
+	};
+
+	struct Decimator
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> triangles; // 3 vertex ids per triangle
+		std::vector<char> removed_triangles, removed_vertices;
+		std::vector<char> boundary; // vertices on an open border
+		std::vector<std::vector<uint32_t>> fans; // triangles around each vertex, removed ones dropped lazily
+		std::vector<Quadric> quadrics;
+		std::vector<uint32_t> stamps;
+		size_t live_triangles;
+
+		glm::dvec3 position(uint32_t v) const { return glm::dvec3(positions[v]); }
+
+		glm::dvec3 normal(uint32_t t) const
+		{
+			const uint32_t *id = &triangles[t * 3];
+			return glm::cross(position(id[1]) - position(id[0]), position(id[2]) - position(id[0]));
+		}
+
+		const std::vector<uint32_t> &fan(uint32_t v)
+		{
+			std::vector<uint32_t> &f = fans[v];
+			f.erase(std::remove_if(f.begin(), f.end(), [this](uint32_t t) { return removed_triangles[t] != 0; }), f.end());
+			return f;
+		}
+
+		void neighbours(uint32_t v, std::vector<uint32_t> &out)
+		{
+			out.clear();
+			const std::vector<uint32_t> &f = fan(v);
+			for (auto it = f.begin(); it != f.end(); ++it)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					if (triangles[*it * 3 + k] != v)
+						out.push_back(triangles[*it * 3 + k]);
+				}
+			}
+			std::sort(out.begin(), out.end());
+			out.erase(std::unique(out.begin(), out.end()), out.end());
+		}
+
+		Collapse candidate(uint32_t v0, uint32_t v1) const
+		{
+			Quadric q = quadrics[v0];
+			q += quadrics[v1];
+
+			const glm::dvec3 p0 = position(v0), p1 = position(v1), mid = (p0 + p1) * 0.5;
+			glm::dvec3 best = mid;
+			double cost = q.evaluate(mid);
+
+			// The optimum is only trusted near the edge, ill conditioned quadrics throw it far away
+			glm::dvec3 p;
+			if (MeshDecimate_optimum(q, p) && glm::length(p - mid) <= glm::length(p1 - p0) * 2.0)
+			{
+				best = p;
+				cost = q.evaluate(p);
+			}
+			else
+			{
+				double c0 = q.evaluate(p0), c1 = q.evaluate(p1);
+				if (c0 < cost) { best = p0; cost = c0; }
+				if (c1 < cost) { best = p1; cost = c1; }
+			}
+
+			Collapse c;
+			c.cost = static_cast<float>(q.weight > 0.0 ? std::max(0.0, cost) / q.weight : 0.0);
+			c.v0 = v0;
+			c.v1 = v1;
+			c.stamp0 = stamps[v0];
+			c.stamp1 = stamps[v1];
+			c.position = glm::vec3(best);
+			return c;
+		}
+
+		bool isStale(const Collapse &c) const
+		{
+			return removed_vertices[c.v0] || removed_vertices[c.v1] || stamps[c.v0] != c.stamp0 || stamps[c.v1] != c.stamp1;
+		}
+
+		bool hasVertex(uint32_t t, uint32_t v) const
+		{
+			return triangles[t * 3] == v || triangles[t * 3 + 1] == v || triangles[t * 3 + 2] == v;
+		}
+
+		// A collapse keeps the surface manifold when the two ends share no
+		// neighbour other than the opposite vertices of the edge triangles
+		bool keepsManifold(uint32_t v0, uint32_t v1, size_t nb_shared, std::vector<uint32_t> &n0, std::vector<uint32_t> &n1)
+		{
+			neighbours(v0, n0);
+			neighbours(v1, n1);
+			size_t common = 0;
+			for (auto a = n0.begin(), b = n1.begin(); a != n0.end() && b != n1.end();)
+			{
+				if (*a < *b)
+					++a;
+				else if (*b < *a)
+					++b;
+				else
+				{
+					++common;
+					++a;
+					++b;
+				}
+			}
+			return common == nb_shared;
+		}
+
+		bool flips(uint32_t v, uint32_t other, const glm::dvec3 &p)
+		{
+			const std::vector<uint32_t> &f = fan(v);
+			for (auto it = f.begin(); it != f.end(); ++it)
+			{
+				uint32_t t = *it;
+				if (hasVertex(t, other))
+					continue;
+
+				glm::dvec3 corners[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t id = triangles[t * 3 + k];
+					corners[k] = id == v ? p : position(id);
+				}
+				glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				if (glm::dot(after, normal(t)) <= 0.0)
+					return true;
+			}
+			return false;
+		}
+
+		bool collapse(const Collapse &c, std::vector<uint32_t> &n0, std::vector<uint32_t> &n1)
+		{
+			const uint32_t v0 = c.v0, v1 = c.v1;
+
+			size_t nb_shared = 0;
+			const std::vector<uint32_t> &f1 = fan(v1);
+			for (auto it = f1.begin(); it != f1.end(); ++it)
+				nb_shared += hasVertex(*it, v0) ? 1 : 0;
+			fan(v0);
+
+			const glm::dvec3 p(c.position);
+			// An inner edge between two borders would pinch the surface
+			if (nb_shared == 2 && boundary[v0] && boundary[v1])
+				return false;
+			if (nb_shared == 0 || !keepsManifold(v0, v1, nb_shared, n0, n1) || flips(v0, v1, p) || flips(v1, v0, p))
+				return false;
+
+			positions[v0] = c.position;
+			quadrics[v0] += quadrics[v1];
+			boundary[v0] |= boundary[v1];
+			for (auto it = fans[v1].begin(); it != fans[v1].end(); ++it)
+			{
+				uint32_t t = *it;
+				if (hasVertex(t, v0))
+				{
+					removed_triangles[t] = 1;
+					--live_triangles;
+					continue;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					if (triangles[t * 3 + k] == v1)
+						triangles[t * 3 + k] = v0;
+				}
+				fans[v0].push_back(t);
+			}
+
+			fans[v1].clear();
+			fans[v1].shrink_to_fit();
+			removed_vertices[v1] = 1;
+			++stamps[v0];
+			return true;
+		}
+	};
+
+	void setup(Decimator &d, const Mesh &mesh)
+	{
+		const size_t nb_vertices = mesh.vertices.size();
+		copyPoints(mesh.vertices, d.positions);
+
+		std::vector<int> loop;
+		for (size_t f = 0; f < mesh.faces.size(); ++f)
+		{
+			mesh.getFaceLoop(static_cast<int>(f), loop);
+			for (size_t i = 1; i + 1 < loop.size(); ++i)
+			{
+				d.triangles.push_back(loop[0]);
+				d.triangles.push_back(loop[i]);
+				d.triangles.push_back(loop[i + 1]);
+			}
+		}
+
+		const size_t nb_triangles = d.triangles.size() / 3;
+		d.live_triangles = nb_triangles;
+		d.removed_triangles.assign(nb_triangles, 0);
+		d.removed_vertices.assign(nb_vertices, 0);
+		d.boundary.assign(nb_vertices, 0);
+		d.stamps.assign(nb_vertices, 0);
+		d.fans.resize(nb_vertices);
+		for (size_t t = 0; t < nb_triangles; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+				d.fans[d.triangles[t * 3 + k]].push_back(static_cast<uint32_t>(t));
+		}
+
+		// Area weighted plane of every triangle, gathered per vertex
+		std::vector<Quadric> planes(nb_triangles);
+		parallel::parallelFor(0, nb_triangles, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t t = first; t < last; ++t)
+			{
+				glm::dvec3 n = d.normal(static_cast<uint32_t>(t));
+				double l = glm::length(n);
+				if (l <= 0.0)
+					continue;
+				n /= l;
+				planes[t] = MeshDecimate_plane(n, -glm::dot(n, d.position(d.triangles[t * 3])), l * 0.5);
+			}
+		});
+
+		d.quadrics.resize(nb_vertices);
+		parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t v = first; v < last; ++v)
+			{
+				for (auto it = d.fans[v].begin(); it != d.fans[v].end(); ++it)
+					d.quadrics[v] += planes[*it];
+			}
+		});
+	}
+}
+
+
+Mesh decimateMesh(const Mesh &mesh, size_t target_triangles, float max_error, MeshDecimateStats *stats)
+{
+	using namespace meshdecimate_internal;
+
+	Decimator d;
+	setup(d, mesh);
+	const size_t nb_triangles = d.triangles.size() / 3;
+
+	// Unique edges, from the triangle half-edges sorted by key
+	std::vector<uint64_t> keys(nb_triangles * 3);
+	std::vector<uint32_t> half_edges(keys.size());
+	for (size_t h = 0; h < keys.size(); ++h)
+	{
+		size_t next = h % 3 == 2 ? h - 2 : h + 1;
+		keys[h] = meshbuilder_internal::MeshBuilder_edge_key(d.triangles[h], d.triangles[next]);
+		half_edges[h] = static_cast<uint32_t>(h);
+	}
+	parallel::radixSort(keys, half_edges);
+
+	std::vector<uint32_t> edges; // first half-edge of every unique edge
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		if (i > 0 && keys[i] == keys[i - 1])
+			continue;
+		edges.push_back(half_edges[i]);
+
+		// Boundary edge: hold it with a plane through it, perpendicular to its triangle
+		if (i + 1 < keys.size() && keys[i + 1] == keys[i])
+			continue;
+		uint32_t h = half_edges[i];
+		uint32_t a = d.triangles[h], b = d.triangles[h % 3 == 2 ? h - 2 : h + 1];
+		glm::dvec3 e = d.position(b) - d.position(a);
+		d.boundary[a] = d.boundary[b] = 1;
+		glm::dvec3 n = glm::cross(e, d.normal(h / 3));
+		double l = glm::length(n);
+		if (l <= 0.0)
+			continue;
+		n /= l;
+		Quadric q = MeshDecimate_plane(n, -glm::dot(n, d.position(a)), BOUNDARY_WEIGHT * glm::dot(e, e));
+		d.quadrics[a] += q;
+		d.quadrics[b] += q;
+	}
+
+	std::vector<Collapse> queue(edges.size());
+	parallel::parallelFor(0, edges.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			uint32_t h = edges[i];
+			queue[i] = d.candidate(d.triangles[h], d.triangles[h % 3 == 2 ? h - 2 : h + 1]);
+		}
+	});
+	std::priority_queue<Collapse, std::vector<Collapse>, CollapseOrder> heap(CollapseOrder(), std::move(queue));
+
+	MeshDecimateStats local;
+	const float max_cost = max_error < std::sqrt(std::numeric_limits<float>::max()) ? max_error * max_error : std::numeric_limits<float>::max();
+	std::vector<uint32_t> n0, n1;
+	float worst = 0.0f;
+
+	while (d.live_triangles > target_triangles && !heap.empty())
+	{
+		Collapse c = heap.top();
+		if (c.cost > max_cost)
+			break;
+		heap.pop();
+
+		if (d.isStale(c))
+			continue;
+		if (!d.collapse(c, n0, n1))
+		{
+			++local.rejected;
+			continue;
+		}
+
+		++local.collapses;
+		worst = std::max(worst, c.cost);
+
+		d.neighbours(c.v0, n0);
+		for (auto it = n0.begin(); it != n0.end(); ++it)
+			heap.push(d.candidate(c.v0, *it));
+	}
+
+	// Compact the surviving vertices in their original order
+	std::vector<int> remap(d.positions.size(), -1);
+	std::vector<Vertex> positions;
+	std::vector<int> face_indices, face_offsets(1, 0);
+	face_indices.reserve(d.live_triangles * 3);
+	for (size_t t = 0; t < nb_triangles; ++t)
+	{
+		if (d.removed_triangles[t])
+			continue;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = d.triangles[t * 3 + k];
+			if (remap[v] < 0)
+			{
+				remap[v] = static_cast<int>(positions.size());
+				positions.push_back(viewPoints<Vertex>(d.positions)[v]);
+			}
+			face_indices.push_back(remap[v]);
+		}
+		face_offsets.push_back(static_cast<int>(face_indices.size()));
+	}
+
+	if (stats)
+	{
+		local.error = std::sqrt(worst);
+		*stats = local;
+	}
+
+	return buildMesh(positions, face_indices, face_offsets);
+}
+
+
+std::vector<Mesh> buildLODChain(const Mesh &mesh, size_t levels, float ratio, float max_error)
+{
+	if (!(ratio > 0.0f && ratio < 1.0f))
+		throw std::invalid_argument("buildLODChain: ratio must be in (0, 1)");
+
+	size_t nb_triangles = 0;
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+		nb_triangles += std::max<size_t>(mesh.faces[f].edges.size(), 2) - 2;
+
+	std::vector<Mesh> ret;
+	ret.reserve(levels);
+	for (size_t level = 0; level < levels; ++level)
+	{
+		size_t target = static_cast<size_t>(nb_triangles * ratio);
+		Mesh lod = decimateMesh(level == 0 ? mesh : ret.back(), target, max_error);
+		if (lod.faces.size() >= nb_triangles)
+			break;
+
+		nb_triangles = lod.faces.size();
+		ret.push_back(std::move(lod));
+	}
+
+	return ret;
+}
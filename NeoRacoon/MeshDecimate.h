@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+
+
+// Quadric error edge collapse (Garland and Heckbert). Faces are fan
+// triangulated, so the simplified meshes are made of triangles, which Loops and
+// Kobbelt take directly and CatMull turns back into quads.
+
+struct MeshDecimateStats
+{
+	size_t collapses;
+	size_t rejected; // collapses that would have flipped a triangle or pinched the surface
+	float error; // largest collapse error, as a distance in mesh units
+
+	MeshDecimateStats() : collapses(0), rejected(0), error(0.0f) {}
+};
+
+
+namespace meshdecimate_internal
+{
+	///<summary>
+	///Symmetric 4x4 quadric, upper triangle only, with the weight it was built
+	///from so that errors can be read back as mean squared distances.
+	///</summary>
+	struct Quadric
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+
+		Quadric() : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0), weight(0) {}
+
+		Quadric &operator+=(const Quadric &q);
+
+		double evaluate(const glm::dvec3 &p) const;
+	};
+
+	// Quadric of the plane n.p + d = 0, n unit length
+	Quadric MeshDecimate_plane(const glm::dvec3 &n, double d, double weight);
+
+	// Point minimizing q, false when q is singular
+	bool MeshDecimate_optimum(const Quadric &q, glm::dvec3 &p);
+}
+
+
+///<summary>
+///Collapses edges by increasing quadric error until the mesh has at most
+///target_triangles triangles or the next collapse would move the surface by
+///more than max_error. Boundary edges are held by extra perpendicular planes.
+///Collapses that would flip a triangle or break the manifold are skipped.
+///</summary>
+Mesh decimateMesh(const Mesh &mesh, size_t target_triangles, float max_error = std::numeric_limits<float>::max(), MeshDecimateStats *stats = nullptr);
+
+///<summary>
+///levels meshes, each decimated from the previous one to ratio times its
+///triangle count, starting from mesh (which is not included). Stops early when
+///max_error prevents a level from getting smaller.
+///</summary>
+std::vector<Mesh> buildLODChain(const Mesh &mesh, size_t levels, float ratio = 0.5f, float max_error = std::numeric_limits<float>::max());
@@ -0,0 +1,334 @@
+#include "MeshFile.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+
+#include "MeshIO.h"
+#include "Parallel.h"
+
+
+namespace meshfile_internal
+{
+	const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+	const uint64_t FNV_PRIME = 1099511628211ULL;
+	const size_t HASH_BLOCK = 1 << 20;
+
+	uint64_t hashWords(const char *data, size_t size)
+	{
+		uint64_t h = FNV_OFFSET;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t w;
+			memcpy(&w, data + i, 8);
+			h = (h ^ w) * FNV_PRIME;
+		}
+		for (; i < size; ++i)
+			h = (h ^ static_cast<uint8_t>(data[i])) * FNV_PRIME;
+		return h;
+	}
+
+	uint64_t combine(uint64_t h, uint64_t v)
+	{
+		return (h ^ v) * FNV_PRIME;
+	}
+
+	uint64_t align(uint64_t offset)
+	{
+		return (offset + MESHFILE_ALIGNMENT - 1) / MESHFILE_ALIGNMENT * MESHFILE_ALIGNMENT;
+	}
+}
+
+
+// FNV-1a over 8-byte words, per 1 MiB block in parallel, then over the block hashes.
+// The block size is fixed so the result does not depend on the thread count.
+uint64_t meshfile_internal::MeshFile_hash(const char *data, size_t size)
+{
+	const size_t nb_blocks = (size + HASH_BLOCK - 1) / HASH_BLOCK;
+	std::vector<uint64_t> blocks(nb_blocks);
+
+	parallel::parallelFor(0, nb_blocks, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t b = first; b < last; ++b)
+			blocks[b] = hashWords(data + b * HASH_BLOCK, std::min(HASH_BLOCK, size - b * HASH_BLOCK));
+	}, 1);
+
+	uint64_t h = combine(FNV_OFFSET, size);
+	for (auto it = blocks.begin(); it != blocks.end(); ++it)
+		h = combine(h, *it);
+	return h;
+}
+
+uint64_t meshfile_internal::MeshFile_checksum(const char *base, const MeshFileHeader &header)
+{
+	uint64_t h = FNV_OFFSET;
+	for (int s = 0; s < MeshFile_section_count(header.version); ++s)
+		h = combine(h, MeshFile_hash(base + header.offsets[s], static_cast<size_t>(header.sizes[s])));
+	return h;
+}
+
+int meshfile_internal::MeshFile_section_count(uint32_t version)
+{
+	return version < 2 ? MESHFILE_V1_SECTION_COUNT : MESHFILE_SECTION_COUNT;
+}
+
+void meshfile_internal::MeshFile_read_header(const char *data, size_t size, MeshFileHeader &header)
+{
+	const size_t fixed = offsetof(MeshFileHeader, offsets);
+	memset(&header, 0, sizeof(header));
+	if (size < fixed)
+		throw std::runtime_error("Truncated mesh file");
+	memcpy(&header, data, fixed);
+
+	if (header.version != 1)
+	{
+		// Current layout, other versions are rejected by MeshFile_check_header
+		if (size < sizeof(MeshFileHeader))
+			throw std::runtime_error("Truncated mesh file");
+		memcpy(&header, data, sizeof(MeshFileHeader));
+		return;
+	}
+
+	const size_t table = MESHFILE_V1_SECTION_COUNT * sizeof(uint64_t);
+	if (size < fixed + table * 2)
+		throw std::runtime_error("Truncated mesh file");
+	memcpy(header.offsets, data + fixed, table);
+	memcpy(header.sizes, data + fixed + table, table);
+}
+
+void meshfile_internal::MeshFile_check_header(const MeshFileHeader &header, size_t file_size)
+{
+	if (memcmp(header.magic, MESHFILE_MAGIC, sizeof(MESHFILE_MAGIC)) != 0)
+		throw std::runtime_error("Not a mesh file");
+	if (header.endian_tag != MESHFILE_ENDIAN_TAG)
+		throw std::runtime_error("Mesh file written with another byte order");
+	if (header.version == 0 || header.version > MESHFILE_VERSION)
+		throw std::runtime_error("Unsupported mesh file version " + std::to_string(header.version));
+
+	const uint64_t expected[MESHFILE_SECTION_COUNT] = {
+		header.nb_vertices * sizeof(Vertex),
+		header.nb_edges * sizeof(Edge),
+		(header.flags & MESHFILE_HAS_MESH) ? (header.nb_faces + 1) * sizeof(int) : 0,
+		header.nb_face_vertices * sizeof(int),
+		(header.flags & MESHFILE_HAS_MESH) ? (header.nb_faces + 1) * sizeof(int) : 0,
+		header.nb_face_edges * sizeof(int),
+		header.nb_render_vertices * 3 * sizeof(float),
+		header.nb_render_indices * header.render_index_size,
+		(header.flags & MESHFILE_HAS_NORMALS) ? header.nb_render_vertices * 3 * sizeof(float) : 0,
+		(header.flags & MESHFILE_HAS_OCCLUSION) ? header.nb_render_vertices * sizeof(float) : 0,
+		header.nb_render_line_indices * header.render_line_index_size
+	};
+
+	for (int s = 0; s < MESHFILE_SECTION_COUNT; ++s)
+	{
+		if (header.sizes[s] != expected[s])
+			throw std::runtime_error("Corrupted mesh file section sizes");
+		if (header.offsets[s] % MESHFILE_ALIGNMENT != 0 || header.offsets[s] > file_size || header.sizes[s] > file_size - header.offsets[s])
+			throw std::runtime_error("Truncated mesh file");
+	}
+}
+
+
+void saveMeshFile(const std::string &path, const Mesh *mesh, const RenderableMesh *renderable, bool checksum)
+{
+	using namespace meshfile_internal;
+	static_assert(sizeof(Vertex) == 3 * sizeof(float), "Vertex must be tightly packed");
+	static_assert(sizeof(Edge) == 2 * sizeof(int), "Edge must be tightly packed");
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MESHFILE_MAGIC, sizeof(MESHFILE_MAGIC));
+	header.version = MESHFILE_VERSION;
+	header.endian_tag = MESHFILE_ENDIAN_TAG;
+	header.render_index_size = renderable && renderable->hasWideIndices() ? sizeof(uint32_t) : sizeof(uint16_t);
+	header.render_line_index_size = renderable && renderable->hasWideLines() ? sizeof(uint32_t) : sizeof(uint16_t);
+
+	// Faces are flattened into offset + index arrays
+	std::vector<int> vertex_offsets, face_vertices, edge_offsets, face_edges;
+	if (mesh)
+	{
+		header.flags |= MESHFILE_HAS_MESH;
+		const size_t nb_faces = mesh->faces.size();
+		vertex_offsets.resize(nb_faces + 1, 0);
+		edge_offsets.resize(nb_faces + 1, 0);
+		for (size_t i = 0; i < nb_faces; ++i)
+		{
+			vertex_offsets[i + 1] = vertex_offsets[i] + static_cast<int>(mesh->faces[i].vertices.size());
+			edge_offsets[i + 1] = edge_offsets[i] + static_cast<int>(mesh->faces[i].edges.size());
+		}
+
+		face_vertices.resize(vertex_offsets.back());
+		face_edges.resize(edge_offsets.back());
+		parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				const Face &f = mesh->faces[i];
+				std::copy(f.vertices.begin(), f.vertices.end(), face_vertices.begin() + vertex_offsets[i]);
+				std::copy(f.edges.begin(), f.edges.end(), face_edges.begin() + edge_offsets[i]);
+			}
+		});
+
+		header.nb_vertices = mesh->vertices.size();
+		header.nb_edges = mesh->edges.size();
+		header.nb_faces = nb_faces;
+		header.nb_face_vertices = face_vertices.size();
+		header.nb_face_edges = face_edges.size();
+	}
+
+	if (renderable)
+	{
+		header.flags |= MESHFILE_HAS_RENDERABLE;
+		header.nb_render_vertices = renderable->vertices.size() / 3;
+		header.nb_render_indices = renderable->indexCount();
+		header.nb_render_line_indices = renderable->lineIndexCount();
+		// Attributes are only stored when complete
+		if (!renderable->normals.empty() && renderable->normals.size() == renderable->vertices.size())
+			header.flags |= MESHFILE_HAS_NORMALS;
+		if (!renderable->occlusion.empty() && renderable->occlusion.size() * 3 == renderable->vertices.size())
+			header.flags |= MESHFILE_HAS_OCCLUSION;
+	}
+
+	const char *sections[MESHFILE_SECTION_COUNT] = {
+		mesh ? reinterpret_cast<const char *>(mesh->vertices.data()) : nullptr,
+		mesh ? reinterpret_cast<const char *>(mesh->edges.data()) : nullptr,
+		reinterpret_cast<const char *>(vertex_offsets.data()),
+		reinterpret_cast<const char *>(face_vertices.data()),
+		reinterpret_cast<const char *>(edge_offsets.data()),
+		reinterpret_cast<const char *>(face_edges.data()),
+		renderable ? reinterpret_cast<const char *>(renderable->vertices.data()) : nullptr,
+		!renderable ? nullptr : renderable->hasWideIndices() ? reinterpret_cast<const char *>(renderable->indices32.data()) : reinterpret_cast<const char *>(renderable->indices.data()),
+		renderable ? reinterpret_cast<const char *>(renderable->normals.data()) : nullptr,
+		renderable ? reinterpret_cast<const char *>(renderable->occlusion.data()) : nullptr,
+		!renderable ? nullptr : renderable->hasWideLines() ? reinterpret_cast<const char *>(renderable->lines32.data()) : reinterpret_cast<const char *>(renderable->lines.data())
+	};
+
+	header.sizes[MESHFILE_VERTICES] = header.nb_vertices * sizeof(Vertex);
+	header.sizes[MESHFILE_EDGES] = header.nb_edges * sizeof(Edge);
+	header.sizes[MESHFILE_FACE_VERTEX_OFFSETS] = vertex_offsets.size() * sizeof(int);
+	header.sizes[MESHFILE_FACE_VERTICES] = face_vertices.size() * sizeof(int);
+	header.sizes[MESHFILE_FACE_EDGE_OFFSETS] = edge_offsets.size() * sizeof(int);
+	header.sizes[MESHFILE_FACE_EDGES] = face_edges.size() * sizeof(int);
+	header.sizes[MESHFILE_RENDER_VERTICES] = header.nb_render_vertices * 3 * sizeof(float);
+	header.sizes[MESHFILE_RENDER_INDICES] = header.nb_render_indices * header.render_index_size;
+	header.sizes[MESHFILE_RENDER_NORMALS] = (header.flags & MESHFILE_HAS_NORMALS) ? header.nb_render_vertices * 3 * sizeof(float) : 0;
+	header.sizes[MESHFILE_RENDER_OCCLUSION] = (header.flags & MESHFILE_HAS_OCCLUSION) ? header.nb_render_vertices * sizeof(float) : 0;
+	header.sizes[MESHFILE_RENDER_LINES] = header.nb_render_line_indices * header.render_line_index_size;
+
+	uint64_t offset = align(sizeof(MeshFileHeader));
+	for (int s = 0; s < MESHFILE_SECTION_COUNT; ++s)
+	{
+		header.offsets[s] = offset;
+		offset = align(offset + header.sizes[s]);
+	}
+
+	if (checksum)
+	{
+		header.flags |= MESHFILE_HAS_CHECKSUM;
+		uint64_t h = FNV_OFFSET;
+		for (int s = 0; s < MESHFILE_SECTION_COUNT; ++s)
+			h = combine(h, MeshFile_hash(sections[s], static_cast<size_t>(header.sizes[s])));
+		header.checksum = h;
+	}
+
+	static const char padding[MESHFILE_ALIGNMENT] = { 0 };
+	meshio_internal::FileWriter out(path);
+	out.write(&header, sizeof(header));
+	uint64_t written = sizeof(header);
+	for (int s = 0; s < MESHFILE_SECTION_COUNT; ++s)
+	{
+		out.write(padding, static_cast<size_t>(header.offsets[s] - written));
+		out.write(sections[s], static_cast<size_t>(header.sizes[s]));
+		written = header.offsets[s] + header.sizes[s];
+	}
+	out.close();
+}
+
+
+MeshFile::MeshFile(const std::string &path, bool verify_checksum) : m_file(path)
+{
+	using namespace meshfile_internal;
+
+	try
+	{
+		MeshFile_read_header(m_file.data(), m_file.size(), m_header);
+		MeshFile_check_header(m_header, m_file.size());
+	}
+	catch (const std::runtime_error &e)
+	{
+		throw std::runtime_error(std::string(e.what()) + ": " + path);
+	}
+
+	if (hasRenderable() && m_header.render_index_size != sizeof(uint16_t) && m_header.render_index_size != sizeof(uint32_t))
+		throw std::runtime_error("Unsupported render index size in " + path);
+	if (m_header.nb_render_line_indices != 0 && m_header.render_line_index_size != sizeof(uint16_t) && m_header.render_line_index_size != sizeof(uint32_t))
+		throw std::runtime_error("Unsupported render line index size in " + path);
+
+	if (verify_checksum && (m_header.flags & MESHFILE_HAS_CHECKSUM) && MeshFile_checksum(m_file.data(), m_header) != m_header.checksum)
+		throw std::runtime_error("Mesh file checksum mismatch: " + path);
+
+	const char *base = m_file.data();
+	if (hasMesh())
+	{
+		m_mesh.vertices = ArrayView<Vertex>(reinterpret_cast<const Vertex *>(base + m_header.offsets[MESHFILE_VERTICES]), static_cast<size_t>(m_header.nb_vertices));
+		m_mesh.edges = ArrayView<Edge>(reinterpret_cast<const Edge *>(base + m_header.offsets[MESHFILE_EDGES]), static_cast<size_t>(m_header.nb_edges));
+		m_mesh.faces.vertex_offsets = reinterpret_cast<const int *>(base + m_header.offsets[MESHFILE_FACE_VERTEX_OFFSETS]);
+		m_mesh.faces.vertex_ids = reinterpret_cast<const int *>(base + m_header.offsets[MESHFILE_FACE_VERTICES]);
+		m_mesh.faces.edge_offsets = reinterpret_cast<const int *>(base + m_header.offsets[MESHFILE_FACE_EDGE_OFFSETS]);
+		m_mesh.faces.edge_ids = reinterpret_cast<const int *>(base + m_header.offsets[MESHFILE_FACE_EDGES]);
+		m_mesh.faces.count = static_cast<size_t>(m_header.nb_faces);
+
+		// The face tables must stay inside their sections before the faces can be
+		// read, then the mesh is validated like the other loaders do
+		const size_t n = m_mesh.faces.count;
+		if (m_mesh.faces.vertex_offsets[0] != 0 || m_mesh.faces.vertex_offsets[n] != static_cast<int>(m_header.nb_face_vertices)
+			|| m_mesh.faces.edge_offsets[0] != 0 || m_mesh.faces.edge_offsets[n] != static_cast<int>(m_header.nb_face_edges))
+			throw std::runtime_error("Corrupted mesh file face tables: " + path);
+		for (size_t f = 0; f < n; ++f)
+		{
+			if (m_mesh.faces.vertex_offsets[f + 1] < m_mesh.faces.vertex_offsets[f] || m_mesh.faces.edge_offsets[f + 1] < m_mesh.faces.edge_offsets[f])
+				throw std::runtime_error("Corrupted mesh file face tables: " + path);
+		}
+
+		meshio_internal::MeshIO_validate(m_mesh, "Invalid mesh in " + path + ": ");
+	}
+
+	if (hasRenderable())
+	{
+		m_render_vertices = ArrayView<float>(reinterpret_cast<const float *>(base + m_header.offsets[MESHFILE_RENDER_VERTICES]), static_cast<size_t>(m_header.nb_render_vertices * 3));
+		const char *indices = base + m_header.offsets[MESHFILE_RENDER_INDICES];
+		if (m_header.render_index_size == sizeof(uint32_t))
+			m_render_indices32 = ArrayView<uint32_t>(reinterpret_cast<const uint32_t *>(indices), static_cast<size_t>(m_header.nb_render_indices));
+		else
+			m_render_indices = ArrayView<uint16_t>(reinterpret_cast<const uint16_t *>(indices), static_cast<size_t>(m_header.nb_render_indices));
+
+		if (m_header.flags & MESHFILE_HAS_NORMALS)
+			m_render_normals = ArrayView<float>(reinterpret_cast<const float *>(base + m_header.offsets[MESHFILE_RENDER_NORMALS]), static_cast<size_t>(m_header.nb_render_vertices * 3));
+		if (m_header.flags & MESHFILE_HAS_OCCLUSION)
+			m_render_occlusion = ArrayView<float>(reinterpret_cast<const float *>(base + m_header.offsets[MESHFILE_RENDER_OCCLUSION]), static_cast<size_t>(m_header.nb_render_vertices));
+
+		const char *lines = base + m_header.offsets[MESHFILE_RENDER_LINES];
+		if (m_header.render_line_index_size == sizeof(uint32_t))
+			m_render_lines32 = ArrayView<uint32_t>(reinterpret_cast<const uint32_t *>(lines), static_cast<size_t>(m_header.nb_render_line_indices));
+		else
+			m_render_lines = ArrayView<uint16_t>(reinterpret_cast<const uint16_t *>(lines), static_cast<size_t>(m_header.nb_render_line_indices));
+	}
+}
+
+
+RenderableMesh MeshFile::getRenderableMesh() const
+{
+	if (!hasRenderable())
+		return m_mesh.getRenderableMesh();
+
+	RenderableMesh ret;
+	ret.vertices.assign(m_render_vertices.begin(), m_render_vertices.end());
+	ret.indices.assign(m_render_indices.begin(), m_render_indices.end());
+	ret.indices32.assign(m_render_indices32.begin(), m_render_indices32.end());
+	ret.normals.assign(m_render_normals.begin(), m_render_normals.end());
+	ret.occlusion.assign(m_render_occlusion.begin(), m_render_occlusion.end());
+	ret.lines.assign(m_render_lines.begin(), m_render_lines.end());
+	ret.lines32.assign(m_render_lines32.begin(), m_render_lines32.end());
+	return ret;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "MeshUtils.h"
+#include "MeshView.h"
+#include "MappedFile.h"
+
+
+// Native binary container (.rmesh). A fixed header is followed by 64-byte aligned
+// sections that are used in place once the file is mapped. Everything is stored
+// in host (little endian) order.
+// Version 2 adds the renderable normals, occlusion and wireframe lines. Its
+// offsets and sizes hold all MESHFILE_SECTION_COUNT (11) sections and are followed
+// by the line index count and size. A version 1 header stops after offsets and
+// sizes of 8 entries each; those files are still read, without the new sections.
+
+const char MESHFILE_MAGIC[8] = { 'R', 'A', 'C', 'M', 'E', 'S', 'H', '\0' };
+const uint32_t MESHFILE_VERSION = 2;
+const uint32_t MESHFILE_ENDIAN_TAG = 0x01020304;
+const size_t MESHFILE_ALIGNMENT = 64;
+
+enum MeshFileFlags
+{
+	MESHFILE_HAS_MESH = 1,
+	MESHFILE_HAS_RENDERABLE = 2,
+	MESHFILE_HAS_CHECKSUM = 4,
+	MESHFILE_HAS_NORMALS = 8,
+	MESHFILE_HAS_OCCLUSION = 16
+};
+
+enum MeshFileSection
+{
+	MESHFILE_VERTICES, // Vertex[nb_vertices]
+	MESHFILE_EDGES, // Edge[nb_edges]
+	MESHFILE_FACE_VERTEX_OFFSETS, // int[nb_faces + 1]
+	MESHFILE_FACE_VERTICES, // int[nb_face_vertices]
+	MESHFILE_FACE_EDGE_OFFSETS, // int[nb_faces + 1]
+	MESHFILE_FACE_EDGES, // int[nb_face_edges]
+	MESHFILE_RENDER_VERTICES, // float[nb_render_vertices * 3]
+	MESHFILE_RENDER_INDICES, // triangle list, render_index_size (2 or 4) bytes per index
+	MESHFILE_RENDER_NORMALS, // float[nb_render_vertices * 3] with MESHFILE_HAS_NORMALS, since version 2
+	MESHFILE_RENDER_OCCLUSION, // float[nb_render_vertices] with MESHFILE_HAS_OCCLUSION, since version 2
+	MESHFILE_RENDER_LINES, // 2 indices per line, render_line_index_size bytes per index, since version 2
+	MESHFILE_SECTION_COUNT
+};
+
+// Sections of a version 1 file, the ones before MESHFILE_RENDER_NORMALS
+const int MESHFILE_V1_SECTION_COUNT = MESHFILE_RENDER_NORMALS;
+
+struct MeshFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t endian_tag;
+	uint32_t flags;
+	uint32_t render_index_size;
+	uint64_t checksum; // hash of every section, 0 without MESHFILE_HAS_CHECKSUM
+
+	uint64_t nb_vertices;
+	uint64_t nb_edges;
+	uint64_t nb_faces;
+	uint64_t nb_face_vertices;
+	uint64_t nb_face_edges;
+	uint64_t nb_render_vertices;
+	uint64_t nb_render_indices;
+
+	uint64_t offsets[MESHFILE_SECTION_COUNT];
+	uint64_t sizes[MESHFILE_SECTION_COUNT];
+
+	uint64_t nb_render_line_indices;
+	uint32_t render_line_index_size;
+	uint32_t reserved;
+};
+
+
+namespace meshfile_internal
+{
+	uint64_t MeshFile_hash(const char *data, size_t size);
+
+	uint64_t MeshFile_checksum(const char *base, const MeshFileHeader &header);
+
+	int MeshFile_section_count(uint32_t version);
+
+	// Header of either version, the sections a version 1 file lacks are left empty
+	void MeshFile_read_header(const char *data, size_t size, MeshFileHeader &header);
+
+	void MeshFile_check_header(const MeshFileHeader &header, size_t file_size);
+}
+
+///<summary>
+///Writes a Mesh and/or a RenderableMesh (either may be null) as a .rmesh file.
+///Throws std::runtime_error if the file can not be written.
+///</summary>
+void saveMeshFile(const std::string &path, const Mesh *mesh, const RenderableMesh *renderable, bool checksum = true);
+
+inline void saveMeshFile(const Mesh &mesh, const std::string &path, bool checksum = true) { saveMeshFile(path, &mesh, nullptr, checksum); }
+
+inline void saveMeshFile(const RenderableMesh &mesh, const std::string &path, bool checksum = true) { saveMeshFile(path, nullptr, &mesh, checksum); }
+
+
+///<summary>
+///Memory mapped .rmesh file. mesh() is a MeshView straight over the mapping,
+///so it is only valid while the MeshFile is alive.
+///Throws std::runtime_error on unreadable, truncated or corrupted files, and on
+///meshes that fail validateMesh.
+///</summary>
+class MeshFile
+{
+private:
+	MappedFile m_file;
+	MeshFileHeader m_header;
+	MeshView m_mesh;
+	ArrayView<float> m_render_vertices;
+	ArrayView<uint16_t> m_render_indices;
+	ArrayView<uint32_t> m_render_indices32;
+	ArrayView<float> m_render_normals;
+	ArrayView<float> m_render_occlusion;
+	ArrayView<uint16_t> m_render_lines;
+	ArrayView<uint32_t> m_render_lines32;
+
+public:
+	MeshFile(const std::string &path, bool verify_checksum = true);
+
+	uint32_t version() const { return m_header.version; }
+
+	bool hasMesh() const { return (m_header.flags & MESHFILE_HAS_MESH) != 0; }
+	bool hasRenderable() const { return (m_header.flags & MESHFILE_HAS_RENDERABLE) != 0; }
+
+	const MeshView &mesh() const { return m_mesh; }
+
+	ArrayView<float> renderVertices() const { return m_render_vertices; }
+	///<summary>
+	///Stored triangle indices, in renderIndices() or renderIndices32() depending
+	///on renderIndexSize(), the other one being empty.
+	///</summary>
+	uint32_t renderIndexSize() const { return m_header.render_index_size; }
+	ArrayView<uint16_t> renderIndices() const { return m_render_indices; }
+	ArrayView<uint32_t> renderIndices32() const { return m_render_indices32; }
+
+	///<summary>
+	///Stored normals, occlusion and wireframe lines of the renderable, empty when
+	///it had none or the file predates version 2. Lines follow the same split as
+	///the triangles, on renderLineIndexSize().
+	///</summary>
+	ArrayView<float> renderNormals() const { return m_render_normals; }
+	ArrayView<float> renderOcclusion() const { return m_render_occlusion; }
+	uint32_t renderLineIndexSize() const { return m_header.render_line_index_size; }
+	ArrayView<uint16_t> renderLines() const { return m_render_lines; }
+	ArrayView<uint32_t> renderLines32() const { return m_render_lines32; }
+
+	///<summary>
+	///Copy of the stored RenderableMesh, or one built from the stored Mesh.
+	///</summary>
+	RenderableMesh getRenderableMesh() const;
+};
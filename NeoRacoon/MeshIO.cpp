@@ -0,0 +1,1097 @@
+#include "MeshIO.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cctype>
+#include <thread>
+#include <exception>
+
+#include "MappedFile.h"
+#include "MeshValidate.h"
+#include "Parallel.h"
+
+
+namespace meshio_internal
+{
+	static const double POW10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+	inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	// Splits [begin, end) in nb_chunks ranges cut right after a line feed
+	std::vector<const char *> splitLines(const char *begin, const char *end, size_t nb_chunks)
+	{
+		std::vector<const char *> cuts;
+		cuts.push_back(begin);
+		size_t size = end - begin;
+		for (size_t c = 1; c < nb_chunks; ++c)
+		{
+			const char *p = std::max(cuts.back(), begin + size * c / nb_chunks);
+			const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+			if (!nl)
+				break;
+			cuts.push_back(nl + 1);
+		}
+		cuts.push_back(end);
+		return cuts;
+	}
+
+
+	enum PlyType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+
+	struct PlyProperty
+	{
+		std::string name;
+		PlyType type;
+		PlyType count_type; // PLY_INVALID unless the property is a list
+	};
+
+	struct PlyElement
+	{
+		std::string name;
+		size_t count;
+		std::vector<PlyProperty> properties;
+	};
+
+	PlyType plyType(const std::string &name)
+	{
+		if (name == "char" || name == "int8") return PLY_INT8;
+		if (name == "uchar" || name == "uint8") return PLY_UINT8;
+		if (name == "short" || name == "int16") return PLY_INT16;
+		if (name == "ushort" || name == "uint16") return PLY_UINT16;
+		if (name == "int" || name == "int32") return PLY_INT32;
+		if (name == "uint" || name == "uint32") return PLY_UINT32;
+		if (name == "float" || name == "float32") return PLY_FLOAT32;
+		if (name == "double" || name == "float64") return PLY_FLOAT64;
+		return PLY_INVALID;
+	}
+
+	size_t plySize(PlyType type)
+	{
+		static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+		return sizes[type];
+	}
+
+	bool hostIsLittleEndian()
+	{
+		const uint16_t one = 1;
+		return *reinterpret_cast<const uint8_t *>(&one) == 1;
+	}
+
+	double plyRead(const char *p, PlyType type, bool swap)
+	{
+		char buf[8];
+		size_t size = plySize(type);
+		if (swap)
+		{
+			for (size_t i = 0; i < size; ++i)
+				buf[i] = p[size - 1 - i];
+		}
+		else
+			memcpy(buf, p, size);
+
+		switch (type)
+		{
+			case PLY_INT8: { int8_t v; memcpy(&v, buf, 1); return v; }
+			case PLY_UINT8: { uint8_t v; memcpy(&v, buf, 1); return v; }
+			case PLY_INT16: { int16_t v; memcpy(&v, buf, 2); return v; }
+			case PLY_UINT16: { uint16_t v; memcpy(&v, buf, 2); return v; }
+			case PLY_INT32: { int32_t v; memcpy(&v, buf, 4); return v; }
+			case PLY_UINT32: { uint32_t v; memcpy(&v, buf, 4); return v; }
+			case PLY_FLOAT32: { float v; memcpy(&v, buf, 4); return v; }
+			case PLY_FLOAT64: { double v; memcpy(&v, buf, 8); return v; }
+			default: return 0;
+		}
+	}
+
+	// Size in bytes of one binary element record starting at p, or 0 if it runs past end
+	size_t plyRecordSize(const PlyElement &element, const char *p, const char *end, bool swap)
+	{
+		const char *start = p;
+		for (auto it = element.properties.begin(); it != element.properties.end(); ++it)
+		{
+			if (it->count_type == PLY_INVALID)
+			{
+				p += plySize(it->type);
+				continue;
+			}
+
+			if (p + plySize(it->count_type) > end)
+				return 0;
+			size_t count = static_cast<size_t>(plyRead(p, it->count_type, swap));
+			p += plySize(it->count_type) + count * plySize(it->type);
+		}
+
+		return p > end ? 0 : static_cast<size_t>(p - start);
+	}
+
+
+	// Formats [0, count) in blocks of block_size elements, one batch of blocks per
+	// round of threads, and writes each batch from a background thread while the
+	// next one is being formatted. format(first, last, buffer) appends to buffer.
+	template<typename F>
+	void writeBlocks(FileWriter &out, size_t count, size_t block_size, F format)
+	{
+		const size_t nb_threads = parallel::threadCount();
+		const size_t nb_blocks = (count + block_size - 1) / block_size;
+
+		std::vector<std::string> buffers[2] = { std::vector<std::string>(nb_threads), std::vector<std::string>(nb_threads) };
+		std::exception_ptr error;
+		std::thread writer;
+		int current = 0;
+
+		for (size_t batch = 0; batch < nb_blocks; batch += nb_threads)
+		{
+			const size_t batch_blocks = std::min(nb_threads, nb_blocks - batch);
+			std::vector<std::string> &blocks = buffers[current];
+
+			parallel::parallelFor(0, batch_blocks, [&](size_t first, size_t last, unsigned int)
+			{
+				for (size_t b = first; b < last; ++b)
+				{
+					size_t begin = (batch + b) * block_size;
+					blocks[b].clear();
+					format(begin, std::min(count, begin + block_size), blocks[b]);
+				}
+			}, 1);
+
+			if (writer.joinable())
+				writer.join();
+			if (error)
+				std::rethrow_exception(error);
+
+			writer = std::thread([&out, &blocks, &error, batch_blocks]()
+			{
+				try
+				{
+					for (size_t b = 0; b < batch_blocks; ++b)
+						out.write(blocks[b]);
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+			});
+
+			current ^= 1;
+		}
+
+		if (writer.joinable())
+			writer.join();
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	const char *plyFormatName()
+	{
+		return hostIsLittleEndian() ? "binary_little_endian" : "binary_big_endian";
+	}
+}
+
+
+const char *meshio_internal::MeshIO_skip_spaces(const char *p, const char *end)
+{
+	while (p < end && isSpace(*p))
+		++p;
+	return p;
+}
+
+const char *meshio_internal::MeshIO_next_line(const char *p, const char *end)
+{
+	const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+	return nl ? nl + 1 : end;
+}
+
+const char *meshio_internal::MeshIO_parse_float(const char *p, const char *end, float &out)
+{
+	const char *start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	bool any_digit = false;
+
+	for (; p < end && isDigit(*p); ++p)
+	{
+		any_digit = true;
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			if (mantissa != 0)
+				++digits;
+		}
+		else
+			++exponent;
+	}
+
+	if (p < end && *p == '.')
+	{
+		for (++p; p < end && isDigit(*p); ++p)
+		{
+			any_digit = true;
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa != 0)
+					++digits;
+				--exponent;
+			}
+		}
+	}
+
+	if (!any_digit)
+	{
+		// inf, nan and other oddities go through the C library
+		char buf[64];
+		size_t len = 0;
+		for (const char *q = start; q < end && len < sizeof(buf) - 1 && !isSpace(*q) && *q != '\n'; ++q)
+			buf[len++] = *q;
+		buf[len] = '\0';
+
+		char *stop = nullptr;
+		double v = strtod(buf, &stop);
+		if (stop == buf)
+			return nullptr;
+		out = static_cast<float>(v);
+		return start + (stop - buf);
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		const char *q = p + 1;
+		bool exp_negative = false;
+		if (q < end && (*q == '-' || *q == '+'))
+		{
+			exp_negative = (*q == '-');
+			++q;
+		}
+
+		if (q < end && isDigit(*q))
+		{
+			int e = 0;
+			for (; q < end && isDigit(*q); ++q)
+			{
+				if (e < 10000)
+					e = e * 10 + (*q - '0');
+			}
+			exponent += exp_negative ? -e : e;
+			p = q;
+		}
+	}
+
+	double value = static_cast<double>(mantissa);
+	if (exponent < 0 && exponent >= -22)
+		value /= POW10[-exponent];
+	else if (exponent > 0 && exponent <= 22)
+		value *= POW10[exponent];
+	else if (exponent != 0)
+		value *= std::pow(10.0, exponent);
+
+	out = static_cast<float>(negative ? -value : value);
+	return p;
+}
+
+const char *meshio_internal::MeshIO_parse_int(const char *p, const char *end, int &out)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		++p;
+	}
+
+	if (p >= end || !isDigit(*p))
+		return nullptr;
+
+	int64_t value = 0;
+	for (; p < end && isDigit(*p); ++p)
+	{
+		if (value < INT32_MAX)
+			value = value * 10 + (*p - '0');
+	}
+
+	out = static_cast<int>(negative ? -value : value);
+	return p;
+}
+
+
+void meshio_internal::MeshIO_parse_obj_chunk(const char *begin, const char *end, ParsedChunk &out)
+{
+	const char *p = begin;
+	while (p < end)
+	{
+		p = MeshIO_skip_spaces(p, end);
+		if (p + 1 < end && p[0] == 'v' && isSpace(p[1]))
+		{
+			float xyz[3] = { 0.0f, 0.0f, 0.0f };
+			const char *q = p + 1;
+			for (int i = 0; i < 3 && q; ++i)
+				q = MeshIO_parse_float(MeshIO_skip_spaces(q, end), end, xyz[i]);
+
+			if (!q)
+				throw std::runtime_error("Malformed OBJ vertex.");
+
+			out.vertices.push_back(Vertex(xyz[0], xyz[1], xyz[2]));
+		}
+		else if (p + 1 < end && p[0] == 'f' && isSpace(p[1]))
+		{
+			if (out.face_offsets.empty())
+				out.face_offsets.push_back(0);
+
+			const char *q = MeshIO_skip_spaces(p + 1, end);
+			while (q < end && *q != '\n' && *q != '#')
+			{
+				int index;
+				q = MeshIO_parse_int(q, end, index);
+				if (!q || index == 0)
+					throw std::runtime_error("Malformed OBJ face.");
+
+				if (index < 0)
+				{
+					// Relative to the vertices read so far: resolved when chunks are merged
+					out.relative_indices.push_back(out.face_indices.size());
+					out.face_indices.push_back(static_cast<int>(out.vertices.size()) + index);
+				}
+				else
+					out.face_indices.push_back(index - 1);
+
+				// Skip the texture and normal indices of v/vt/vn
+				while (q < end && !isSpace(*q) && *q != '\n')
+					++q;
+				q = MeshIO_skip_spaces(q, end);
+			}
+
+			out.face_offsets.push_back(static_cast<int>(out.face_indices.size()));
+		}
+
+		p = MeshIO_next_line(p, end);
+	}
+}
+
+
+Mesh meshio_internal::MeshIO_merge_chunks(std::vector<ParsedChunk> &chunks, MeshBuildStats *stats)
+{
+	size_t nb_vertices = 0, nb_indices = 0, nb_faces = 0;
+	std::vector<size_t> vertex_base(chunks.size()), index_base(chunks.size()), face_base(chunks.size());
+	for (size_t c = 0; c < chunks.size(); ++c)
+	{
+		vertex_base[c] = nb_vertices;
+		index_base[c] = nb_indices;
+		face_base[c] = nb_faces;
+		nb_vertices += chunks[c].vertices.size();
+		nb_indices += chunks[c].face_indices.size();
+		nb_faces += chunks[c].face_offsets.empty() ? 0 : chunks[c].face_offsets.size() - 1;
+	}
+
+	std::vector<Vertex> vertices(nb_vertices);
+	std::vector<int> face_indices(nb_indices);
+	std::vector<int> face_offsets(nb_faces + 1, 0);
+	face_offsets.back() = static_cast<int>(nb_indices);
+
+	parallel::parallelFor(0, chunks.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t c = first; c < last; ++c)
+		{
+			ParsedChunk &chunk = chunks[c];
+			int vb = static_cast<int>(vertex_base[c]);
+			int ib = static_cast<int>(index_base[c]);
+
+			std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + vb);
+			std::copy(chunk.face_indices.begin(), chunk.face_indices.end(), face_indices.begin() + ib);
+			for (auto it = chunk.relative_indices.begin(); it != chunk.relative_indices.end(); ++it)
+				face_indices[ib + *it] += vb;
+
+			for (size_t f = 0; f + 1 < chunk.face_offsets.size(); ++f)
+				face_offsets[face_base[c] + f] = ib + chunk.face_offsets[f];
+
+			chunk = ParsedChunk();
+		}
+	}, 1);
+
+	try
+	{
+		return buildMesh(vertices, face_indices, face_offsets, stats);
+	}
+	catch (const std::invalid_argument &e)
+	{
+		throw std::runtime_error(e.what());
+	}
+}
+
+
+Mesh loadOBJ(const std::string &path, MeshBuildStats *stats)
+{
+	using namespace meshio_internal;
+
+	MappedFile file(path);
+	auto cuts = splitLines(file.data(), file.end(), parallel::blockCount(file.size(), 1 << 20) * 4);
+	std::vector<ParsedChunk> chunks(cuts.size() - 1);
+
+	std::vector<std::string> errors(chunks.size());
+	parallel::parallelFor(0, chunks.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t c = first; c < last; ++c)
+		{
+			try
+			{
+				MeshIO_parse_obj_chunk(cuts[c], cuts[c + 1], chunks[c]);
+			}
+			catch (const std::exception &e)
+			{
+				errors[c] = e.what();
+			}
+		}
+	}, 1);
+
+	for (auto it = errors.begin(); it != errors.end(); ++it)
+	{
+		if (!it->empty())
+			throw std::runtime_error(*it + " (" + path + ")");
+	}
+
+	Mesh ret = MeshIO_merge_chunks(chunks, stats);
+	MeshIO_validate(ret, "Invalid mesh in " + path + ": ");
+	return ret;
+}
+
+
+Mesh loadPLY(const std::string &path, MeshBuildStats *stats)
+{
+	using namespace meshio_internal;
+
+	MappedFile file(path);
+	const char *p = file.data(), *end = file.end();
+
+	if (file.size() < 3 || strncmp(p, "ply", 3) != 0)
+		throw std::runtime_error("Not a PLY file: " + path);
+
+	// Header
+	enum { ASCII, BINARY_LE, BINARY_BE } format = ASCII;
+	std::vector<PlyElement> elements;
+	bool header_done = false;
+	for (p = MeshIO_next_line(p, end); p < end && !header_done; p = MeshIO_next_line(p, end))
+	{
+		const char *line_end = static_cast<const char *>(memchr(p, '\n', end - p));
+		std::string line(p, line_end ? line_end : end);
+		while (!line.empty() && isSpace(line.back()))
+			line.pop_back();
+
+		char word[32] = { 0 }, arg0[64] = { 0 }, arg1[64] = { 0 }, arg2[64] = { 0 };
+		int nb = sscanf(line.c_str(), "%31s %63s %63s %63s", word, arg0, arg1, arg2);
+		std::string keyword(nb > 0 ? word : "");
+
+		if (keyword == "format")
+		{
+			std::string f(arg0);
+			if (f == "ascii") format = ASCII;
+			else if (f == "binary_little_endian") format = BINARY_LE;
+			else if (f == "binary_big_endian") format = BINARY_BE;
+			else throw std::runtime_error("Unknown PLY format " + f);
+		}
+		else if (keyword == "element" && nb >= 3)
+		{
+			PlyElement element;
+			element.name = arg0;
+			element.count = static_cast<size_t>(strtoull(arg1, nullptr, 10));
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty())
+		{
+			PlyProperty prop;
+			if (std::string(arg0) == "list" && nb >= 4)
+			{
+				prop.count_type = plyType(arg1);
+				prop.type = plyType(arg2);
+				prop.name = line.substr(line.find_last_of(" \t") + 1);
+				if (prop.count_type == PLY_INVALID)
+					throw std::runtime_error("Unknown PLY type in " + path);
+			}
+			else
+			{
+				prop.count_type = PLY_INVALID;
+				prop.type = plyType(arg0);
+				prop.name = arg1;
+			}
+
+			if (prop.type == PLY_INVALID)
+				throw std::runtime_error("Unknown PLY type in " + path);
+			elements.back().properties.push_back(prop);
+		}
+		else if (keyword == "end_header")
+			header_done = true;
+	}
+
+	if (!header_done)
+		throw std::runtime_error("Truncated PLY header: " + path);
+
+	std::vector<Vertex> vertices;
+	std::vector<int> face_indices;
+	std::vector<int> face_offsets(1, 0);
+	const bool swap = (format == BINARY_LE) != hostIsLittleEndian();
+
+	for (auto el = elements.begin(); el != elements.end(); ++el)
+	{
+		const bool is_vertex = (el->name == "vertex");
+		const bool is_face = (el->name == "face");
+
+		int xyz[3] = { -1, -1, -1 };
+		int list_prop = -1;
+		for (size_t i = 0; i < el->properties.size(); ++i)
+		{
+			const PlyProperty &prop = el->properties[i];
+			if (prop.name == "x") xyz[0] = static_cast<int>(i);
+			else if (prop.name == "y") xyz[1] = static_cast<int>(i);
+			else if (prop.name == "z") xyz[2] = static_cast<int>(i);
+			else if (prop.count_type != PLY_INVALID && (prop.name == "vertex_indices" || prop.name == "vertex_index"))
+				list_prop = static_cast<int>(i);
+		}
+
+		if (is_vertex && (xyz[0] < 0 || xyz[1] < 0 || xyz[2] < 0))
+			throw std::runtime_error("PLY vertices without x, y, z: " + path);
+		if (is_face && list_prop < 0)
+			throw std::runtime_error("PLY faces without vertex_indices: " + path);
+
+		if (format == ASCII)
+		{
+			// Find where this element ends, one line per record
+			const char *section_end = p;
+			for (size_t i = 0; i < el->count; ++i)
+			{
+				if (section_end >= end)
+					throw std::runtime_error("Truncated PLY file: " + path);
+				section_end = MeshIO_next_line(section_end, end);
+			}
+
+			if (is_vertex || is_face)
+			{
+				auto cuts = splitLines(p, section_end, parallel::blockCount(section_end - p, 1 << 20) * 4);
+				std::vector<ParsedChunk> chunks(cuts.size() - 1);
+				std::vector<std::string> errors(chunks.size());
+
+				parallel::parallelFor(0, chunks.size(), [&](size_t first, size_t last, unsigned int)
+				{
+					for (size_t c = first; c < last; ++c)
+					{
+						ParsedChunk &chunk = chunks[c];
+						chunk.face_offsets.push_back(0);
+						for (const char *q = cuts[c]; q < cuts[c + 1]; q = MeshIO_next_line(q, cuts[c + 1]))
+						{
+							const char *r = q;
+							float xyz_values[3] = { 0.0f, 0.0f, 0.0f };
+							for (size_t i = 0; i < el->properties.size() && r; ++i)
+							{
+								const PlyProperty &prop = el->properties[i];
+								r = MeshIO_skip_spaces(r, end);
+								if (prop.count_type == PLY_INVALID)
+								{
+									float v;
+									r = MeshIO_parse_float(r, end, v);
+									for (int k = 0; k < 3; ++k)
+									{
+										if (xyz[k] == static_cast<int>(i))
+											xyz_values[k] = v;
+									}
+									continue;
+								}
+
+								int count = 0;
+								r = MeshIO_parse_int(r, end, count);
+								for (int k = 0; k < count && r; ++k)
+								{
+									int index = 0;
+									r = MeshIO_parse_int(MeshIO_skip_spaces(r, end), end, index);
+									if (static_cast<int>(i) == list_prop)
+										chunk.face_indices.push_back(index);
+								}
+								if (static_cast<int>(i) == list_prop)
+									chunk.face_offsets.push_back(static_cast<int>(chunk.face_indices.size()));
+							}
+
+							if (!r)
+							{
+								errors[c] = "Malformed PLY record in " + path;
+								return;
+							}
+
+							if (is_vertex)
+								chunk.vertices.push_back(Vertex(xyz_values[0], xyz_values[1], xyz_values[2]));
+						}
+					}
+				}, 1);
+
+				for (auto it = errors.begin(); it != errors.end(); ++it)
+				{
+					if (!it->empty())
+						throw std::runtime_error(*it);
+				}
+
+				for (auto it = chunks.begin(); it != chunks.end(); ++it)
+				{
+					vertices.insert(vertices.end(), it->vertices.begin(), it->vertices.end());
+					int base = face_offsets.back();
+					for (size_t f = 1; f < it->face_offsets.size(); ++f)
+						face_offsets.push_back(base + it->face_offsets[f]);
+					face_indices.insert(face_indices.end(), it->face_indices.begin(), it->face_indices.end());
+				}
+			}
+
+			p = section_end;
+			continue;
+		}
+
+		// Binary records of scalar properties have a fixed stride and convert in parallel
+		bool fixed = true;
+		size_t stride = 0;
+		std::vector<size_t> offsets;
+		for (auto it = el->properties.begin(); it != el->properties.end(); ++it)
+		{
+			offsets.push_back(stride);
+			fixed &= (it->count_type == PLY_INVALID);
+			stride += plySize(it->type);
+		}
+
+		if (fixed)
+		{
+			if (static_cast<size_t>(end - p) < stride * el->count)
+				throw std::runtime_error("Truncated PLY file: " + path);
+
+			if (is_vertex)
+			{
+				size_t base = vertices.size();
+				vertices.resize(base + el->count);
+				const char *data = p;
+				parallel::parallelFor(0, el->count, [&](size_t first, size_t last, unsigned int)
+				{
+					const PlyProperty &px = el->properties[xyz[0]], &py = el->properties[xyz[1]], &pz = el->properties[xyz[2]];
+					for (size_t i = first; i < last; ++i)
+					{
+						const char *record = data + i * stride;
+						vertices[base + i] = Vertex(
+							static_cast<float>(plyRead(record + offsets[xyz[0]], px.type, swap)),
+							static_cast<float>(plyRead(record + offsets[xyz[1]], py.type, swap)),
+							static_cast<float>(plyRead(record + offsets[xyz[2]], pz.type, swap)));
+					}
+				});
+			}
+
+			p += stride * el->count;
+			continue;
+		}
+
+		// Variable length records: one sequential pass over the list counts
+		for (size_t i = 0; i < el->count; ++i)
+		{
+			size_t size = plyRecordSize(*el, p, end, swap);
+			if (size == 0 && !el->properties.empty())
+				throw std::runtime_error("Truncated PLY file: " + path);
+
+			if (is_face)
+			{
+				const char *q = p;
+				for (int k = 0; k < list_prop; ++k)
+				{
+					const PlyProperty &prop = el->properties[k];
+					if (prop.count_type == PLY_INVALID)
+						q += plySize(prop.type);
+					else
+						q += plySize(prop.count_type) + static_cast<size_t>(plyRead(q, prop.count_type, swap)) * plySize(prop.type);
+				}
+
+				const PlyProperty &list = el->properties[list_prop];
+				size_t count = static_cast<size_t>(plyRead(q, list.count_type, swap));
+				q += plySize(list.count_type);
+				for (size_t k = 0; k < count; ++k, q += plySize(list.type))
+					face_indices.push_back(static_cast<int>(plyRead(q, list.type, swap)));
+				face_offsets.push_back(static_cast<int>(face_indices.size()));
+			}
+
+			p += size;
+		}
+	}
+
+	Mesh ret;
+	try
+	{
+		ret = buildMesh(vertices, face_indices, face_offsets, stats);
+	}
+	catch (const std::invalid_argument &e)
+	{
+		throw std::runtime_error(std::string(e.what()) + " (" + path + ")");
+	}
+
+	MeshIO_validate(ret, "Invalid mesh in " + path + ": ");
+	return ret;
+}
+
+
+Mesh loadMesh(const std::string &path, MeshBuildStats *stats)
+{
+	std::string ext = path.substr(path.find_last_of('.') + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	if (ext == "obj")
+		return loadOBJ(path, stats);
+	if (ext == "ply")
+		return loadPLY(path, stats);
+
+	throw std::runtime_error("Unsupported mesh format: " + path);
+}
+
+
+
+void meshio_internal::MeshIO_validate(const Mesh &mesh, const std::string &message)
+{
+	MeshValidation v = validateMesh(mesh);
+	if (!v.isValid())
+		throw std::runtime_error(message + v.describe());
+}
+
+void meshio_internal::MeshIO_validate(const MeshView &mesh, const std::string &message)
+{
+	MeshValidation v = validateMesh(mesh);
+	if (!v.isValid())
+		throw std::runtime_error(message + v.describe());
+}
+
+
+char *meshio_internal::MeshIO_format_int(char *out, int64_t value)
+{
+	uint64_t v = static_cast<uint64_t>(value);
+	if (value < 0)
+	{
+		*out++ = '-';
+		v = 0 - v;
+	}
+
+	char digits[20];
+	int n = 0;
+	do
+	{
+		digits[n++] = static_cast<char>('0' + v % 10);
+		v /= 10;
+	} while (v != 0);
+
+	while (n > 0)
+		*out++ = digits[--n];
+
+	return out;
+}
+
+// Shortest fixed notation with 9 significant digits, enough to read the same float back.
+// Very small and very large magnitudes go through snprintf. Writes at most 32 chars.
+char *meshio_internal::MeshIO_format_float(char *out, float value)
+{
+	if (value == 0.0f)
+	{
+		*out++ = '0';
+		return out;
+	}
+
+	double v = value;
+	if (!(v >= 1e-4 && v < 1e9) && !(v <= -1e-4 && v > -1e9))
+		return out + snprintf(out, 32, "%.9g", v);
+
+	if (v < 0)
+	{
+		*out++ = '-';
+		v = -v;
+	}
+
+	int magnitude = 0;
+	while (magnitude < 8 && v >= POW10[magnitude + 1])
+		++magnitude;
+	while (magnitude > -4 && v < 1.0 / POW10[-magnitude])
+		--magnitude;
+
+	int decimals = std::max(0, 8 - magnitude);
+	uint64_t scale = static_cast<uint64_t>(POW10[decimals]);
+	uint64_t scaled = static_cast<uint64_t>(v * POW10[decimals] + 0.5);
+
+	out = MeshIO_format_int(out, static_cast<int64_t>(scaled / scale));
+	uint64_t frac = scaled % scale;
+	if (frac == 0)
+		return out;
+
+	while (frac % 10 == 0)
+	{
+		frac /= 10;
+		--decimals;
+	}
+
+	*out++ = '.';
+	for (int i = decimals - 1; i >= 0; --i)
+	{
+		out[i] = static_cast<char>('0' + frac % 10);
+		frac /= 10;
+	}
+
+	return out + decimals;
+}
+
+
+void saveOBJ(const Mesh &mesh, const std::string &path)
+{
+	using namespace meshio_internal;
+
+	FileWriter out(path);
+	out.write(std::string("# ") + std::to_string(mesh.vertices.size()) + " vertices, " + std::to_string(mesh.faces.size()) + " faces\n");
+
+	writeBlocks(out, mesh.vertices.size(), 1 << 16, [&mesh](size_t first, size_t last, std::string &buffer)
+	{
+		buffer.resize((last - first) * 104);
+		char *p = &buffer[0];
+		for (size_t i = first; i < last; ++i)
+		{
+			const Vertex &v = mesh.vertices[i];
+			*p++ = 'v';
+			*p++ = ' '; p = MeshIO_format_float(p, v.x);
+			*p++ = ' '; p = MeshIO_format_float(p, v.y);
+			*p++ = ' '; p = MeshIO_format_float(p, v.z);
+			*p++ = '\n';
+		}
+		buffer.resize(p - buffer.data());
+	});
+
+	writeBlocks(out, mesh.faces.size(), 1 << 15, [&mesh](size_t first, size_t last, std::string &buffer)
+	{
+		char line[32];
+		for (size_t i = first; i < last; ++i)
+		{
+			std::vector<int> loop = mesh.getFaceLoop(static_cast<int>(i));
+			buffer += 'f';
+			for (auto it = loop.begin(); it != loop.end(); ++it)
+			{
+				line[0] = ' ';
+				char *p = MeshIO_format_int(line + 1, static_cast<int64_t>(*it) + 1);
+				buffer.append(line, p);
+			}
+			buffer += '\n';
+		}
+	});
+
+	out.close();
+}
+
+
+void saveOBJ(const RenderableMesh &mesh, const std::string &path)
+{
+	using namespace meshio_internal;
+
+	FileWriter out(path);
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	const size_t nb_triangles = mesh.indexCount() / 3;
+	out.write(std::string("# ") + std::to_string(nb_vertices) + " vertices, " + std::to_string(nb_triangles) + " triangles\n");
+
+	writeBlocks(out, nb_vertices, 1 << 16, [&mesh](size_t first, size_t last, std::string &buffer)
+	{
+		buffer.resize((last - first) * 104);
+		char *p = &buffer[0];
+		for (size_t i = first; i < last; ++i)
+		{
+			*p++ = 'v';
+			for (size_t k = 0; k < 3; ++k)
+			{
+				*p++ = ' ';
+				p = MeshIO_format_float(p, mesh.vertices[i * 3 + k]);
+			}
+			*p++ = '\n';
+		}
+		buffer.resize(p - buffer.data());
+	});
+
+	writeBlocks(out, nb_triangles, 1 << 16, [&mesh](size_t first, size_t last, std::string &buffer)
+	{
+		buffer.resize((last - first) * 72);
+		char *p = &buffer[0];
+		for (size_t i = first; i < last; ++i)
+		{
+			*p++ = 'f';
+			for (size_t k = 0; k < 3; ++k)
+			{
+				*p++ = ' ';
+				p = MeshIO_format_int(p, static_cast<int64_t>(mesh.getIndex(i * 3 + k)) + 1);
+			}
+			*p++ = '\n';
+		}
+		buffer.resize(p - buffer.data());
+	});
+
+	out.close();
+}
+
+
+void savePLY(const Mesh &mesh, const std::string &path, bool binary)
+{
+	using namespace meshio_internal;
+	static_assert(sizeof(Vertex) == 3 * sizeof(float), "Vertex must be tightly packed to be written as is");
+
+	size_t max_face = 0;
+	for (auto it = mesh.faces.begin(); it != mesh.faces.end(); ++it)
+		max_face = std::max(max_face, it->edges.size());
+	const bool wide_count = max_face > 255;
+
+	FileWriter out(path);
+	out.write(std::string("ply\nformat ") + (binary ? plyFormatName() : "ascii") + " 1.0\n"
+		+ "element vertex " + std::to_string(mesh.vertices.size()) + "\n"
+		+ "property float x\nproperty float y\nproperty float z\n"
+		+ "element face " + std::to_string(mesh.faces.size()) + "\n"
+		+ "property list " + (wide_count ? "int" : "uchar") + " int vertex_indices\n"
+		+ "end_header\n");
+
+	if (binary)
+	{
+		out.write(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+
+		writeBlocks(out, mesh.faces.size(), 1 << 16, [&mesh, wide_count](size_t first, size_t last, std::string &buffer)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				std::vector<int> loop = mesh.getFaceLoop(static_cast<int>(i));
+				if (wide_count)
+				{
+					int32_t count = static_cast<int32_t>(loop.size());
+					buffer.append(reinterpret_cast<const char *>(&count), sizeof(count));
+				}
+				else
+					buffer += static_cast<char>(loop.size());
+				buffer.append(reinterpret_cast<const char *>(loop.data()), loop.size() * sizeof(int));
+			}
+		});
+	}
+	else
+	{
+		writeBlocks(out, mesh.vertices.size(), 1 << 16, [&mesh](size_t first, size_t last, std::string &buffer)
+		{
+			buffer.resize((last - first) * 100);
+			char *p = &buffer[0];
+			for (size_t i = first; i < last; ++i)
+			{
+				const Vertex &v = mesh.vertices[i];
+				p = MeshIO_format_float(p, v.x); *p++ = ' ';
+				p = MeshIO_format_float(p, v.y); *p++ = ' ';
+				p = MeshIO_format_float(p, v.z); *p++ = '\n';
+			}
+			buffer.resize(p - buffer.data());
+		});
+
+		writeBlocks(out, mesh.faces.size(), 1 << 15, [&mesh](size_t first, size_t last, std::string &buffer)
+		{
+			char number[32];
+			for (size_t i = first; i < last; ++i)
+			{
+				std::vector<int> loop = mesh.getFaceLoop(static_cast<int>(i));
+				buffer.append(number, MeshIO_format_int(number, static_cast<int64_t>(loop.size())));
+				for (auto it = loop.begin(); it != loop.end(); ++it)
+				{
+					number[0] = ' ';
+					buffer.append(number, MeshIO_format_int(number + 1, *it));
+				}
+				buffer += '\n';
+			}
+		});
+	}
+
+	out.close();
+}
+
+
+void savePLY(const RenderableMesh &mesh, const std::string &path, bool binary)
+{
+	using namespace meshio_internal;
+
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	const size_t nb_triangles = mesh.indexCount() / 3;
+
+	FileWriter out(path);
+	out.write(std::string("ply\nformat ") + (binary ? plyFormatName() : "ascii") + " 1.0\n"
+		+ "element vertex " + std::to_string(nb_vertices) + "\n"
+		+ "property float x\nproperty float y\nproperty float z\n"
+		+ "element face " + std::to_string(nb_triangles) + "\n"
+		+ "property list uchar int vertex_indices\n"
+		+ "end_header\n");
+
+	if (binary)
+	{
+		out.write(mesh.vertices.data(), nb_vertices * 3 * sizeof(float));
+
+		// uchar count followed by 3 ints, packed
+		const size_t record_size = 1 + 3 * sizeof(int32_t);
+		writeBlocks(out, nb_triangles, 1 << 16, [&mesh, record_size](size_t first, size_t last, std::string &buffer)
+		{
+			buffer.resize((last - first) * record_size);
+			char *p = &buffer[0];
+			for (size_t i = first; i < last; ++i)
+			{
+				*p++ = 3;
+				for (size_t k = 0; k < 3; ++k)
+				{
+					int32_t index = static_cast<int32_t>(mesh.getIndex(i * 3 + k));
+					memcpy(p, &index, sizeof(index));
+					p += sizeof(index);
+				}
+			}
+		});
+	}
+	else
+	{
+		writeBlocks(out, nb_vertices, 1 << 16, [&mesh](size_t first, size_t last, std::string &buffer)
+		{
+			buffer.resize((last - first) * 100);
+			char *p = &buffer[0];
+			for (size_t i = first; i < last; ++i)
+			{
+				p = MeshIO_format_float(p, mesh.vertices[i * 3]); *p++ = ' ';
+				p = MeshIO_format_float(p, mesh.vertices[i * 3 + 1]); *p++ = ' ';
+				p = MeshIO_format_float(p, mesh.vertices[i * 3 + 2]); *p++ = '\n';
+			}
+			buffer.resize(p - buffer.data());
+		});
+
+		writeBlocks(out, nb_triangles, 1 << 16, [&mesh](size_t first, size_t last, std::string &buffer)
+		{
+			buffer.resize((last - first) * 40);
+			char *p = &buffer[0];
+			for (size_t i = first; i < last; ++i)
+			{
+				*p++ = '3';
+				for (size_t k = 0; k < 3; ++k)
+				{
+					*p++ = ' ';
+					p = MeshIO_format_int(p, mesh.getIndex(i * 3 + k));
+				}
+				*p++ = '\n';
+			}
+			buffer.resize(p - buffer.data());
+		});
+	}
+
+	out.close();
+}
+
+
+void saveMesh(const Mesh &mesh, const std::string &path)
+{
+	std::string ext = path.substr(path.find_last_of('.') + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	if (ext == "obj")
+		saveOBJ(mesh, path);
+	else if (ext == "ply")
+		savePLY(mesh, path);
+	else
+		throw std::runtime_error("Unsupported mesh format: " + path);
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <string>
+#include <cstdio>
+#include <stdexcept>
+
+#include "MeshUtils.h"
+#include "MeshView.h"
+#include "MeshBuilder.h"
+
+
+namespace meshio_internal
+{
+	struct ParsedChunk
+	{
+		std::vector<Vertex> vertices;
+		std::vector<int> face_indices;
+		std::vector<int> face_offsets;
+		std::vector<size_t> relative_indices; // positions in face_indices of negative OBJ indices
+	};
+
+	const char *MeshIO_skip_spaces(const char *p, const char *end);
+
+	const char *MeshIO_next_line(const char *p, const char *end);
+
+	const char *MeshIO_parse_float(const char *p, const char *end, float &out);
+
+	const char *MeshIO_parse_int(const char *p, const char *end, int &out);
+
+	void MeshIO_parse_obj_chunk(const char *begin, const char *end, ParsedChunk &out);
+
+	Mesh MeshIO_merge_chunks(std::vector<ParsedChunk> &chunks, MeshBuildStats *stats);
+
+	// Run by every loader on what it returns: throws std::runtime_error, message
+	// followed by what validateMesh found, when the engines could not process mesh
+	void MeshIO_validate(const Mesh &mesh, const std::string &message);
+
+	void MeshIO_validate(const MeshView &mesh, const std::string &message);
+
+	char *MeshIO_format_float(char *out, float value);
+
+	char *MeshIO_format_int(char *out, int64_t value);
+
+
+	// Output file with a large stdio buffer, throws std::runtime_error when a write fails
+	class FileWriter
+	{
+	private:
+		FILE *m_file;
+		std::string m_path;
+
+	public:
+		FileWriter(const std::string &path) : m_file(fopen(path.c_str(), "wb")), m_path(path)
+		{
+			if (!m_file)
+				throw std::runtime_error("Can not open " + path + " for writing");
+			setvbuf(m_file, nullptr, _IOFBF, 1 << 22);
+		}
+
+		~FileWriter()
+		{
+			if (m_file)
+				fclose(m_file);
+		}
+
+		void write(const void *data, size_t size)
+		{
+			if (size != 0 && fwrite(data, 1, size, m_file) != size)
+				throw std::runtime_error("Can not write to " + m_path);
+		}
+
+		void write(const std::string &str) { write(str.data(), str.size()); }
+
+		void close()
+		{
+			FILE *f = m_file;
+			m_file = nullptr;
+			if (fclose(f) != 0)
+				throw std::runtime_error("Can not write to " + m_path);
+		}
+	};
+}
+
+///<summary>
+///Loads a Wavefront OBJ file into a Mesh.
+///The file is memory mapped and parsed in parallel chunks; only positions and
+///face connectivity are kept. Throws std::runtime_error on unreadable or malformed files,
+///and on meshes that fail validateMesh.
+///</summary>
+Mesh loadOBJ(const std::string &path, MeshBuildStats *stats = nullptr);
+
+///<summary>
+///Loads an ASCII or binary (little or big endian) PLY file into a Mesh.
+///Throws std::runtime_error on unreadable or malformed files, and on meshes
+///that fail validateMesh.
+///</summary>
+Mesh loadPLY(const std::string &path, MeshBuildStats *stats = nullptr);
+
+///<summary>
+///Picks loadOBJ or loadPLY from the file extension.
+///</summary>
+Mesh loadMesh(const std::string &path, MeshBuildStats *stats = nullptr);
+
+
+///<summary>
+///Writes a Mesh as Wavefront OBJ, faces in loop order.
+///Numbers are formatted in parallel blocks while the previous blocks are written,
+///so the whole file never sits in memory. Throws std::runtime_error if the file can not be written.
+///</summary>
+void saveOBJ(const Mesh &mesh, const std::string &path);
+
+///<summary>
+///Writes a RenderableMesh as Wavefront OBJ, one triangle face per index triple.
+///</summary>
+void saveOBJ(const RenderableMesh &mesh, const std::string &path);
+
+///<summary>
+///Writes a Mesh as PLY, binary by default: vertex positions are written straight
+///from memory and face lists are packed in parallel blocks.
+///</summary>
+void savePLY(const Mesh &mesh, const std::string &path, bool binary = true);
+
+///<summary>
+///Writes a RenderableMesh as PLY, one triangle face per index triple.
+///</summary>
+void savePLY(const RenderableMesh &mesh, const std::string &path, bool binary = true);
+
+///<summary>
+///Picks saveOBJ or binary savePLY from the file extension.
+///</summary>
+void saveMesh(const Mesh &mesh, const std::string &path);
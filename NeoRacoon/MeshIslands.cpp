@@ -0,0 +1,230 @@
+#include "MeshIslands.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "CatMull.h"
+#include "Loops.h"
+#include "Kobbelt.h"
+#include "Parallel.h"
+
+
+int meshislands_internal::MeshIslands_find(std::vector<std::atomic<int>> &parents, int slot)
+{
+	int parent = parents[slot].load();
+	while (parent != slot)
+	{
+		// Pointing slot to its grandparent is always valid, losing the race only skips the shortcut
+		int grandparent = parents[parent].load();
+		parents[slot].compare_exchange_weak(parent, grandparent);
+		slot = grandparent;
+		parent = parents[slot].load();
+	}
+	return slot;
+}
+
+void meshislands_internal::MeshIslands_unite(std::vector<std::atomic<int>> &parents, int a, int b)
+{
+	for (;;)
+	{
+		a = MeshIslands_find(parents, a);
+		b = MeshIslands_find(parents, b);
+		if (a == b)
+			return;
+		if (a < b)
+			std::swap(a, b);
+
+		// a is the larger root, it may have been linked meanwhile: retry then
+		int expected = a;
+		if (parents[a].compare_exchange_strong(expected, b))
+			return;
+	}
+}
+
+
+size_t findIslands(const Mesh &mesh, std::vector<int> &vertex_islands)
+{
+	using namespace meshislands_internal;
+
+	const size_t nb_vertices = mesh.vertices.size();
+	std::vector<std::atomic<int>> parents(nb_vertices);
+	for (size_t v = 0; v < nb_vertices; ++v)
+		parents[v].store(static_cast<int>(v));
+
+	parallel::parallelFor(0, mesh.edges.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t e = first; e < last; ++e)
+			MeshIslands_unite(parents, mesh.edges[e].vertices[0], mesh.edges[e].vertices[1]);
+	});
+
+	// Roots are the lowest vertex of their island, so numbering them in vertex
+	// order numbers the islands by their lowest vertex
+	vertex_islands.resize(nb_vertices);
+	int nb_islands = 0;
+	for (size_t v = 0; v < nb_vertices; ++v)
+	{
+		if (parents[v].load() == static_cast<int>(v))
+			vertex_islands[v] = nb_islands++;
+	}
+
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t v = first; v < last; ++v)
+		{
+			int root = MeshIslands_find(parents, static_cast<int>(v));
+			if (root != static_cast<int>(v))
+				vertex_islands[v] = vertex_islands[root];
+		}
+	});
+
+	return static_cast<size_t>(nb_islands);
+}
+
+
+std::vector<MeshIsland> splitIslands(const Mesh &mesh)
+{
+	std::vector<int> vertex_islands;
+	const size_t nb_islands = findIslands(mesh, vertex_islands);
+	std::vector<MeshIsland> islands(nb_islands);
+
+	// Local ids, in source order inside every island
+	std::vector<int> local_vertices(mesh.vertices.size()), local_edges(mesh.edges.size());
+	for (size_t v = 0; v < mesh.vertices.size(); ++v)
+	{
+		MeshIsland &island = islands[vertex_islands[v]];
+		local_vertices[v] = static_cast<int>(island.vertices.size());
+		island.vertices.push_back(static_cast<int>(v));
+	}
+
+	std::vector<int> edge_islands(mesh.edges.size());
+	for (size_t e = 0; e < mesh.edges.size(); ++e)
+	{
+		edge_islands[e] = vertex_islands[mesh.edges[e].vertices[0]];
+		MeshIsland &island = islands[edge_islands[e]];
+		local_edges[e] = static_cast<int>(island.edges.size());
+		island.edges.push_back(static_cast<int>(e));
+	}
+
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+	{
+		const Face &face = mesh.faces[f];
+		int island = 0;
+		if (!face.edges.empty())
+			island = edge_islands[face.edges[0]];
+		else if (!face.vertices.empty())
+			island = vertex_islands[face.vertices[0]];
+		if (nb_islands > 0)
+			islands[island].faces.push_back(static_cast<int>(f));
+	}
+
+	parallel::parallelFor(0, nb_islands, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			MeshIsland &island = islands[i];
+			Mesh &out = island.mesh;
+
+			out.vertices.reserve(island.vertices.size());
+			for (auto it = island.vertices.begin(); it != island.vertices.end(); ++it)
+				out.vertices.push_back(mesh.vertices[*it]);
+
+			out.edges.reserve(island.edges.size());
+			for (auto it = island.edges.begin(); it != island.edges.end(); ++it)
+				out.edges.push_back(Edge(local_vertices[mesh.edges[*it].vertices[0]], local_vertices[mesh.edges[*it].vertices[1]]));
+
+			out.faces.resize(island.faces.size());
+			for (size_t f = 0; f < island.faces.size(); ++f)
+			{
+				const Face &face = mesh.faces[island.faces[f]];
+				out.faces[f].vertices.reserve(face.vertices.size());
+				for (auto it = face.vertices.begin(); it != face.vertices.end(); ++it)
+					out.faces[f].vertices.push_back(local_vertices[*it]);
+				out.faces[f].edges.reserve(face.edges.size());
+				for (auto it = face.edges.begin(); it != face.edges.end(); ++it)
+					out.faces[f].edges.push_back(local_edges[*it]);
+			}
+		}
+	}, 1);
+
+	return islands;
+}
+
+
+Mesh mergeIslands(const std::vector<Mesh> &meshes)
+{
+	Mesh ret;
+	size_t nb_vertices = 0, nb_edges = 0, nb_faces = 0;
+	for (auto it = meshes.begin(); it != meshes.end(); ++it)
+	{
+		nb_vertices += it->vertices.size();
+		nb_edges += it->edges.size();
+		nb_faces += it->faces.size();
+	}
+	ret.vertices.reserve(nb_vertices);
+	ret.edges.reserve(nb_edges);
+	ret.faces.reserve(nb_faces);
+
+	for (auto it = meshes.begin(); it != meshes.end(); ++it)
+	{
+		const int vertex_offset = static_cast<int>(ret.vertices.size());
+		const int edge_offset = static_cast<int>(ret.edges.size());
+
+		ret.vertices.insert(ret.vertices.end(), it->vertices.begin(), it->vertices.end());
+		for (auto e = it->edges.begin(); e != it->edges.end(); ++e)
+			ret.edges.push_back(Edge(e->vertices[0] + vertex_offset, e->vertices[1] + vertex_offset));
+
+		for (auto f = it->faces.begin(); f != it->faces.end(); ++f)
+		{
+			ret.faces.push_back(*f);
+			Face &face = ret.faces.back();
+			for (auto v = face.vertices.begin(); v != face.vertices.end(); ++v)
+				*v += vertex_offset;
+			for (auto e = face.edges.begin(); e != face.edges.end(); ++e)
+				*e += edge_offset;
+		}
+	}
+
+	return ret;
+}
+
+
+Mesh subdivideIslands(const Mesh &mesh, MeshSubdivision scheme, int levels, std::vector<Mesh> *islands)
+{
+	if (levels < 0)
+		throw std::invalid_argument("subdivideIslands: levels must not be negative");
+
+	// The engines run on the workers and open no scope, the whole pass is counted here
+	AllocationScope scope("Island subdivision");
+	std::vector<MeshIsland> pieces = splitIslands(mesh);
+	std::vector<Mesh> results(pieces.size());
+
+	// Biggest islands first, handed out one at a time so that threads stay busy
+	std::vector<size_t> order(pieces.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&pieces](size_t a, size_t b) { return pieces[a].mesh.faces.size() > pieces[b].mesh.faces.size(); });
+
+	std::atomic<size_t> next(0);
+	parallel::parallelFor(0, std::min<size_t>(parallel::threadCount(), pieces.size()), [&](size_t, size_t, unsigned int)
+	{
+		for (size_t i = next++; i < order.size(); i = next++)
+		{
+			Mesh m = std::move(pieces[order[i]].mesh);
+			for (int level = 0; level < levels; ++level)
+			{
+				if (scheme == MESH_SUBDIVISION_CATMULL)
+					m = CatMull(m);
+				else if (scheme == MESH_SUBDIVISION_LOOPS)
+					m = Loops(m);
+				else
+					m = Kobbelt(m);
+			}
+			results[order[i]] = std::move(m);
+		}
+	}, 1);
+
+	Mesh ret = mergeIslands(results);
+	if (islands)
+		islands->swap(results);
+	return ret;
+}
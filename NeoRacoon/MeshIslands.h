@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+
+#include "MeshUtils.h"
+
+
+// Splitting of a Mesh into its connected pieces, so that each one can be
+// subdivided on its own thread and with a much smaller adjacency to search.
+
+enum MeshSubdivision
+{
+	MESH_SUBDIVISION_CATMULL,
+	MESH_SUBDIVISION_LOOPS,
+	MESH_SUBDIVISION_KOBBELT
+};
+
+///<summary>
+///One connected piece of a mesh. vertices, edges and faces map the ids of
+///mesh back to the ids of the source mesh.
+///</summary>
+struct MeshIsland
+{
+	Mesh mesh;
+	std::vector<int> vertices;
+	std::vector<int> edges;
+	std::vector<int> faces;
+};
+
+
+namespace meshislands_internal
+{
+	// Root of slot, halving the path on the way. Safe to race with MeshIslands_unite.
+	int MeshIslands_find(std::vector<std::atomic<int>> &parents, int slot);
+
+	// Links the larger root under the smaller one, so every root ends up being
+	// the lowest vertex of its island
+	void MeshIslands_unite(std::vector<std::atomic<int>> &parents, int a, int b);
+}
+
+
+///<summary>
+///Island id of every vertex, islands numbered by their lowest vertex. Edges are
+///united in parallel with a lock free union-find. Returns the island count.
+///</summary>
+size_t findIslands(const Mesh &mesh, std::vector<int> &vertex_islands);
+
+///<summary>
+///Splits mesh into its islands, in findIslands order, keeping the relative
+///order of vertices, edges and faces inside each of them.
+///</summary>
+std::vector<MeshIsland> splitIslands(const Mesh &mesh);
+
+///<summary>
+///Concatenates meshes into one, offsetting the ids of each by the sizes of the previous ones.
+///</summary>
+Mesh mergeIslands(const std::vector<Mesh> &meshes);
+
+///<summary>
+///Runs levels steps of the given subdivision on every island of mesh, islands
+///in parallel, and merges the results. When islands is given it also receives
+///the subdivided islands, for per island culling.
+///</summary>
+Mesh subdivideIslands(const Mesh &mesh, MeshSubdivision scheme, int levels = 1, std::vector<Mesh> *islands = nullptr);
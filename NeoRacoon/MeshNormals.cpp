@@ -0,0 +1,304 @@
+#include "MeshNormals.h"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define MESHNORMALS_SSE
+#endif
+
+#include "Parallel.h"
+
+
+void meshnormals_internal::MeshNormals_normalize(float *xyz, size_t count)
+{
+	size_t i = 0;
+
+#ifdef MESHNORMALS_SSE
+	const __m128 zero = _mm_setzero_ps(), half = _mm_set1_ps(0.5f), three_halves = _mm_set1_ps(1.5f);
+	for (; i + 4 <= count; i += 4)
+	{
+		float *p = xyz + i * 3;
+		__m128 x = _mm_setr_ps(p[0], p[3], p[6], p[9]);
+		__m128 y = _mm_setr_ps(p[1], p[4], p[7], p[10]);
+		__m128 z = _mm_setr_ps(p[2], p[5], p[8], p[11]);
+
+		__m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+		// rsqrt estimate refined by one Newton step, zero lengths masked out
+		__m128 r = _mm_rsqrt_ps(l2);
+		r = _mm_mul_ps(r, _mm_sub_ps(three_halves, _mm_mul_ps(_mm_mul_ps(half, l2), _mm_mul_ps(r, r))));
+		r = _mm_and_ps(r, _mm_cmpgt_ps(l2, zero));
+
+		float out[3][4];
+		_mm_storeu_ps(out[0], _mm_mul_ps(x, r));
+		_mm_storeu_ps(out[1], _mm_mul_ps(y, r));
+		_mm_storeu_ps(out[2], _mm_mul_ps(z, r));
+		for (int k = 0; k < 4; ++k)
+		{
+			p[k * 3] = out[0][k];
+			p[k * 3 + 1] = out[1][k];
+			p[k * 3 + 2] = out[2][k];
+		}
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		float *p = xyz + i * 3;
+		float l = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (l > 0.0f)
+		{
+			p[0] /= l;
+			p[1] /= l;
+			p[2] /= l;
+		}
+	}
+}
+
+
+namespace meshnormals_internal
+{
+	// Newell normal of a face loop, its length is twice the face area. Flipped to
+	// point away from barycenter, as MeshUtils_triangulate winds the face.
+	template<typename MeshT>
+	Vertex faceNormal(const MeshT &mesh, const std::vector<int> &loop, const Vertex &barycenter)
+	{
+		const size_t n = loop.size();
+		Vertex normal, center;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const Vertex &a = mesh.vertices[loop[i]];
+			const Vertex &b = mesh.vertices[loop[(i + 1) % n]];
+			normal.x += (a.y - b.y) * (a.z + b.z);
+			normal.y += (a.z - b.z) * (a.x + b.x);
+			normal.z += (a.x - b.x) * (a.y + b.y);
+			center.x += a.x;
+			center.y += a.y;
+			center.z += a.z;
+		}
+
+		if (n == 0)
+			return normal;
+
+		float dot = normal.x * (center.x / n - barycenter.x) + normal.y * (center.y / n - barycenter.y) + normal.z * (center.z / n - barycenter.z);
+		if (dot < 0)
+			normal = Vertex(-normal.x, -normal.y, -normal.z);
+		return normal;
+	}
+
+	void resetCursors(NormalsWorkspace &ws, size_t n)
+	{
+		if (ws.nb_cursors < n)
+		{
+			ws.cursors.reset(new std::atomic<uint32_t>[n]);
+			ws.nb_cursors = n;
+		}
+
+		std::atomic<uint32_t> *cursors = ws.cursors.get();
+		parallel::parallelFor(0, n, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t v = first; v < last; ++v)
+				cursors[v].store(0, std::memory_order_relaxed);
+		}, 1 << 14);
+	}
+
+	// Faces around each vertex into ws.offsets and ws.vertex_faces. corners(f, add)
+	// calls add(v) for every vertex slot of face f. Counts and writes go through
+	// atomic cursors, per block prefix sums turn the counts into offsets. Faces
+	// land in any order within a vertex when several blocks write them, returns
+	// false then so the gather sorts them and sums are repeatable.
+	template<typename CornersT>
+	bool vertexFaces(size_t nb_vertices, size_t nb_faces, CornersT corners, NormalsWorkspace &ws)
+	{
+		resetCursors(ws, nb_vertices);
+		std::atomic<uint32_t> *cursors = ws.cursors.get();
+
+		parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t f = first; f < last; ++f)
+				corners(f, [&](uint32_t v) { cursors[v].fetch_add(1, std::memory_order_relaxed); });
+		}, 1024);
+
+		const size_t grain = 1 << 14;
+		const size_t nb_blocks = parallel::blockCount(nb_vertices, grain);
+		ws.offsets.resize(nb_vertices + 1);
+		ws.block_sums.assign(nb_blocks + 1, 0);
+		parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int block)
+		{
+			uint32_t sum = 0;
+			for (size_t v = first; v < last; ++v)
+			{
+				ws.offsets[v] = sum;
+				sum += cursors[v].load(std::memory_order_relaxed);
+			}
+			ws.block_sums[block + 1] = sum;
+		}, grain);
+		for (size_t b = 0; b < nb_blocks; ++b)
+			ws.block_sums[b + 1] += ws.block_sums[b];
+		parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int block)
+		{
+			for (size_t v = first; v < last; ++v)
+			{
+				ws.offsets[v] += ws.block_sums[block];
+				cursors[v].store(ws.offsets[v], std::memory_order_relaxed);
+			}
+		}, grain);
+		ws.offsets[nb_vertices] = ws.block_sums[nb_blocks];
+
+		ws.vertex_faces.resize(ws.offsets[nb_vertices]);
+		parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t f = first; f < last; ++f)
+				corners(f, [&](uint32_t v) { ws.vertex_faces[cursors[v].fetch_add(1, std::memory_order_relaxed)] = static_cast<uint32_t>(f); });
+		}, 1024);
+
+		return parallel::blockCount(nb_faces, 1024) <= 1;
+	}
+
+	// Sum of the face normals around every vertex, normalized, into xyz
+	void gatherNormals(size_t nb_vertices, NormalsWorkspace &ws, bool ordered, float *xyz)
+	{
+		parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t v = first; v < last; ++v)
+			{
+				uint32_t *faces = ws.vertex_faces.data();
+				if (!ordered)
+					std::sort(faces + ws.offsets[v], faces + ws.offsets[v + 1]);
+
+				Vertex n;
+				for (uint32_t i = ws.offsets[v]; i < ws.offsets[v + 1]; ++i)
+				{
+					const Vertex &fn = ws.face_normals[faces[i]];
+					n.x += fn.x;
+					n.y += fn.y;
+					n.z += fn.z;
+				}
+				xyz[v * 3] = n.x;
+				xyz[v * 3 + 1] = n.y;
+				xyz[v * 3 + 2] = n.z;
+			}
+
+			MeshNormals_normalize(xyz + first * 3, last - first);
+		});
+	}
+
+	template<typename MeshT>
+	void meshNormals(const MeshT &mesh, std::vector<Vertex> &normals, NormalsWorkspace &ws)
+	{
+		static_assert(sizeof(Vertex) == 3 * sizeof(float), "Vertex must be tightly packed");
+
+		const size_t nb_vertices = mesh.vertices.size();
+		const size_t nb_faces = mesh.faces.size();
+		const Vertex barycenter = nb_vertices ? mesh.getBaryCenter() : Vertex();
+
+		ws.face_normals.resize(nb_faces);
+		if (ws.loops.size() < parallel::threadCount())
+			ws.loops.resize(parallel::threadCount());
+		parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int block)
+		{
+			std::vector<int> &loop = ws.loops[block];
+			for (size_t f = first; f < last; ++f)
+			{
+				mesh.getFaceLoop(static_cast<int>(f), loop);
+				ws.face_normals[f] = faceNormal(mesh, loop, barycenter);
+			}
+		}, 1024);
+
+		// Faces around each vertex, read from the face edges: every vertex of a
+		// face is on two of its edges, which only scales the sum by two
+		const bool ordered = vertexFaces(nb_vertices, nb_faces, [&](size_t f, auto add)
+		{
+			const auto &edges = mesh.faces[f].edges;
+			for (auto it = edges.begin(); it != edges.end(); ++it)
+			{
+				add(mesh.edges[*it].vertices[0]);
+				add(mesh.edges[*it].vertices[1]);
+			}
+		}, ws);
+
+		normals.resize(nb_vertices);
+		gatherNormals(nb_vertices, ws, ordered, nb_vertices ? &normals[0].x : nullptr);
+	}
+
+	template<typename IndexT>
+	void renderableNormals(RenderableMesh &mesh, const IndexT *indices, size_t nb_triangles, NormalsWorkspace &ws)
+	{
+		const size_t nb_vertices = mesh.vertices.size() / 3;
+
+		// Cross products are twice the triangle area, which is the weight we want
+		ws.face_normals.resize(nb_triangles);
+		parallel::parallelFor(0, nb_triangles, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t t = first; t < last; ++t)
+			{
+				const float *a = &mesh.vertices[indices[t * 3] * 3];
+				const float *b = &mesh.vertices[indices[t * 3 + 1] * 3];
+				const float *c = &mesh.vertices[indices[t * 3 + 2] * 3];
+				glm::vec3 A(a[0], a[1], a[2]);
+				glm::vec3 n = glm::cross(glm::vec3(b[0], b[1], b[2]) - A, glm::vec3(c[0], c[1], c[2]) - A);
+				ws.face_normals[t] = Vertex(n.x, n.y, n.z);
+			}
+		});
+
+		const bool ordered = vertexFaces(nb_vertices, nb_triangles, [&](size_t t, auto add)
+		{
+			add(indices[t * 3]);
+			add(indices[t * 3 + 1]);
+			add(indices[t * 3 + 2]);
+		}, ws);
+
+		mesh.normals.resize(nb_vertices * 3);
+		gatherNormals(nb_vertices, ws, ordered, mesh.normals.data());
+	}
+}
+
+
+Vertex meshnormals_internal::MeshNormals_face_normal(const Mesh &mesh, const std::vector<int> &loop, const Vertex &barycenter)
+{
+	return faceNormal(mesh, loop, barycenter);
+}
+
+Vertex meshnormals_internal::MeshNormals_face_normal(const MeshView &mesh, const std::vector<int> &loop, const Vertex &barycenter)
+{
+	return faceNormal(mesh, loop, barycenter);
+}
+
+
+void computeNormals(RenderableMesh &mesh, NormalsWorkspace &workspace)
+{
+	if (mesh.hasWideIndices())
+		meshnormals_internal::renderableNormals(mesh, mesh.indices32.data(), mesh.indices32.size() / 3, workspace);
+	else
+		meshnormals_internal::renderableNormals(mesh, mesh.indices.data(), mesh.indices.size() / 3, workspace);
+}
+
+void computeNormals(RenderableMesh &mesh)
+{
+	NormalsWorkspace workspace;
+	computeNormals(mesh, workspace);
+}
+
+void computeNormals(const Mesh &mesh, std::vector<Vertex> &normals, NormalsWorkspace &workspace)
+{
+	meshnormals_internal::meshNormals(mesh, normals, workspace);
+}
+
+void computeNormals(const Mesh &mesh, std::vector<Vertex> &normals)
+{
+	NormalsWorkspace workspace;
+	computeNormals(mesh, normals, workspace);
+}
+
+void computeNormals(const MeshView &mesh, std::vector<Vertex> &normals, NormalsWorkspace &workspace)
+{
+	meshnormals_internal::meshNormals(mesh, normals, workspace);
+}
+
+void computeNormals(const MeshView &mesh, std::vector<Vertex> &normals)
+{
+	NormalsWorkspace workspace;
+	computeNormals(mesh, normals, workspace);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+
+#include "MeshUtils.h"
+#include "MeshView.h"
+
+
+// Area weighted vertex normals. Face normals are computed in parallel, then
+// every vertex gathers the normals of its faces, so no two threads ever write
+// the same vertex and no per-thread copies of the output are needed.
+
+///<summary>
+///Scratch buffers of computeNormals. Buffers only grow, so a workspace passed
+///to every call stops allocating once it has seen the largest mesh.
+///</summary>
+struct NormalsWorkspace
+{
+	std::vector<Vertex> face_normals;
+	std::vector<uint32_t> offsets; // faces of vertex v in vertex_faces[offsets[v], offsets[v + 1])
+	std::vector<uint32_t> vertex_faces;
+	std::vector<uint32_t> block_sums;
+	std::vector<std::vector<int>> loops; // face loop of each block
+	std::unique_ptr<std::atomic<uint32_t>[]> cursors; // per vertex counts, then write positions
+	size_t nb_cursors;
+
+	NormalsWorkspace() : nb_cursors(0) {}
+};
+
+namespace meshnormals_internal
+{
+	///<summary>
+	///Normalizes count packed xyz vectors in place, 4 at a time with SSE where
+	///available. Zero vectors stay zero.
+	///</summary>
+	void MeshNormals_normalize(float *xyz, size_t count);
+
+	// Newell normal of a face loop, as long as twice the face area and pointing
+	// away from barycenter
+	Vertex MeshNormals_face_normal(const Mesh &mesh, const std::vector<int> &loop, const Vertex &barycenter);
+
+	Vertex MeshNormals_face_normal(const MeshView &mesh, const std::vector<int> &loop, const Vertex &barycenter);
+}
+
+
+///<summary>
+///Fills mesh.normals, one normal per vertex, from its triangles weighted by area.
+///The 16 or 32 bit indices are read in place.
+///</summary>
+void computeNormals(RenderableMesh &mesh, NormalsWorkspace &workspace);
+
+void computeNormals(RenderableMesh &mesh);
+
+///<summary>
+///One normal per vertex of a polygon Mesh, each face weighted by its area. Faces
+///are oriented as getRenderableMesh winds them, away from the mesh barycenter.
+///normals is resized; with the same normals and workspace on every call, calls
+///stop allocating once both have grown to the mesh.
+///</summary>
+void computeNormals(const Mesh &mesh, std::vector<Vertex> &normals, NormalsWorkspace &workspace);
+
+void computeNormals(const Mesh &mesh, std::vector<Vertex> &normals);
+
+void computeNormals(const MeshView &mesh, std::vector<Vertex> &normals, NormalsWorkspace &workspace);
+
+void computeNormals(const MeshView &mesh, std::vector<Vertex> &normals);
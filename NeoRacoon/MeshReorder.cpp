@@ -0,0 +1,212 @@
+#include "MeshReorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parallel.h"
+
+
+namespace meshreorder_internal
+{
+	// Spreads the low 21 bits of v so that two zero bits separate each of them
+	uint64_t spreadBits(uint32_t v)
+	{
+		uint64_t x = v & 0x1FFFFF;
+		x = (x | x << 32) & 0x1F00000000FFFFULL;
+		x = (x | x << 16) & 0x1F0000FF0000FFULL;
+		x = (x | x << 8) & 0x100F00F00F00F00FULL;
+		x = (x | x << 4) & 0x10C30C30C30C30C3ULL;
+		x = (x | x << 2) & 0x1249249249249249ULL;
+		return x;
+	}
+
+	void quantize(const Vertex &v, const Vertex &min, const float *scale, uint32_t *out)
+	{
+		const float *p = &v.x, *m = &min.x;
+		const uint32_t max_q = (1u << MeshReorder_BITS) - 1;
+		for (int k = 0; k < 3; ++k)
+		{
+			float q = (p[k] - m[k]) * scale[k];
+			out[k] = q <= 0.0f ? 0 : std::min(max_q, static_cast<uint32_t>(q));
+		}
+	}
+}
+
+
+uint64_t meshreorder_internal::MeshReorder_key(uint32_t x, uint32_t y, uint32_t z, MeshCurve curve)
+{
+	if (curve == MESH_CURVE_HILBERT)
+	{
+		// Skilling's transform of the axes into the transposed Hilbert index,
+		// which then interleaves like a Morton code
+		uint32_t X[3] = { x, y, z };
+		const uint32_t M = 1u << (MeshReorder_BITS - 1);
+
+		for (uint32_t Q = M; Q > 1; Q >>= 1)
+		{
+			uint32_t P = Q - 1;
+			for (int i = 0; i < 3; ++i)
+			{
+				if (X[i] & Q)
+					X[0] ^= P;
+				else
+				{
+					uint32_t t = (X[0] ^ X[i]) & P;
+					X[0] ^= t;
+					X[i] ^= t;
+				}
+			}
+		}
+
+		for (int i = 1; i < 3; ++i)
+			X[i] ^= X[i - 1];
+		uint32_t t = 0;
+		for (uint32_t Q = M; Q > 1; Q >>= 1)
+		{
+			if (X[2] & Q)
+				t ^= Q - 1;
+		}
+		for (int i = 0; i < 3; ++i)
+			X[i] ^= t;
+
+		x = X[0];
+		y = X[1];
+		z = X[2];
+	}
+
+	return spreadBits(x) << 2 | spreadBits(y) << 1 | spreadBits(z);
+}
+
+std::vector<int> meshreorder_internal::MeshReorder_order(std::vector<uint64_t> &keys)
+{
+	std::vector<uint32_t> ids(keys.size());
+	for (size_t i = 0; i < ids.size(); ++i)
+		ids[i] = static_cast<uint32_t>(i);
+
+	parallel::radixSort(keys, ids);
+
+	std::vector<int> remap(ids.size());
+	for (size_t i = 0; i < ids.size(); ++i)
+		remap[ids[i]] = static_cast<int>(i);
+	return remap;
+}
+
+
+void reorderMesh(Mesh &mesh, MeshCurve curve, MeshRemap *remap)
+{
+	using namespace meshreorder_internal;
+
+	const size_t nb_vertices = mesh.vertices.size();
+	const size_t nb_edges = mesh.edges.size();
+	const size_t nb_faces = mesh.faces.size();
+
+	Vertex min = nb_vertices ? mesh.vertices[0] : Vertex(), max = min;
+	for (auto it = mesh.vertices.begin(); it != mesh.vertices.end(); ++it)
+	{
+		min = Vertex(std::min(min.x, it->x), std::min(min.y, it->y), std::min(min.z, it->z));
+		max = Vertex(std::max(max.x, it->x), std::max(max.y, it->y), std::max(max.z, it->z));
+	}
+
+	// One scale for the three axes keeps the cells cubic
+	float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+	float s = extent > 0.0f ? static_cast<float>((1u << MeshReorder_BITS) - 1) / extent : 0.0f;
+	const float scale[3] = { s, s, s };
+
+	// Vertices
+	std::vector<uint64_t> keys(nb_vertices);
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		uint32_t q[3];
+		for (size_t i = first; i < last; ++i)
+		{
+			quantize(mesh.vertices[i], min, scale, q);
+			keys[i] = MeshReorder_key(q[0], q[1], q[2], curve);
+		}
+	});
+	std::vector<int> vertex_remap = MeshReorder_order(keys);
+
+	// Faces, by centroid. Faces without vertices (Loops' inner faces) use their edges.
+	keys.assign(nb_faces, 0);
+	parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+	{
+		uint32_t q[3];
+		for (size_t i = first; i < last; ++i)
+		{
+			const Face &f = mesh.faces[i];
+			Vertex c;
+			size_t n = 0;
+			auto add = [&](int v) { c.x += mesh.vertices[v].x; c.y += mesh.vertices[v].y; c.z += mesh.vertices[v].z; ++n; };
+			if (!f.vertices.empty())
+				std::for_each(f.vertices.begin(), f.vertices.end(), add);
+			else
+			{
+				for (auto it = f.edges.begin(); it != f.edges.end(); ++it)
+				{
+					add(mesh.edges[*it].vertices[0]);
+					add(mesh.edges[*it].vertices[1]);
+				}
+			}
+			if (n)
+				c = Vertex(c.x / n, c.y / n, c.z / n);
+
+			quantize(c, min, scale, q);
+			keys[i] = MeshReorder_key(q[0], q[1], q[2], curve);
+		}
+	});
+	std::vector<int> face_remap = MeshReorder_order(keys);
+
+	// Edges, by their renumbered vertices
+	keys.resize(nb_edges);
+	parallel::parallelFor(0, nb_edges, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			uint64_t a = static_cast<uint32_t>(vertex_remap[mesh.edges[i].vertices[0]]);
+			uint64_t b = static_cast<uint32_t>(vertex_remap[mesh.edges[i].vertices[1]]);
+			keys[i] = std::min(a, b) << 32 | std::max(a, b);
+		}
+	});
+	std::vector<int> edge_remap = MeshReorder_order(keys);
+
+	// Apply
+	std::vector<Vertex> vertices(nb_vertices);
+	std::vector<Edge> edges(nb_edges);
+	std::vector<Face> faces(nb_faces);
+
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+			vertices[vertex_remap[i]] = mesh.vertices[i];
+	});
+
+	parallel::parallelFor(0, nb_edges, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+			edges[edge_remap[i]] = Edge(vertex_remap[mesh.edges[i].vertices[0]], vertex_remap[mesh.edges[i].vertices[1]]);
+	});
+
+	parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			Face &f = faces[face_remap[i]];
+			f.vertices.swap(mesh.faces[i].vertices);
+			f.edges.swap(mesh.faces[i].edges);
+			for (auto it = f.vertices.begin(); it != f.vertices.end(); ++it)
+				*it = vertex_remap[*it];
+			for (auto it = f.edges.begin(); it != f.edges.end(); ++it)
+				*it = edge_remap[*it];
+		}
+	}, 1024);
+
+	mesh.vertices.swap(vertices);
+	mesh.edges.swap(edges);
+	mesh.faces.swap(faces);
+
+	if (remap)
+	{
+		remap->vertices.swap(vertex_remap);
+		remap->edges.swap(edge_remap);
+		remap->faces.swap(face_remap);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MeshUtils.h"
+
+
+// Spatial reordering of a Mesh along a space filling curve, so that elements
+// close in space are close in memory.
+
+enum MeshCurve
+{
+	MESH_CURVE_MORTON, // Z-order, cheapest key
+	MESH_CURVE_HILBERT // no jumps between neighbouring cells, better locality
+};
+
+///<summary>
+///Old id to new id tables of a reordering.
+///</summary>
+struct MeshRemap
+{
+	std::vector<int> vertices;
+	std::vector<int> edges;
+	std::vector<int> faces;
+};
+
+
+namespace meshreorder_internal
+{
+	const int MeshReorder_BITS = 21; // per axis, 63 bit keys
+
+	// Key of a point quantized to MeshReorder_BITS bits per axis
+	uint64_t MeshReorder_key(uint32_t x, uint32_t y, uint32_t z, MeshCurve curve);
+
+	// Sorts ids by key, returns the old id to new id table
+	std::vector<int> MeshReorder_order(std::vector<uint64_t> &keys);
+}
+
+
+///<summary>
+///Sorts the vertices of mesh along the curve, the faces along the curve by
+///centroid and the edges by their (renumbered) vertices, and remaps every index.
+///The subdivision engines emit the children of a face (a vertex for Kobbelt)
+///contiguously and in parent order, so subdividing a reordered mesh gives an
+///output that keeps the curve order.
+///</summary>
+void reorderMesh(Mesh &mesh, MeshCurve curve = MESH_CURVE_MORTON, MeshRemap *remap = nullptr);
@@ -0,0 +1,439 @@
+#include "MeshSDF.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+#include "MeshFile.h"
+#include "MeshIO.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+
+SignedDistanceField::SignedDistanceField() : m_origin(0.0f), m_cell_size(1.0f), m_band(0.0f)
+{
+	m_dims[0] = m_dims[1] = m_dims[2] = 0;
+}
+
+SignedDistanceField::SignedDistanceField(const glm::vec3 &origin, float cell_size, int nx, int ny, int nz, float band) :
+	m_origin(origin), m_cell_size(cell_size), m_band(band)
+{
+	if (!(cell_size > 0.0f))
+		throw std::invalid_argument("SignedDistanceField: cell size must be positive");
+	if (nx < 2 || ny < 2 || nz < 2)
+		throw std::invalid_argument("SignedDistanceField: the grid needs at least 2 nodes per axis");
+
+	m_dims[0] = nx;
+	m_dims[1] = ny;
+	m_dims[2] = nz;
+	m_distances.assign(static_cast<size_t>(nx) * ny * nz, 0.0f);
+}
+
+
+namespace meshsdf_internal
+{
+	// Corner of the cell holding p and the position of p inside it, clamped to the grid,
+	// and how far p lies past the grid on each axis, zero inside it
+	struct Cell
+	{
+		size_t base;
+		float fx, fy, fz;
+		glm::vec3 outside;
+	};
+
+	float clampedCoord(float g, int n, int &i, float &excess)
+	{
+		const float clamped = std::min(std::max(g, 0.0f), static_cast<float>(n - 1));
+		excess = g - clamped;
+		i = std::min(static_cast<int>(clamped), n - 2);
+		return clamped - i;
+	}
+
+	Cell locate(const SignedDistanceField &sdf, const glm::vec3 &p)
+	{
+		const glm::vec3 g = (p - sdf.origin()) / sdf.cellSize();
+		int i, j, k;
+		Cell c;
+		c.fx = clampedCoord(g.x, sdf.size(0), i, c.outside.x);
+		c.fy = clampedCoord(g.y, sdf.size(1), j, c.outside.y);
+		c.fz = clampedCoord(g.z, sdf.size(2), k, c.outside.z);
+		c.outside *= sdf.cellSize();
+		c.base = sdf.index(i, j, k);
+		return c;
+	}
+
+	float lerp(float a, float b, float t)
+	{
+		return a + (b - a) * t;
+	}
+}
+
+
+float SignedDistanceField::sample(const glm::vec3 &p) const
+{
+	using namespace meshsdf_internal;
+
+	const Cell c = locate(*this, p);
+	const size_t dy = m_dims[0], dz = static_cast<size_t>(m_dims[0]) * m_dims[1];
+	const float *d = m_distances.data() + c.base;
+
+	float y0 = lerp(lerp(d[0], d[1], c.fx), lerp(d[dy], d[dy + 1], c.fx), c.fy);
+	float y1 = lerp(lerp(d[dz], d[dz + 1], c.fx), lerp(d[dz + dy], d[dz + dy + 1], c.fx), c.fy);
+	// Past the grid, the distance to the border position is added on
+	return lerp(y0, y1, c.fz) + glm::length(c.outside);
+}
+
+glm::vec3 SignedDistanceField::gradient(const glm::vec3 &p, float *distance) const
+{
+	using namespace meshsdf_internal;
+
+	const Cell c = locate(*this, p);
+	const size_t dy = m_dims[0], dz = static_cast<size_t>(m_dims[0]) * m_dims[1];
+	const float *d = m_distances.data() + c.base;
+	const float d000 = d[0], d100 = d[1], d010 = d[dy], d110 = d[dy + 1];
+	const float d001 = d[dz], d101 = d[dz + 1], d011 = d[dz + dy], d111 = d[dz + dy + 1];
+
+	// Derivatives of the trilinear interpolant, per cell then per unit of length
+	glm::vec3 g(
+		lerp(lerp(d100 - d000, d110 - d010, c.fy), lerp(d101 - d001, d111 - d011, c.fy), c.fz),
+		lerp(lerp(d010 - d000, d110 - d100, c.fx), lerp(d011 - d001, d111 - d101, c.fx), c.fz),
+		lerp(lerp(d001 - d000, d101 - d100, c.fx), lerp(d011 - d010, d111 - d110, c.fx), c.fy));
+	g /= m_cell_size;
+
+	// Past the grid the interpolant is constant along the clamped axes, and the
+	// added distance to the border grows along the way out
+	const float excess = glm::length(c.outside);
+	if (excess > 0.0f)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			if (c.outside[axis] != 0.0f)
+				g[axis] = 0.0f;
+		}
+		g += c.outside / excess;
+	}
+
+	if (distance)
+	{
+		float y0 = lerp(lerp(d000, d100, c.fx), lerp(d010, d110, c.fx), c.fy);
+		float y1 = lerp(lerp(d001, d101, c.fx), lerp(d011, d111, c.fx), c.fy);
+		*distance = lerp(y0, y1, c.fz) + excess;
+	}
+
+	return g;
+}
+
+glm::vec3 SignedDistanceField::normal(const glm::vec3 &p) const
+{
+	glm::vec3 g = gradient(p);
+	float length = glm::length(g);
+	return length > 0.0f ? g / length : glm::vec3(0.0f);
+}
+
+
+void meshsdf_internal::MeshSDF_flood(const MeshBVH &bvh, const glm::vec3 &origin, float cell_size, const int dims[3], int band, std::vector<float> &distances)
+{
+	const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+	const size_t nb_nodes = nx * ny * nz;
+	const size_t nb_triangles = bvh.indices.size() / 3;
+	const float inf = std::numeric_limits<float>::max();
+
+	std::vector<glm::vec3> closest(nb_nodes);
+	std::vector<float> dist2(nb_nodes, inf);
+
+	// Node range of every triangle's bounds, grown by the band
+	std::vector<int> ranges(nb_triangles * 6);
+	parallel::parallelFor(0, nb_triangles, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t t = first; t < last; ++t)
+		{
+			const glm::vec3 &a = bvh.positions[bvh.indices[t * 3]];
+			const glm::vec3 &b = bvh.positions[bvh.indices[t * 3 + 1]];
+			const glm::vec3 &c = bvh.positions[bvh.indices[t * 3 + 2]];
+			const glm::vec3 lo = (glm::min(a, glm::min(b, c)) - origin) / cell_size;
+			const glm::vec3 hi = (glm::max(a, glm::max(b, c)) - origin) / cell_size;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				ranges[t * 6 + axis] = std::max(static_cast<int>(std::floor(lo[axis])) - band, 0);
+				ranges[t * 6 + 3 + axis] = std::min(static_cast<int>(std::ceil(hi[axis])) + band, dims[axis] - 1);
+			}
+		}
+	});
+
+	// Exact band: every block owns a range of z slices and takes the triangles reaching them
+	parallel::parallelFor(0, nz, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t t = 0; t < nb_triangles; ++t)
+		{
+			const int *r = &ranges[t * 6];
+			const int k0 = std::max(r[2], static_cast<int>(first)), k1 = std::min(r[5], static_cast<int>(last) - 1);
+			if (k0 > k1)
+				continue;
+
+			const glm::vec3 &a = bvh.positions[bvh.indices[t * 3]];
+			const glm::vec3 &b = bvh.positions[bvh.indices[t * 3 + 1]];
+			const glm::vec3 &c = bvh.positions[bvh.indices[t * 3 + 2]];
+			for (int k = k0; k <= k1; ++k)
+			{
+				for (int j = r[1]; j <= r[4]; ++j)
+				{
+					for (int i = r[0]; i <= r[3]; ++i)
+					{
+						const glm::vec3 p = origin + cell_size * glm::vec3(static_cast<float>(i), static_cast<float>(j), static_cast<float>(k));
+						const glm::vec3 q = meshbvh_internal::MeshBVH_closest_point(p, a, b, c);
+						const glm::vec3 e = p - q;
+						const float d2 = glm::dot(e, e);
+						const size_t node = (k * ny + j) * nx + i;
+						if (d2 < dist2[node])
+						{
+							dist2[node] = d2;
+							closest[node] = q;
+						}
+					}
+				}
+			}
+		}
+	}, 1);
+
+	// Jump flood: every node takes the nearest of the closest points held by the
+	// nodes step away, for halving steps, and a last pass at step 1. Band nodes
+	// are exact already and only pass their points on.
+	const float band_length = band * cell_size;
+	const float exact2 = band_length * band_length;
+	std::vector<int> steps;
+	int step = 1;
+	while (step * 2 < static_cast<int>(std::max(nx, std::max(ny, nz))))
+		step *= 2;
+	for (; step >= 1; step /= 2)
+		steps.push_back(step);
+	steps.push_back(1);
+
+	std::vector<glm::vec3> next_closest;
+	std::vector<float> next_dist2;
+	for (auto it = steps.begin(); it != steps.end(); ++it)
+	{
+		next_closest = closest;
+		next_dist2 = dist2;
+
+		const int s = *it;
+		parallel::parallelFor(0, nz, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t k = first; k < last; ++k)
+			{
+				for (size_t j = 0; j < ny; ++j)
+				{
+					for (size_t i = 0; i < nx; ++i)
+					{
+						const size_t node = (k * ny + j) * nx + i;
+						if (dist2[node] <= exact2)
+							continue;
+
+						const glm::vec3 p = origin + cell_size * glm::vec3(static_cast<float>(i), static_cast<float>(j), static_cast<float>(k));
+						float best = dist2[node];
+						glm::vec3 best_point = closest[node];
+						for (int dk = -s; dk <= s; dk += s)
+						{
+							const int nk = static_cast<int>(k) + dk;
+							if (nk < 0 || nk >= static_cast<int>(nz))
+								continue;
+							for (int dj = -s; dj <= s; dj += s)
+							{
+								const int nj = static_cast<int>(j) + dj;
+								if (nj < 0 || nj >= static_cast<int>(ny))
+									continue;
+								for (int di = -s; di <= s; di += s)
+								{
+									const int ni = static_cast<int>(i) + di;
+									if (ni < 0 || ni >= static_cast<int>(nx))
+										continue;
+									const size_t other = (nk * ny + nj) * nx + ni;
+									if (dist2[other] == inf)
+										continue;
+									const glm::vec3 e = p - closest[other];
+									const float d2 = glm::dot(e, e);
+									if (d2 < best)
+									{
+										best = d2;
+										best_point = closest[other];
+									}
+								}
+							}
+						}
+						next_dist2[node] = best;
+						next_closest[node] = best_point;
+					}
+				}
+			}
+		}, 1);
+
+		closest.swap(next_closest);
+		dist2.swap(next_dist2);
+	}
+
+	distances.resize(nb_nodes);
+	parallel::parallelFor(0, nb_nodes, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t n = first; n < last; ++n)
+			distances[n] = std::sqrt(dist2[n]);
+	});
+}
+
+
+void meshsdf_internal::MeshSDF_sign(const MeshBVH &bvh, const glm::vec3 &origin, float cell_size, const int dims[3], std::vector<float> &distances)
+{
+	const size_t nx = dims[0], ny = dims[1], nz = dims[2];
+
+	// The jitter must survive rounding at the coordinates of the grid, not only be
+	// small against a cell, or it vanishes for meshes far from the origin. ulp
+	// bounds the spacing of floats over the grid
+	float magnitude = 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+		magnitude = std::max(magnitude, std::max(std::abs(origin[axis]), std::abs(origin[axis] + (dims[axis] + 1) * cell_size)));
+	const float ulp = magnitude * std::numeric_limits<float>::epsilon();
+
+	// Rays run a hair off the node rows, so that they do not go exactly through
+	// the vertices and edges of meshes aligned on the grid
+	const float jitter_y = std::max(cell_size * 1.3e-4f, ulp * 1.3f), jitter_z = std::max(cell_size * 0.7e-4f, ulp * 0.7f);
+	const float length = (nx + 1) * cell_size;
+	const size_t max_crossings = 4 * nx + 64;
+
+	parallel::parallelFor(0, ny * nz, [&](size_t first, size_t last, unsigned int)
+	{
+		std::vector<float> crossings;
+		for (size_t row = first; row < last; ++row)
+		{
+			const size_t j = row % ny, k = row / ny;
+			const glm::vec3 o(origin.x - cell_size, origin.y + j * cell_size + jitter_y, origin.z + k * cell_size + jitter_z);
+
+			// The origin stays put and every query starts just past the last hit,
+			// so a crossing is never counted twice nor skipped, whatever the scale.
+			// Two triangles hit at the same t share the edge crossed, counted once
+			crossings.clear();
+			BVHHit hit;
+			float t_min = 0.0f;
+			while (t_min <= length && crossings.size() < max_crossings && intersectRay(bvh, o, glm::vec3(1.0f, 0.0f, 0.0f), hit, t_min, length))
+			{
+				crossings.push_back(o.x + hit.t);
+				t_min = std::nextafter(hit.t, std::numeric_limits<float>::max());
+			}
+
+			size_t passed = 0;
+			float *d = distances.data() + row * nx;
+			for (size_t i = 0; i < nx; ++i)
+			{
+				const float x = origin.x + i * cell_size;
+				while (passed < crossings.size() && crossings[passed] < x)
+					++passed;
+				if (passed % 2 == 1)
+					d[i] = -d[i];
+			}
+		}
+	}, 16);
+}
+
+
+SignedDistanceField bakeSDF(const MeshBVH &bvh, float cell_size, int band)
+{
+	using namespace meshsdf_internal;
+
+	if (bvh.nodes.empty() || bvh.indices.size() < 3)
+		throw std::invalid_argument("bakeSDF: the mesh has no triangles");
+	if (!(cell_size > 0.0f))
+		throw std::invalid_argument("bakeSDF: cell_size must be positive");
+	if (band <= 0)
+		throw std::invalid_argument("bakeSDF: band must be positive");
+
+	const BVHNode &root = bvh.nodes[0];
+	const int padding = band + 1;
+	glm::vec3 origin;
+	int dims[3];
+	double nb_nodes = 1.0;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		origin[axis] = root.min[axis] - padding * cell_size;
+		const double extent = std::ceil((root.max[axis] - root.min[axis]) / cell_size);
+		nb_nodes *= extent + 1 + 2 * padding;
+		if (nb_nodes > (1 << 30))
+			throw std::invalid_argument("bakeSDF: cell_size is too small for the mesh bounds");
+		dims[axis] = static_cast<int>(extent) + 1 + 2 * padding;
+	}
+
+	SignedDistanceField sdf(origin, cell_size, dims[0], dims[1], dims[2], band * cell_size);
+	MeshSDF_flood(bvh, origin, cell_size, dims, band, sdf.distances());
+	MeshSDF_sign(bvh, origin, cell_size, dims, sdf.distances());
+	return sdf;
+}
+
+SignedDistanceField bakeSDF(const RenderableMesh &mesh, float cell_size, int band)
+{
+	if (mesh.indexCount() < 3)
+		throw std::invalid_argument("bakeSDF: the mesh has no triangles");
+	return bakeSDF(buildBVH(mesh), cell_size, band);
+}
+
+SignedDistanceField bakeSDF(const Mesh &mesh, float cell_size, int band)
+{
+	if (mesh.faces.empty())
+		throw std::invalid_argument("bakeSDF: the mesh has no triangles");
+	return bakeSDF(buildBVH(mesh), cell_size, band);
+}
+
+
+void saveSDF(const std::string &path, const SignedDistanceField &sdf)
+{
+	SDFFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SDFFILE_MAGIC, sizeof(SDFFILE_MAGIC));
+	header.version = SDFFILE_VERSION;
+	header.endian_tag = MESHFILE_ENDIAN_TAG;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.dims[axis] = sdf.size(axis);
+		header.origin[axis] = sdf.origin()[axis];
+	}
+	header.cell_size = sdf.cellSize();
+	header.band = sdf.band();
+
+	const char *data = reinterpret_cast<const char *>(sdf.distances().data());
+	const size_t size = sdf.distances().size() * sizeof(float);
+	header.checksum = meshfile_internal::MeshFile_hash(data, size);
+
+	meshio_internal::FileWriter out(path);
+	out.write(&header, sizeof(header));
+	out.write(data, size);
+	out.close();
+}
+
+SignedDistanceField loadSDF(const std::string &path)
+{
+	MappedFile file(path);
+	if (file.size() < sizeof(SDFFileHeader))
+		throw std::runtime_error("Truncated distance field file: " + path);
+
+	SDFFileHeader header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, SDFFILE_MAGIC, sizeof(SDFFILE_MAGIC)) != 0)
+		throw std::runtime_error("Not a distance field file: " + path);
+	if (header.endian_tag != MESHFILE_ENDIAN_TAG)
+		throw std::runtime_error("Distance field file written with another byte order: " + path);
+	if (header.version == 0 || header.version > SDFFILE_VERSION)
+		throw std::runtime_error("Unsupported distance field file version " + std::to_string(header.version) + ": " + path);
+	if (header.dims[0] < 2 || header.dims[1] < 2 || header.dims[2] < 2 || !(header.cell_size > 0.0f))
+		throw std::runtime_error("Corrupted distance field file header: " + path);
+
+	const uint64_t nb_nodes = static_cast<uint64_t>(header.dims[0]) * header.dims[1] * header.dims[2];
+	if (nb_nodes * sizeof(float) != file.size() - sizeof(header))
+		throw std::runtime_error("Truncated distance field file: " + path);
+
+	const char *data = file.data() + sizeof(header);
+	const size_t size = static_cast<size_t>(nb_nodes * sizeof(float));
+	if (meshfile_internal::MeshFile_hash(data, size) != header.checksum)
+		throw std::runtime_error("Corrupted distance field file: " + path);
+
+	SignedDistanceField sdf(glm::vec3(header.origin[0], header.origin[1], header.origin[2]), header.cell_size,
+		header.dims[0], header.dims[1], header.dims[2], header.band);
+	memcpy(sdf.distances().data(), data, size);
+	return sdf;
+}
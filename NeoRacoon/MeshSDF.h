@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+#include "MeshBVH.h"
+
+
+// Signed distance to a closed mesh, baked once on a regular grid so that tools
+// asking how far a point is from the surface pay a trilinear lookup instead of
+// a BVH traversal. Distances are negative inside the mesh.
+
+///<summary>
+///Distances stored on the nodes of an nx * ny * nz grid, x fastest. Node (i, j, k)
+///sits at origin + cell_size * (i, j, k).
+///</summary>
+class SignedDistanceField
+{
+private:
+	glm::vec3 m_origin;
+	float m_cell_size;
+	float m_band; // distances up to this are exact, further ones come from the jump flood
+	int m_dims[3];
+	std::vector<float> m_distances;
+
+public:
+	SignedDistanceField();
+
+	SignedDistanceField(const glm::vec3 &origin, float cell_size, int nx, int ny, int nz, float band);
+
+	const glm::vec3 &origin() const { return m_origin; }
+	float cellSize() const { return m_cell_size; }
+	float band() const { return m_band; }
+	int size(int axis) const { return m_dims[axis]; }
+	size_t nodeCount() const { return m_distances.size(); }
+	bool empty() const { return m_distances.empty(); }
+
+	size_t index(int i, int j, int k) const { return (static_cast<size_t>(k) * m_dims[1] + j) * m_dims[0] + i; }
+
+	float at(int i, int j, int k) const { return m_distances[index(i, j, k)]; }
+
+	const std::vector<float> &distances() const { return m_distances; }
+	std::vector<float> &distances() { return m_distances; }
+
+	///<summary>
+	///Trilinear distance at p. Points outside the grid are clamped onto its border
+	///and get their distance to it added on, which keeps far points close to their
+	///true distance and never below it.
+	///</summary>
+	float sample(const glm::vec3 &p) const;
+
+	///<summary>
+	///Gradient of the distance returned by sample at p, along with that distance
+	///when distance is not null.
+	///</summary>
+	glm::vec3 gradient(const glm::vec3 &p, float *distance = nullptr) const;
+
+	///<summary>
+	///Normalized gradient, the outward surface normal near the surface. Zero where the gradient vanishes.
+	///</summary>
+	glm::vec3 normal(const glm::vec3 &p) const;
+};
+
+
+const char SDFFILE_MAGIC[8] = { 'R', 'A', 'C', 'S', 'D', 'F', '\0', '\0' };
+const uint32_t SDFFILE_VERSION = 1;
+
+struct SDFFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t endian_tag; // MESHFILE_ENDIAN_TAG
+	int32_t dims[3];
+	float cell_size;
+	float origin[3];
+	float band;
+	uint64_t checksum; // MeshFile_hash of the distances
+};
+
+
+namespace meshsdf_internal
+{
+	// Exact closest points in the band around every triangle, then a jump flood
+	// of the closest points over the rest of the grid. distances receives the
+	// unsigned distance of every node.
+	void MeshSDF_flood(const MeshBVH &bvh, const glm::vec3 &origin, float cell_size, const int dims[3], int band, std::vector<float> &distances);
+
+	// Inside test of every node by the parity of the surface crossings along its x row
+	void MeshSDF_sign(const MeshBVH &bvh, const glm::vec3 &origin, float cell_size, const int dims[3], std::vector<float> &distances);
+}
+
+
+///<summary>
+///Bakes the signed distance to mesh on a grid of cell_size covering the mesh
+///bounds plus band + 1 cells. Distances within band cells of the surface are
+///exact, the others come from a jump flood of the closest surface points and
+///are within a fraction of a cell. The sign comes from ray parity, so mesh
+///must be closed. Work is split over z slices and x rows.
+///Throws std::invalid_argument for an empty mesh, a non positive cell_size or band.
+///</summary>
+SignedDistanceField bakeSDF(const RenderableMesh &mesh, float cell_size, int band = 3);
+
+SignedDistanceField bakeSDF(const Mesh &mesh, float cell_size, int band = 3);
+
+///<summary>
+///Same, with the triangles of an existing BVH.
+///</summary>
+SignedDistanceField bakeSDF(const MeshBVH &bvh, float cell_size, int band = 3);
+
+
+///<summary>
+///Writes sdf as a .rsdf file: an SDFFileHeader followed by the distances.
+///Throws std::runtime_error if the file can not be written.
+///</summary>
+void saveSDF(const std::string &path, const SignedDistanceField &sdf);
+
+///<summary>
+///Reads a .rsdf file. Throws std::runtime_error on unreadable, truncated or corrupted files.
+///</summary>
+SignedDistanceField loadSDF(const std::string &path);
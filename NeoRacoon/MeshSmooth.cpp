@@ -0,0 +1,243 @@
+#include "MeshSmooth.h"
+
+#include <stdexcept>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define MESHSMOOTH_SSE
+#endif
+
+#include "MeshNormals.h"
+#include "Parallel.h"
+
+
+uint64_t MeshSmoother::topologyHash(const Mesh &mesh)
+{
+	uint64_t h = 14695981039346656037ull;
+	auto mix = [&h](int value)
+	{
+		h = (h ^ static_cast<uint32_t>(value)) * 1099511628211ull;
+	};
+
+	for (auto it = mesh.edges.begin(); it != mesh.edges.end(); ++it)
+	{
+		mix(it->vertices[0]);
+		mix(it->vertices[1]);
+	}
+	for (auto it = mesh.faces.begin(); it != mesh.faces.end(); ++it)
+	{
+		mix(static_cast<int>(it->edges.size()));
+		for (auto e = it->edges.begin(); e != it->edges.end(); ++e)
+			mix(*e);
+	}
+	return h;
+}
+
+MeshSmoother::MeshSmoother(const Mesh &mesh, bool lock_boundary, float feature_angle) :
+	m_nb_edges(mesh.edges.size()),
+	m_nb_faces(mesh.faces.size()),
+	m_topology(topologyHash(mesh))
+{
+	const size_t nb_vertices = mesh.vertices.size();
+	const size_t nb_edges = mesh.edges.size();
+
+	m_offsets.assign(nb_vertices + 1, 0);
+	for (auto it = mesh.edges.begin(); it != mesh.edges.end(); ++it)
+	{
+		if (it->vertices[0] == it->vertices[1])
+			continue;
+		++m_offsets[it->vertices[0] + 1];
+		++m_offsets[it->vertices[1] + 1];
+	}
+	for (size_t v = 0; v < nb_vertices; ++v)
+		m_offsets[v + 1] += m_offsets[v];
+
+	m_neighbours.resize(m_offsets.back());
+	std::vector<uint32_t> fill(m_offsets.begin(), m_offsets.end() - 1);
+	for (auto it = mesh.edges.begin(); it != mesh.edges.end(); ++it)
+	{
+		if (it->vertices[0] == it->vertices[1])
+			continue;
+		m_neighbours[fill[it->vertices[0]]++] = it->vertices[1];
+		m_neighbours[fill[it->vertices[1]]++] = it->vertices[0];
+	}
+
+	// Isolated vertices have nothing to average and stay put
+	m_free.resize(nb_vertices);
+	for (size_t v = 0; v < nb_vertices; ++v)
+		m_free[v] = m_offsets[v + 1] > m_offsets[v] ? 1.0f : 0.0f;
+
+	const bool lock_features = feature_angle < 180.0f;
+	if (!lock_boundary && !lock_features)
+		return;
+
+	// First two faces of every edge, and how many faces use it
+	std::vector<int> edge_faces(nb_edges * 2, -1);
+	std::vector<uint32_t> edge_uses(nb_edges, 0);
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+	{
+		const std::vector<int> &edges = mesh.faces[f].edges;
+		for (auto it = edges.begin(); it != edges.end(); ++it)
+		{
+			if (edge_uses[*it] < 2)
+				edge_faces[*it * 2 + edge_uses[*it]] = static_cast<int>(f);
+			++edge_uses[*it];
+		}
+	}
+
+	std::vector<Vertex> face_normals;
+	if (lock_features)
+	{
+		const Vertex barycenter = nb_vertices ? mesh.getBaryCenter() : Vertex();
+		face_normals.resize(mesh.faces.size());
+		parallel::parallelFor(0, mesh.faces.size(), [&](size_t first, size_t last, unsigned int)
+		{
+			std::vector<int> loop;
+			for (size_t f = first; f < last; ++f)
+			{
+				mesh.getFaceLoop(static_cast<int>(f), loop);
+				face_normals[f] = meshnormals_internal::MeshNormals_face_normal(mesh, loop, barycenter);
+			}
+			meshnormals_internal::MeshNormals_normalize(&face_normals[first].x, last - first);
+		}, 1024);
+	}
+
+	const float cos_feature = std::cos(feature_angle * 3.14159265f / 180.0f);
+	for (size_t e = 0; e < nb_edges; ++e)
+	{
+		bool lock = false;
+		if (edge_uses[e] == 1)
+			lock = lock_boundary;
+		else if (edge_uses[e] == 2 && lock_features)
+		{
+			const Vertex &a = face_normals[edge_faces[e * 2]], &b = face_normals[edge_faces[e * 2 + 1]];
+			lock = a.x * b.x + a.y * b.y + a.z * b.z < cos_feature;
+		}
+
+		if (lock)
+		{
+			m_free[mesh.edges[e].vertices[0]] = 0.0f;
+			m_free[mesh.edges[e].vertices[1]] = 0.0f;
+		}
+	}
+}
+
+
+void MeshSmoother::lockVertex(int v)
+{
+	m_free.at(v) = 0.0f;
+}
+
+void MeshSmoother::unlockVertex(int v)
+{
+	if (m_offsets.at(v + 1) > m_offsets[v])
+		m_free[v] = 1.0f;
+}
+
+
+void MeshSmoother::step(float factor)
+{
+	const size_t nb_vertices = m_free.size();
+
+	// Jacobi: every average reads the positions of the previous step
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t v = first; v < last; ++v)
+		{
+			uint32_t begin = m_offsets[v], end = m_offsets[v + 1];
+			if (begin == end)
+			{
+				m_avg_x[v] = m_x[v];
+				m_avg_y[v] = m_y[v];
+				m_avg_z[v] = m_z[v];
+				continue;
+			}
+
+			float x = 0.0f, y = 0.0f, z = 0.0f;
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				uint32_t n = m_neighbours[i];
+				x += m_x[n];
+				y += m_y[n];
+				z += m_z[n];
+			}
+			float inv = 1.0f / (end - begin);
+			m_avg_x[v] = x * inv;
+			m_avg_y[v] = y * inv;
+			m_avg_z[v] = z * inv;
+		}
+	});
+
+	// p += factor * free * (avg - p), 4 vertices at a time
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		size_t v = first;
+#ifdef MESHSMOOTH_SSE
+		const __m128 f4 = _mm_set1_ps(factor);
+		float *coords[3] = { m_x.data(), m_y.data(), m_z.data() };
+		const float *avgs[3] = { m_avg_x.data(), m_avg_y.data(), m_avg_z.data() };
+		for (; v + 4 <= last; v += 4)
+		{
+			__m128 w = _mm_mul_ps(_mm_loadu_ps(&m_free[v]), f4);
+			for (int k = 0; k < 3; ++k)
+			{
+				__m128 p = _mm_loadu_ps(coords[k] + v);
+				__m128 a = _mm_loadu_ps(avgs[k] + v);
+				_mm_storeu_ps(coords[k] + v, _mm_add_ps(p, _mm_mul_ps(w, _mm_sub_ps(a, p))));
+			}
+		}
+#endif
+		for (; v < last; ++v)
+		{
+			float w = m_free[v] * factor;
+			m_x[v] += w * (m_avg_x[v] - m_x[v]);
+			m_y[v] += w * (m_avg_y[v] - m_y[v]);
+			m_z[v] += w * (m_avg_z[v] - m_z[v]);
+		}
+	});
+}
+
+
+void MeshSmoother::smooth(Mesh &mesh, const MeshSmoothOptions &options)
+{
+	const size_t nb_vertices = m_free.size();
+	if (mesh.vertices.size() != nb_vertices)
+		throw std::invalid_argument("MeshSmoother::smooth: mesh has a different vertex count");
+	if (mesh.edges.size() != m_nb_edges || mesh.faces.size() != m_nb_faces || topologyHash(mesh) != m_topology)
+		throw std::invalid_argument("MeshSmoother::smooth: mesh has a different topology");
+	if (options.iterations < 0 || !(options.lambda > 0.0f && options.lambda <= 1.0f))
+		throw std::invalid_argument("MeshSmoother::smooth: bad iterations or lambda");
+	if (options.method == MESH_SMOOTH_TAUBIN && !(options.mu < 0.0f))
+		throw std::invalid_argument("MeshSmoother::smooth: Taubin smoothing needs a negative mu");
+
+	m_x.resize(nb_vertices);
+	m_y.resize(nb_vertices);
+	m_z.resize(nb_vertices);
+	m_avg_x.resize(nb_vertices);
+	m_avg_y.resize(nb_vertices);
+	m_avg_z.resize(nb_vertices);
+	for (size_t v = 0; v < nb_vertices; ++v)
+	{
+		m_x[v] = mesh.vertices[v].x;
+		m_y[v] = mesh.vertices[v].y;
+		m_z[v] = mesh.vertices[v].z;
+	}
+
+	for (int i = 0; i < options.iterations; ++i)
+	{
+		step(options.lambda);
+		if (options.method == MESH_SMOOTH_TAUBIN)
+			step(options.mu);
+	}
+
+	for (size_t v = 0; v < nb_vertices; ++v)
+		mesh.vertices[v] = Vertex(m_x[v], m_y[v], m_z[v]);
+}
+
+
+void smoothMesh(Mesh &mesh, const MeshSmoothOptions &options, bool lock_boundary, float feature_angle)
+{
+	MeshSmoother smoother(mesh, lock_boundary, feature_angle);
+	smoother.smooth(mesh, options);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MeshUtils.h"
+
+
+// Laplacian and Taubin smoothing of the vertex positions of a Mesh, usually a
+// cage before subdivision. The topology is never changed.
+
+enum MeshSmoothMethod
+{
+	MESH_SMOOTH_LAPLACIAN, // shrinks the mesh a little every iteration
+	MESH_SMOOTH_TAUBIN // a lambda step then a negative mu step, keeps the volume
+};
+
+struct MeshSmoothOptions
+{
+	MeshSmoothMethod method;
+	int iterations;
+	float lambda; // in (0, 1], how far vertices move toward their neighbours' average
+	float mu; // Taubin only, negative with |mu| slightly above lambda
+
+	MeshSmoothOptions() : method(MESH_SMOOTH_TAUBIN), iterations(10), lambda(0.5f), mu(-0.53f) {}
+};
+
+
+///<summary>
+///Keeps the vertex adjacency of a mesh in CSR form and the positions as
+///separate x, y and z arrays, so iterations cost one parallel pass over the
+///edges and one SIMD pass over the coordinates. Build it once per topology and
+///reuse it for every smoothing of that mesh.
+///</summary>
+class MeshSmoother
+{
+private:
+	std::vector<uint32_t> m_offsets; // neighbours of v are m_neighbours[m_offsets[v] .. m_offsets[v + 1])
+	std::vector<uint32_t> m_neighbours;
+	std::vector<float> m_free; // 1 for vertices that move, 0 for locked ones
+	std::vector<float> m_x, m_y, m_z;
+	std::vector<float> m_avg_x, m_avg_y, m_avg_z;
+	size_t m_nb_edges, m_nb_faces;
+	uint64_t m_topology; // topologyHash of the mesh this smoother was built from
+
+	void step(float factor);
+
+	// FNV-1a over the edge vertices and the face edges
+	static uint64_t topologyHash(const Mesh &mesh);
+
+public:
+	///<summary>
+	///Builds the adjacency of mesh. Boundary vertices are locked when
+	///lock_boundary is set, and the vertices of edges whose faces meet at more
+	///than feature_angle degrees are locked too (180 disables feature detection).
+	///</summary>
+	MeshSmoother(const Mesh &mesh, bool lock_boundary = true, float feature_angle = 180.0f);
+
+	void lockVertex(int v);
+
+	void unlockVertex(int v);
+
+	bool isLocked(int v) const { return m_free[v] == 0.0f; }
+
+	size_t vertexCount() const { return m_free.size(); }
+
+	///<summary>
+	///Smooths the vertices of mesh, which must have the topology this smoother
+	///was built from: the same vertex, edge and face counts, edges and face edges.
+	///Throws std::invalid_argument otherwise or on bad options.
+	///</summary>
+	void smooth(Mesh &mesh, const MeshSmoothOptions &options = MeshSmoothOptions());
+};
+
+
+///<summary>
+///Builds a MeshSmoother for mesh and smooths it once.
+///</summary>
+void smoothMesh(Mesh &mesh, const MeshSmoothOptions &options = MeshSmoothOptions(), bool lock_boundary = true, float feature_angle = 180.0f);
@@ -1,87 +1,396 @@
 #include "MeshUtils.h"
+#include "MeshView.h"
+#include "Parallel.h"
+#include "PointLayout.h"
 
+#include <limits>
 
 
-Face::Face(std::initializer_list<int> vert_ids, std::initializer_list<int> edge_ids)
+
+// The queries below are shared by Mesh and MeshView, which expose the same
+// vertices / edges / faces accessors.
+namespace meshutils_internal
 {
-	vertices.insert(vertices.begin(), vert_ids);
-	edges.insert(edges.begin(), edge_ids);
-}
+	// Every query clears ids and fills it, so callers can pass the same buffer,
+	// arena backed or not, for every vertex or edge of a pass.
+	template<typename MeshT, typename VectorT>
+	void MeshUtils_connected_vertices(const MeshT &mesh, int vert_id, VectorT &ids)
+	{
+		ids.clear();
+		if (vert_id < 0)
+			return;
+
+		for (auto it = mesh.edges.begin(); it != mesh.edges.end(); ++it)
+		{
+			if (it->vertices[0] == vert_id)
+				ids.push_back(it->vertices[1]);
+			else if (it->vertices[1] == vert_id)
+				ids.push_back(it->vertices[0]);
+		}
+	}
 
 
-std::vector<int> Mesh::getConnectedVertices(int vert_id) const
-{
-	if (vert_id < 0)
-		return std::vector<int>();
+	template<typename MeshT, typename VectorT>
+	void MeshUtils_connected_edges(const MeshT &mesh, int vert_id, VectorT &ids)
+	{
+		ids.clear();
+		if (vert_id < 0)
+			return;
+
+		int i = 0;
+		for (auto it = mesh.edges.begin(); it != mesh.edges.end(); ++it, ++i)
+		{
+			if (it->vertices[0] == vert_id || it->vertices[1] == vert_id)
+				ids.push_back(i);
+		}
+	}
 
-	std::vector<int> ret;
+	template<typename MeshT, typename VectorT>
+	void MeshUtils_connected_faces(const MeshT &mesh, int vert_id, VectorT &ids)
+	{
+		ids.clear();
+		if (vert_id < 0)
+			return;
+
+		for (int i = 0; i < static_cast<int>(mesh.faces.size()); ++i)
+		{
+			const auto &face = mesh.faces[i];
+			if (std::find(face.vertices.begin(), face.vertices.end(), vert_id) != face.vertices.end())
+				ids.push_back(i);
+		}
+	}
 
-	int i = 0;
-	for (auto it = edges.begin(); it != edges.end(); ++it, ++i)
+	template<typename MeshT, typename VectorT>
+	void MeshUtils_connected_faces_to_edge(const MeshT &mesh, int edge_id, VectorT &ids)
 	{
-		if (it->vertices[0] == vert_id)
-			ret.push_back(it->vertices[1]);
-		else if (it->vertices[1] == vert_id)
-			ret.push_back(it->vertices[0]);
+		ids.clear();
+		if (edge_id < 0)
+			return;
+
+		for (int i = 0; i < static_cast<int>(mesh.faces.size()); ++i)
+		{
+			const auto &face = mesh.faces[i];
+			if (std::find(face.edges.begin(), face.edges.end(), edge_id) != face.edges.end())
+				ids.push_back(i);
+		}
 	}
 
-	return ret;
-}
 
+	// Vertices of a face in loop order, read from its edges. Consecutive face edges
+	// share a vertex in everything the subdivision engines and buildMesh produce;
+	// when they do not, face.vertices is returned as is.
+	template<typename MeshT>
+	void MeshUtils_face_loop(const MeshT &mesh, int face_id, std::vector<int> &loop)
+	{
+		const auto &f = mesh.faces[face_id];
+		const size_t n = f.edges.size();
+		if (n < 3)
+		{
+			loop.assign(f.vertices.begin(), f.vertices.end());
+			return;
+		}
+
+		loop.resize(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			const Edge &prev = mesh.edges[f.edges[(i + n - 1) % n]];
+			const Edge &cur = mesh.edges[f.edges[i]];
+
+			if (cur.vertices[0] == prev.vertices[0] || cur.vertices[0] == prev.vertices[1])
+				loop[i] = cur.vertices[0];
+			else if (cur.vertices[1] == prev.vertices[0] || cur.vertices[1] == prev.vertices[1])
+				loop[i] = cur.vertices[1];
+			else
+			{
+				loop.assign(f.vertices.begin(), f.vertices.end());
+				return;
+			}
+		}
+	}
 
+	template<typename MeshT>
+	std::vector<int> MeshUtils_face_loop(const MeshT &mesh, int face_id)
+	{
+		std::vector<int> loop;
+		MeshUtils_face_loop(mesh, face_id, loop);
+		return loop;
+	}
 
-std::vector<int> Mesh::getConnectedEdges(int vert_id) const
-{
-	if (vert_id < 0)
-		return std::vector<int>();
 
-	std::vector<int> ret;
+	// Fan triangulation of a face loop into out, 3 * (loop.size() - 2) indices.
+	// The winding follows the loop when its Newell normal points away from the
+	// barycenter, and is reversed otherwise.
+	template<typename MeshT, typename IndexT>
+	IndexT *MeshUtils_triangulate(const MeshT &mesh, const std::vector<int> &loop, const typename MeshT::vertex_type &barycenter, IndexT *out)
+	{
+		typedef typename MeshT::vertex_type VertexT;
+		const size_t n = loop.size();
+		if (n < 3)
+			return out;
+
+		VertexT normal, center;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const VertexT &a = mesh.vertices[loop[i]];
+			const VertexT &b = mesh.vertices[loop[(i + 1) % n]];
+			normal.x += (a.y - b.y) * (a.z + b.z);
+			normal.y += (a.z - b.z) * (a.x + b.x);
+			normal.z += (a.x - b.x) * (a.y + b.y);
+			center.x += a.x;
+			center.y += a.y;
+			center.z += a.z;
+		}
+
+		typename VertexT::value_type dot = normal.x * (center.x / n - barycenter.x) + normal.y * (center.y / n - barycenter.y) + normal.z * (center.z / n - barycenter.z);
+		const size_t first = dot < 0 ? 2 : 1, second = dot < 0 ? 1 : 2;
+
+		for (size_t i = 1; i + 1 < n; ++i)
+		{
+			const int tri[3] = { loop[0], loop[i], loop[i + 1] };
+			*out++ = static_cast<IndexT>(tri[0]);
+			*out++ = static_cast<IndexT>(tri[first]);
+			*out++ = static_cast<IndexT>(tri[second]);
+		}
+
+		return out;
+	}
 
-	int i = 0;
-	for (auto it = edges.begin(); it != edges.end(); ++it, ++i)
+	template<typename MeshT>
+	std::vector<uint32_t> MeshUtils_face_to_indices(const MeshT &mesh, int face_id, const typename MeshT::vertex_type &barycenter)
 	{
-		if (it->vertices[0] == vert_id || it->vertices[1] == vert_id)
-			ret.push_back(i);
+		std::vector<int> loop = MeshUtils_face_loop(mesh, face_id);
+
+		std::vector<uint32_t> indices(loop.size() >= 3 ? (loop.size() - 2) * 3 : 0);
+		MeshUtils_triangulate(mesh, loop, barycenter, indices.data());
+		return indices;
 	}
 
-	return ret;
-}
 
-std::vector<int> Mesh::getConnectedFaces(int vert_id) const
-{
-	if (vert_id < 0)
-		return std::vector<int>();
+	template<typename MeshT, typename IndexT>
+	void MeshUtils_fill_indices(const MeshT &mesh, const std::vector<size_t> &offsets, const typename MeshT::vertex_type &barycenter, std::vector<IndexT> &indices)
+	{
+		indices.resize(offsets.back());
+		parallel::parallelFor(0, offsets.size() - 1, [&](size_t first, size_t last, unsigned int)
+		{
+			std::vector<int> loop;
+			for (size_t i = first; i < last; ++i)
+			{
+				MeshUtils_face_loop(mesh, static_cast<int>(i), loop);
+				MeshUtils_triangulate(mesh, loop, barycenter, indices.data() + offsets[i]);
+			}
+		}, 1024);
+	}
 
-	std::vector<int> ret;
+	// Two indices per edge, in edge order. Edges with a vertex out of range or
+	// twice the same vertex are left out, so blocks count theirs before writing.
+	template<typename MeshT, typename IndexT>
+	void MeshUtils_fill_lines(const MeshT &mesh, std::vector<IndexT> &lines)
+	{
+		const size_t nb_edges = mesh.edges.size();
+		const int nb_vertices = static_cast<int>(mesh.vertices.size());
+		const size_t grain = 1 << 14;
+		const size_t nb_blocks = parallel::blockCount(nb_edges, grain);
+
+		auto valid = [&](const Edge &e)
+		{
+			return e.vertices[0] >= 0 && e.vertices[1] >= 0 && e.vertices[0] < nb_vertices && e.vertices[1] < nb_vertices && e.vertices[0] != e.vertices[1];
+		};
+
+		std::vector<size_t> offsets(nb_blocks + 1, 0);
+		parallel::parallelFor(0, nb_edges, [&](size_t first, size_t last, unsigned int block)
+		{
+			size_t count = 0;
+			for (size_t i = first; i < last; ++i)
+			{
+				if (valid(mesh.edges[i]))
+					++count;
+			}
+			offsets[block + 1] = count;
+		}, grain);
+		for (size_t b = 0; b < nb_blocks; ++b)
+			offsets[b + 1] += offsets[b];
+
+		lines.resize(offsets[nb_blocks] * 2);
+		parallel::parallelFor(0, nb_edges, [&](size_t first, size_t last, unsigned int block)
+		{
+			IndexT *out = lines.data() + offsets[block] * 2;
+			for (size_t i = first; i < last; ++i)
+			{
+				const Edge &e = mesh.edges[i];
+				if (!valid(e))
+					continue;
+				*out++ = static_cast<IndexT>(e.vertices[0]);
+				*out++ = static_cast<IndexT>(e.vertices[1]);
+			}
+		}, grain);
+	}
+
+	template<typename MeshT>
+	RenderableMesh MeshUtils_renderable_mesh(const MeshT &mesh)
+	{
+		AllocationScope scope("Meshing");
+		const size_t nb_vertices = mesh.vertices.size();
+		const size_t nb_faces = mesh.faces.size();
+
+		RenderableMesh ret;
+		ret.vertices.resize(nb_vertices * 3);
+		parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				const typename MeshT::vertex_type v = mesh.vertices[i];
+				ret.vertices[i * 3] = static_cast<float>(v.x);
+				ret.vertices[i * 3 + 1] = static_cast<float>(v.y);
+				ret.vertices[i * 3 + 2] = static_cast<float>(v.z);
+			}
+		});
+
+		// Triangle count of every face, then their offsets in the index buffer
+		std::vector<size_t> offsets(nb_faces + 1, 0);
+		parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int)
+		{
+			std::vector<int> loop;
+			for (size_t i = first; i < last; ++i)
+			{
+				MeshUtils_face_loop(mesh, static_cast<int>(i), loop);
+				offsets[i + 1] = loop.size() >= 3 ? (loop.size() - 2) * 3 : 0;
+			}
+		}, 1024);
+		for (size_t i = 0; i < nb_faces; ++i)
+			offsets[i + 1] += offsets[i];
+
+		const typename MeshT::vertex_type barycenter = mesh.getBaryCenter();
+		if (nb_vertices > std::numeric_limits<uint16_t>::max())
+		{
+			MeshUtils_fill_indices(mesh, offsets, barycenter, ret.indices32);
+			MeshUtils_fill_lines(mesh, ret.lines32);
+		}
+		else
+		{
+			MeshUtils_fill_indices(mesh, offsets, barycenter, ret.indices);
+			MeshUtils_fill_lines(mesh, ret.lines);
+		}
+
+		return ret;
+	}
+
+
+	// Sum of the positions, one overload per vertex layout
+	template<typename VerticesT>
+	typename VerticesT::value_type MeshUtils_sum(const VerticesT &vertices)
+	{
+		typename VerticesT::value_type sum;
+		for (auto it = vertices.begin(); it != vertices.end(); ++it)
+		{
+			sum.x += it->x;
+			sum.y += it->y;
+			sum.z += it->z;
+		}
+		return sum;
+	}
 
-	int i = 0;
-	for (auto it = faces.begin(); it != faces.end(); ++it, ++i)
+	template<typename T>
+	BasicVertex<T> MeshUtils_sum(const SoAVertices<T> &vertices)
 	{
-		if (std::find(it->vertices.begin(), it->vertices.end(), vert_id) != it->vertices.end())
-			ret.push_back(i);
+		BasicVertex<T> sum;
+		for (size_t i = 0; i < vertices.size(); ++i)
+			sum.x += vertices.x[i];
+		for (size_t i = 0; i < vertices.size(); ++i)
+			sum.y += vertices.y[i];
+		for (size_t i = 0; i < vertices.size(); ++i)
+			sum.z += vertices.z[i];
+		return sum;
 	}
 
+	template<typename MeshT>
+	typename MeshT::vertex_type MeshUtils_bary_center(const MeshT &mesh)
+	{
+		typename MeshT::vertex_type bary = MeshUtils_sum(mesh.vertices);
+
+		bary.x /= mesh.vertices.size();
+		bary.y /= mesh.vertices.size();
+		bary.z /= mesh.vertices.size();
+
+		return bary;
+	}
+
+
+	// Heap of the vertex storage, one overload per vertex layout
+	template<typename T, typename AllocatorT>
+	MemoryUsage MeshUtils_vertices_memory(const std::vector<BasicVertex<T>, AllocatorT> &vertices)
+	{
+		return vectorMemory(vertices);
+	}
+
+	template<typename T>
+	MemoryUsage MeshUtils_vertices_memory(const SoAVertices<T> &vertices)
+	{
+		MemoryUsage ret = vectorMemory(vertices.x);
+		ret += vectorMemory(vertices.y);
+		ret += vectorMemory(vertices.z);
+		return ret;
+	}
+}
+
+
+template<typename T, typename LayoutT>
+std::vector<int> BasicMesh<T, LayoutT>::getConnectedVertices(int vert_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_vertices(*this, vert_id, ret);
+	return ret;
+}
+
+template<typename T, typename LayoutT>
+void BasicMesh<T, LayoutT>::getConnectedVertices(int vert_id, ArenaVector<int> &ids) const
+{
+	meshutils_internal::MeshUtils_connected_vertices(*this, vert_id, ids);
+}
+
+template<typename T, typename LayoutT>
+std::vector<int> BasicMesh<T, LayoutT>::getConnectedEdges(int vert_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_edges(*this, vert_id, ret);
 	return ret;
 }
 
-std::vector<int> Mesh::getConnectedFacesToEdge(int edge_id) const
+template<typename T, typename LayoutT>
+void BasicMesh<T, LayoutT>::getConnectedEdges(int vert_id, ArenaVector<int> &ids) const
 {
-	if (edge_id < 0)
-		return std::vector<int>();
+	meshutils_internal::MeshUtils_connected_edges(*this, vert_id, ids);
+}
 
+template<typename T, typename LayoutT>
+std::vector<int> BasicMesh<T, LayoutT>::getConnectedFaces(int vert_id) const
+{
 	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_faces(*this, vert_id, ret);
+	return ret;
+}
 
-	int i = 0;
-	for (auto it = faces.begin(); it != faces.end(); ++it, ++i)
-	{
-		if (std::find(it->edges.begin(), it->edges.end(), edge_id) != it->edges.end())
-			ret.push_back(i);
-	}
+template<typename T, typename LayoutT>
+void BasicMesh<T, LayoutT>::getConnectedFaces(int vert_id, ArenaVector<int> &ids) const
+{
+	meshutils_internal::MeshUtils_connected_faces(*this, vert_id, ids);
+}
 
+template<typename T, typename LayoutT>
+std::vector<int> BasicMesh<T, LayoutT>::getConnectedFacesToEdge(int edge_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_faces_to_edge(*this, edge_id, ret);
 	return ret;
 }
 
-int Mesh::getEdgeId(const Edge & e)
+template<typename T, typename LayoutT>
+void BasicMesh<T, LayoutT>::getConnectedFacesToEdge(int edge_id, ArenaVector<int> &ids) const
+{
+	meshutils_internal::MeshUtils_connected_faces_to_edge(*this, edge_id, ids);
+}
+
+template<typename T, typename LayoutT>
+int BasicMesh<T, LayoutT>::getEdgeId(const Edge & e)
 {
 	auto it = std::find(edges.begin(), edges.end(), e);
 	if (it == edges.end())
@@ -91,100 +400,179 @@ int Mesh::getEdgeId(const Edge & e)
 	return static_cast<int>(std::distance(edges.begin(), it));
 }
 
+template<typename T, typename LayoutT>
+std::vector<int> BasicMesh<T, LayoutT>::getFaceLoop(int face_id) const
+{
+	return meshutils_internal::MeshUtils_face_loop(*this, face_id);
+}
 
-std::vector<uint16_t> Mesh::faceToIndices(int face_id, const Vertex &barycenter) const
+template<typename T, typename LayoutT>
+void BasicMesh<T, LayoutT>::getFaceLoop(int face_id, std::vector<int> &loop) const
 {
-	const Face &f = faces[face_id];
+	meshutils_internal::MeshUtils_face_loop(*this, face_id, loop);
+}
 
-	std::vector<uint16_t> indices;
-	std::deque<Edge> e;
-	for (size_t i = 0; i < f.edges.size(); ++i)
-		e.push_back(edges[f.edges[i]]);
+template<typename T, typename LayoutT>
+std::vector<uint32_t> BasicMesh<T, LayoutT>::faceToIndices(int face_id, const vertex_type &barycenter) const
+{
+	return meshutils_internal::MeshUtils_face_to_indices(*this, face_id, barycenter);
+}
 
-	Edge current = e.front();
-	e.pop_front();
-	indices.push_back(current.vertices[0]);
-	indices.push_back(current.vertices[1]);
-	int search = current.vertices[1];
-	while (!e.empty())
-	{
-		auto it = std::find_if(e.begin(), e.end(), [&search](const Edge &edge) { return edge.vertices[0] == search || edge.vertices[1] == search; });
-		if (it == e.end())
-			return std::vector<uint16_t>();
+template<typename T, typename LayoutT>
+RenderableMesh BasicMesh<T, LayoutT>::getRenderableMesh() const
+{
+	return meshutils_internal::MeshUtils_renderable_mesh(*this);
+}
 
-		current = *it;
-		e.erase(it);
-		if (current.vertices[0] != search)
-			current.swap();
-		indices.push_back(current.vertices[0]);
-		indices.push_back(current.vertices[1]);
-		search = current.vertices[1];
+
+template<typename T, typename LayoutT>
+typename BasicMesh<T, LayoutT>::vertex_type BasicMesh<T, LayoutT>::getBaryCenter() const
+{
+	return meshutils_internal::MeshUtils_bary_center(*this);
+}
+
+template<typename T, typename LayoutT>
+MemoryReport BasicMesh<T, LayoutT>::memoryUsage() const
+{
+	MemoryUsage loops;
+	for (auto it = faces.begin(); it != faces.end(); ++it)
+	{
+		loops += vectorMemory(it->vertices);
+		loops += vectorMemory(it->edges);
 	}
 
-	const Vertex &p1(vertices[0]), p2(vertices[1]), p3(vertices[2]);
-	Vertex A(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z), B(p3.x - p2.x, p3.y - p2.y, p3.z - p2.z);
-	Vertex ABary(barycenter.x - p1.x, barycenter.y - p1.y, barycenter.z - p1.z);
-	Vertex N(A.y * B.z - A.z * B.y, A.z * B.x - A.x * B.z, A.y * B.z - A.z * B.y);
+	MemoryReport ret;
+	ret.add("vertices", meshutils_internal::MeshUtils_vertices_memory(vertices));
+	ret.add("edges", vectorMemory(edges));
+	ret.add("faces", vectorMemory(faces));
+	ret.add("face loops", loops);
+	return ret;
+}
+
+template struct BasicMesh<float, MeshAoS>;
+template struct BasicMesh<double, MeshAoS>;
+template struct BasicMesh<float, MeshSoA>;
+template struct BasicMesh<double, MeshSoA>;
+template struct BasicMesh<float, MeshArena>;
 
-	float dot = N.x * ABary.x + N.y * ABary.y + N.z * ABary.z;
-	if (dot > 0)
-		std::reverse(indices.begin(), indices.end());
 
-	return indices;
+
+std::vector<int> MeshView::getConnectedVertices(int vert_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_vertices(*this, vert_id, ret);
+	return ret;
 }
 
-RenderableMesh Mesh::getRenderableMesh() const
+void MeshView::getConnectedVertices(int vert_id, ArenaVector<int> &ids) const
 {
-	RenderableMesh ret;
-	ret.vertices.reserve(vertices.size() * 3);
-	for (auto it = vertices.begin(); it != vertices.end(); ++it)
-	{
-		ret.vertices.emplace_back(it->x);
-		ret.vertices.emplace_back(it->y);
-		ret.vertices.emplace_back(it->z);
-	}
+	meshutils_internal::MeshUtils_connected_vertices(*this, vert_id, ids);
+}
 
-	for (size_t i = 0; i < faces.size(); ++i)
-	{
-		auto ind = faceToIndices(i);
-		ret.indices.insert(ret.indices.end(), ind.begin(), ind.end());
-	}
+std::vector<int> MeshView::getConnectedEdges(int vert_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_edges(*this, vert_id, ret);
+	return ret;
+}
 
+void MeshView::getConnectedEdges(int vert_id, ArenaVector<int> &ids) const
+{
+	meshutils_internal::MeshUtils_connected_edges(*this, vert_id, ids);
+}
+
+std::vector<int> MeshView::getConnectedFaces(int vert_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_faces(*this, vert_id, ret);
+	return ret;
+}
+
+void MeshView::getConnectedFaces(int vert_id, ArenaVector<int> &ids) const
+{
+	meshutils_internal::MeshUtils_connected_faces(*this, vert_id, ids);
+}
+
+std::vector<int> MeshView::getConnectedFacesToEdge(int edge_id) const
+{
+	std::vector<int> ret;
+	meshutils_internal::MeshUtils_connected_faces_to_edge(*this, edge_id, ret);
 	return ret;
 }
 
+void MeshView::getConnectedFacesToEdge(int edge_id, ArenaVector<int> &ids) const
+{
+	meshutils_internal::MeshUtils_connected_faces_to_edge(*this, edge_id, ids);
+}
+
+std::vector<int> MeshView::getFaceLoop(int face_id) const
+{
+	return meshutils_internal::MeshUtils_face_loop(*this, face_id);
+}
 
-Vertex Mesh::getBaryCenter() const
+void MeshView::getFaceLoop(int face_id, std::vector<int> &loop) const
 {
-	Vertex bary;
-	for (auto it = vertices.begin(); it != vertices.end(); ++it)
+	meshutils_internal::MeshUtils_face_loop(*this, face_id, loop);
+}
+
+std::vector<uint32_t> MeshView::faceToIndices(int face_id, const Vertex &barycenter) const
+{
+	return meshutils_internal::MeshUtils_face_to_indices(*this, face_id, barycenter);
+}
+
+RenderableMesh MeshView::getRenderableMesh() const
+{
+	return meshutils_internal::MeshUtils_renderable_mesh(*this);
+}
+
+Vertex MeshView::getBaryCenter() const
+{
+	return meshutils_internal::MeshUtils_bary_center(*this);
+}
+
+Mesh MeshView::toMesh() const
+{
+	Mesh ret;
+	ret.vertices.assign(vertices.begin(), vertices.end());
+	ret.edges.assign(edges.begin(), edges.end());
+	ret.faces.resize(faces.size());
+	for (size_t i = 0; i < faces.size(); ++i)
 	{
-		bary.x += it->x;
-		bary.y += it->y;
-		bary.z += it->z;
+		FaceView f = faces[i];
+		ret.faces[i].vertices.assign(f.vertices.begin(), f.vertices.end());
+		ret.faces[i].edges.assign(f.edges.begin(), f.edges.end());
 	}
 
-	bary.x /= vertices.size();
-	bary.y /= vertices.size();
-	bary.z /= vertices.size();
-
-	return bary;
+	return ret;
 }
 
 
 
 
+MemoryReport RenderableMesh::memoryUsage() const
+{
+	MemoryUsage triangles = vectorMemory(indices), wireframe = vectorMemory(lines);
+	triangles += vectorMemory(indices32);
+	wireframe += vectorMemory(lines32);
+
+	MemoryReport ret;
+	ret.add("vertices", vectorMemory(vertices));
+	ret.add("normals", vectorMemory(normals));
+	ret.add("occlusion", vectorMemory(occlusion));
+	ret.add("indices", triangles);
+	ret.add("lines", wireframe);
+	return ret;
+}
+
 std::vector<glm::vec3> RenderableMesh::toVec3() const
 {
 
 	std::vector<glm::vec3> ret;
-	ret.reserve(vertices.size() / 3);
+	ret.reserve(indexCount());
 
-	for (size_t j = 0; j < indices.size(); j++)
-	{
-		size_t i = indices[j] * 3;
-		ret.emplace_back(glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]));
-	}
+	ArrayView<glm::vec3> points = viewPoints<glm::vec3>(vertices);
+	for (size_t j = 0; j < indexCount(); j++)
+		ret.push_back(points[getIndex(j)]);
 
 	return ret;
 }
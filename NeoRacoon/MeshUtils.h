@@ -2,29 +2,119 @@
 
 
 #include <vector>
+#include <cstdint>
 #include <deque>
 #include <initializer_list>
 #include <algorithm>
 
 #include <glm.hpp>
 
-struct Vertex
+#include "MemoryStats.h"
+#include "Arena.h"
+
+///<summary>
+///Vertex position with coordinates of type T. Vertex is the float one used
+///everywhere by default, VertexD is kept for computations that accumulate error.
+///</summary>
+template<typename T>
+struct BasicVertex
 {
-	float x;
-	float y;
-	float z;
+	typedef T value_type;
+
+	T x;
+	T y;
+	T z;
 	/*  voir les trucs de textures et de normales */
 
-	Vertex() : Vertex(0.0, 0.0, 0.0) {}
-	Vertex(float x, float y, float z) : x(x), y(y), z(z) {}
+	BasicVertex() : BasicVertex(T(0), T(0), T(0)) {}
+	BasicVertex(T x, T y, T z) : x(x), y(y), z(z) {}
 
+	template<typename U>
+	explicit BasicVertex(const BasicVertex<U> &v) : x(static_cast<T>(v.x)), y(static_cast<T>(v.y)), z(static_cast<T>(v.z)) {}
 
-	bool operator==(const Vertex &v) const
+
+	bool operator==(const BasicVertex &v) const
 	{
 		return x == v.x && y == v.y && z == v.z;
 	}
 
-	bool operator!=(const Vertex &v) const { return !(this->operator==(v)); }
+	bool operator!=(const BasicVertex &v) const { return !(this->operator==(v)); }
+};
+
+typedef BasicVertex<float> Vertex;
+typedef BasicVertex<double> VertexD;
+
+
+///<summary>
+///Vertex positions stored as three coordinate arrays. Reads return the vertex
+///by value; writes go through push_back or set.
+///</summary>
+template<typename T>
+struct SoAVertices
+{
+	typedef BasicVertex<T> value_type;
+
+	std::vector<T> x;
+	std::vector<T> y;
+	std::vector<T> z;
+
+	SoAVertices() {}
+
+	// SoA meshes live on the heap, the allocator of the mesh is ignored
+	template<typename AllocatorT>
+	explicit SoAVertices(const AllocatorT &) {}
+
+	size_t size() const { return x.size(); }
+	bool empty() const { return x.empty(); }
+
+	void reserve(size_t n) { x.reserve(n); y.reserve(n); z.reserve(n); }
+	void resize(size_t n) { x.resize(n); y.resize(n); z.resize(n); }
+	void clear() { x.clear(); y.clear(); z.clear(); }
+
+	void push_back(const value_type &v) { x.push_back(v.x); y.push_back(v.y); z.push_back(v.z); }
+
+	void set(size_t i, const value_type &v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+
+	value_type operator[](size_t i) const { return value_type(x[i], y[i], z[i]); }
+};
+
+
+// Layouts of BasicMesh: how the vertices are stored, and where the vertices,
+// edges, faces and face loops are allocated. allocator(arena) gives the
+// allocator of a mesh built by a pass given arena.
+struct MeshAoS
+{
+	template<typename T>
+	using Storage = std::vector<BasicVertex<T>>;
+
+	template<typename T>
+	using Allocator = std::allocator<T>;
+
+	static Allocator<int> allocator(MonotonicArena *) { return Allocator<int>(); }
+};
+
+struct MeshSoA
+{
+	template<typename T>
+	using Storage = SoAVertices<T>;
+
+	template<typename T>
+	using Allocator = std::allocator<T>;
+
+	static Allocator<int> allocator(MonotonicArena *) { return Allocator<int>(); }
+};
+
+// Whole mesh in a MonotonicArena, for the intermediate levels of a subdivision
+// that are thrown away as soon as the next one is built
+struct MeshArena
+{
+	template<typename T>
+	using Storage = ArenaVector<BasicVertex<T>>;
+
+	template<typename T>
+	using Allocator = ArenaAllocator<T>;
+
+	static Allocator<int> allocator(MonotonicArena *arena) { return Allocator<int>(arena); }
 };
 
 
@@ -48,15 +138,30 @@ struct Edge
 };
 
 
-struct Face
+///<summary>
+///Vertex and edge loop of a polygon, allocated with AllocatorT. Face is the
+///heap one used everywhere by default.
+///</summary>
+template<typename AllocatorT>
+struct BasicFace
 {
-	std::vector<int> vertices;
-	std::vector<int> edges;
+	typedef AllocatorT allocator_type;
 
-	Face() {}
-	Face(std::initializer_list<int> vert_ids, std::initializer_list<int> edge_ids);
+	std::vector<int, AllocatorT> vertices;
+	std::vector<int, AllocatorT> edges;
+
+	BasicFace() {}
+	explicit BasicFace(const AllocatorT &allocator) : vertices(allocator), edges(allocator) {}
+	BasicFace(std::initializer_list<int> vert_ids, std::initializer_list<int> edge_ids) : vertices(vert_ids), edges(edge_ids) {}
+
+	template<typename OtherT>
+	BasicFace(const BasicFace<OtherT> &f, const AllocatorT &allocator) :
+		vertices(f.vertices.begin(), f.vertices.end(), allocator),
+		edges(f.edges.begin(), f.edges.end(), allocator)
+	{
+	}
 
-	bool operator==(const Face &f) const
+	bool operator==(const BasicFace &f) const
 	{
 		for (auto it = vertices.begin(); it != vertices.end(); ++it)
 		{
@@ -73,25 +178,92 @@ struct Face
 		return true;
 	}
 
-	bool operator!=(const Face &f) const { return !(this->operator==(f)); }
+	bool operator!=(const BasicFace &f) const { return !(this->operator==(f)); }
 };
 
+typedef BasicFace<std::allocator<int>> Face;
+
 
+///<summary>
+///Indexed triangle list. Indices are 16 bits while the vertices fit, and are
+///stored in indices32 instead (indices left empty) past 65535 vertices.
+///normals is empty until computeNormals fills it, 3 floats per vertex, and
+///occlusion until bakeAmbientOcclusion fills it, 1 float per vertex.
+///lines holds the wireframe, 2 indices per unique edge, with the same 16 / 32
+///bits split as the triangles.
+///</summary>
 struct RenderableMesh
 {
 	std::vector<float> vertices;
+	std::vector<float> normals;
+	std::vector<float> occlusion;
 	std::vector<uint16_t> indices;
+	std::vector<uint32_t> indices32;
+	std::vector<uint16_t> lines;
+	std::vector<uint32_t> lines32;
+
+	bool hasWideIndices() const { return !indices32.empty(); }
+
+	size_t indexCount() const { return hasWideIndices() ? indices32.size() : indices.size(); }
+
+	uint32_t getIndex(size_t i) const { return hasWideIndices() ? indices32[i] : indices[i]; }
+
+	bool hasWideLines() const { return !lines32.empty(); }
+
+	size_t lineIndexCount() const { return hasWideLines() ? lines32.size() : lines.size(); }
+
+	uint32_t getLineIndex(size_t i) const { return hasWideLines() ? lines32[i] : lines[i]; }
+
+	MemoryReport memoryUsage() const;
 
 	std::vector<glm::vec3> toVec3() const;
 };
 
-struct Mesh
+///<summary>
+///Polygon mesh with coordinates of type T, stored as LayoutT lays them out.
+///The subdivision engines are compiled for every instantiation, so double or
+///SoA meshes get their own kernels rather than a runtime switch.
+///</summary>
+template<typename T, typename LayoutT = MeshAoS>
+struct BasicMesh
 {
-	std::vector<Vertex> vertices;
-	std::vector<Edge> edges;
-	std::vector<Face> faces;
+	typedef BasicVertex<T> vertex_type;
+	typedef BasicMesh mesh_type;
+	typedef LayoutT layout_type;
+	typedef typename LayoutT::template Allocator<int> allocator_type;
+	typedef BasicFace<allocator_type> face_type;
+
+	typename LayoutT::template Storage<T> vertices;
+	std::vector<Edge, typename LayoutT::template Allocator<Edge>> edges;
+	std::vector<face_type, typename LayoutT::template Allocator<face_type>> faces;
+
+	BasicMesh() {}
+	explicit BasicMesh(const allocator_type &allocator) : vertices(allocator), edges(allocator), faces(allocator) {}
+
+	///<summary>
+	///Copy of another mesh with its coordinates converted, for example to run
+	///deep subdivisions in double and draw the result in float, or to move a
+	///mesh into an arena.
+	///</summary>
+	template<typename U, typename OtherLayoutT>
+	explicit BasicMesh(const BasicMesh<U, OtherLayoutT> &mesh, const allocator_type &allocator = allocator_type()) :
+		vertices(allocator),
+		edges(mesh.edges.begin(), mesh.edges.end(), allocator),
+		faces(allocator)
+	{
+		vertices.reserve(mesh.vertices.size());
+		for (size_t i = 0; i < mesh.vertices.size(); ++i)
+			vertices.push_back(vertex_type(mesh.vertices[i]));
 
-	Mesh() {}
+		faces.reserve(mesh.faces.size());
+		for (size_t i = 0; i < mesh.faces.size(); ++i)
+			faces.push_back(face_type(mesh.faces[i], allocator));
+	}
+
+	///<summary>
+	///Empty face allocated like the mesh, for the passes that build faces.
+	///</summary>
+	face_type makeFace() const { return face_type(allocator_type(faces.get_allocator())); }
 
 	std::vector<int> getConnectedVertices(int vert_id) const;
 
@@ -101,15 +273,51 @@ struct Mesh
 
 	std::vector<int> getConnectedFacesToEdge(int edge_id) const;
 
+	///<summary>
+	///Same queries into ids, cleared first, so that a pass reuses one arena
+	///backed buffer instead of getting a new vector per vertex or edge.
+	///</summary>
+	void getConnectedVertices(int vert_id, ArenaVector<int> &ids) const;
+
+	void getConnectedEdges(int vert_id, ArenaVector<int> &ids) const;
+
+	void getConnectedFaces(int vert_id, ArenaVector<int> &ids) const;
+
+	void getConnectedFacesToEdge(int edge_id, ArenaVector<int> &ids) const;
+
 	int getEdgeId(const Edge &e);
 
-	std::vector<uint16_t> faceToIndices(int face_id) const { return faceToIndices(face_id, getBaryCenter()); }
+	std::vector<int> getFaceLoop(int face_id) const;
+
+	void getFaceLoop(int face_id, std::vector<int> &loop) const;
 
-	std::vector<uint16_t> faceToIndices(int face_id, const Vertex &barycenter) const;
+	std::vector<uint32_t> faceToIndices(int face_id) const { return faceToIndices(face_id, getBaryCenter()); }
 
+	///<summary>
+	///Fan triangulation of a face, wound counter-clockwise seen from outside,
+	///outside being away from barycenter.
+	///</summary>
+	std::vector<uint32_t> faceToIndices(int face_id, const vertex_type &barycenter) const;
+
+	///<summary>
+	///Triangles of every face, plus the edges as lines: each edge is stored
+	///once in edges, so the wireframe draws it once rather than once per face.
+	///</summary>
 	RenderableMesh getRenderableMesh() const;
 
 
-	Vertex getBaryCenter() const;
+	vertex_type getBaryCenter() const;
+
+	///<summary>
+	///Heap held by the mesh. "face loops" counts the vertex and edge lists every
+	///face allocates on its own, usually the largest part.
+	///</summary>
+	MemoryReport memoryUsage() const;
 };
 
+typedef BasicMesh<float> Mesh;
+typedef BasicMesh<double> MeshD;
+typedef BasicMesh<float, MeshSoA> MeshSoAF;
+typedef BasicMesh<double, MeshSoA> MeshSoAD;
+typedef BasicMesh<float, MeshArena> MeshArenaF;
+
@@ -0,0 +1,291 @@
+#include "MeshValidate.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "MeshBuilder.h"
+#include "Parallel.h"
+
+
+std::string MeshValidation::describe() const
+{
+	std::ostringstream out;
+	const char *names[] = { "bad indices", "degenerate edges", "open faces", "mismatched faces", "duplicate edges", "unused edges",
+		"boundary edges", "non manifold edges", "non manifold vertices", "flipped edges", "isolated vertices" };
+	const size_t counts[] = { bad_indices, degenerate_edges, open_faces, mismatched_faces, duplicate_edges, unused_edges,
+		boundary_edges, non_manifold_edges, non_manifold_vertices, flipped_edges, isolated_vertices };
+
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+	{
+		if (counts[i] == 0)
+			continue;
+		if (out.tellp() > 0)
+			out << ", ";
+		out << counts[i] << ' ' << names[i];
+	}
+
+	if (first_bad_face >= 0)
+		out << " (first bad face " << first_bad_face << ')';
+
+	return out.tellp() > 0 ? out.str() : "valid";
+}
+
+
+int meshvalidate_internal::MeshValidate_find(std::vector<int> &parents, int slot)
+{
+	while (parents[slot] != slot)
+	{
+		parents[slot] = parents[parents[slot]];
+		slot = parents[slot];
+	}
+	return slot;
+}
+
+
+namespace meshvalidate_internal
+{
+	// Per block counters of the face pass
+	struct FaceCounts
+	{
+		size_t bad_indices, open_faces, mismatched_faces;
+		int first_bad_face;
+
+		FaceCounts() : bad_indices(0), open_faces(0), mismatched_faces(0), first_bad_face(-1) {}
+	};
+
+	// Vertex list equal to the loop, up to rotation and direction
+	template<typename VerticesT>
+	bool sameCycle(const VerticesT &vertices, const std::vector<int> &loop)
+	{
+		const size_t n = loop.size();
+		if (vertices.size() != n)
+			return false;
+
+		size_t start = 0;
+		while (start < n && vertices[start] != loop[0])
+			++start;
+		if (start == n)
+			return false;
+
+		bool forward = true, backward = true;
+		for (size_t i = 0; i < n && (forward || backward); ++i)
+		{
+			forward = forward && vertices[(start + i) % n] == loop[i];
+			backward = backward && vertices[(start + n - i) % n] == loop[i];
+		}
+		return forward || backward;
+	}
+
+	template<typename MeshT>
+	MeshValidation validate(const MeshT &mesh)
+	{
+		MeshValidation ret;
+		const int nb_vertices = static_cast<int>(mesh.vertices.size());
+		const int nb_edges = static_cast<int>(mesh.edges.size());
+		const size_t nb_faces = mesh.faces.size();
+
+		// Edges: bounds, degenerate ones, and keys to find the duplicates
+		std::vector<char> bad_edge(nb_edges, 0);
+		std::vector<uint64_t> keys(nb_edges);
+		std::vector<uint32_t> ids(nb_edges);
+		parallel::parallelFor(0, nb_edges, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t e = first; e < last; ++e)
+			{
+				int a = mesh.edges[e].vertices[0], b = mesh.edges[e].vertices[1];
+				ids[e] = static_cast<uint32_t>(e);
+				if (a < 0 || b < 0 || a >= nb_vertices || b >= nb_vertices)
+				{
+					bad_edge[e] = 1;
+					keys[e] = ~uint64_t(0) - e;
+				}
+				else
+				{
+					bad_edge[e] = a == b ? 2 : 0;
+					keys[e] = meshbuilder_internal::MeshBuilder_edge_key(a, b);
+				}
+			}
+		});
+
+		for (int e = 0; e < nb_edges; ++e)
+		{
+			ret.bad_indices += bad_edge[e] == 1 ? 1 : 0;
+			ret.degenerate_edges += bad_edge[e] == 2 ? 1 : 0;
+		}
+
+		parallel::radixSort(keys, ids);
+		for (size_t i = 1; i < keys.size(); ++i)
+			ret.duplicate_edges += keys[i] == keys[i - 1] ? 1 : 0;
+
+		// Faces: walk the loop of every face from its edges. loops[offsets[f] + i]
+		// is the vertex between edges i - 1 and i, forward[] tells whether edge i
+		// is walked from its first vertex.
+		std::vector<size_t> offsets(nb_faces + 1, 0);
+		for (size_t f = 0; f < nb_faces; ++f)
+			offsets[f + 1] = offsets[f] + mesh.faces[f].edges.size();
+
+		std::vector<int> loops(offsets.back());
+		std::vector<char> forward(offsets.back()), good_face(nb_faces, 0);
+		std::vector<FaceCounts> block_counts(parallel::blockCount(nb_faces, 1024));
+		parallel::parallelFor(0, nb_faces, [&](size_t first, size_t last, unsigned int block)
+		{
+			FaceCounts &counts = block_counts[block];
+			std::vector<int> loop;
+			for (size_t f = first; f < last; ++f)
+			{
+				const auto &face = mesh.faces[f];
+				const size_t n = face.edges.size();
+				bool bad_index = false;
+				for (size_t i = 0; i < n; ++i)
+					bad_index = bad_index || face.edges[i] < 0 || face.edges[i] >= nb_edges || bad_edge[face.edges[i]] == 1;
+				for (size_t i = 0; i < face.vertices.size(); ++i)
+					bad_index = bad_index || face.vertices[i] < 0 || face.vertices[i] >= nb_vertices;
+
+				bool closed = n >= 3 && !bad_index;
+				loop.resize(n);
+				for (size_t i = 0; i < n && closed; ++i)
+				{
+					const Edge &prev = mesh.edges[face.edges[(i + n - 1) % n]];
+					const Edge &cur = mesh.edges[face.edges[i]];
+					if (cur.vertices[0] == prev.vertices[0] || cur.vertices[0] == prev.vertices[1])
+						loop[i] = cur.vertices[0];
+					else if (cur.vertices[1] == prev.vertices[0] || cur.vertices[1] == prev.vertices[1])
+						loop[i] = cur.vertices[1];
+					else
+						closed = false;
+				}
+
+				// Every edge must go from its loop vertex to the next one
+				for (size_t i = 0; i < n && closed; ++i)
+				{
+					const Edge &cur = mesh.edges[face.edges[i]];
+					int next = loop[(i + 1) % n];
+					bool fwd = cur.vertices[0] == loop[i] && cur.vertices[1] == next;
+					bool bwd = cur.vertices[1] == loop[i] && cur.vertices[0] == next;
+					closed = fwd || bwd;
+					forward[offsets[f] + i] = fwd ? 1 : 0;
+					loops[offsets[f] + i] = loop[i];
+				}
+
+				bool matches = !closed || face.vertices.empty() || sameCycle(face.vertices, loop);
+
+				counts.bad_indices += bad_index ? 1 : 0;
+				counts.open_faces += !bad_index && !closed ? 1 : 0;
+				counts.mismatched_faces += matches ? 0 : 1;
+				good_face[f] = closed && matches ? 1 : 0;
+				if (!good_face[f] && counts.first_bad_face < 0)
+					counts.first_bad_face = static_cast<int>(f);
+			}
+		}, 1024);
+
+		for (auto it = block_counts.begin(); it != block_counts.end(); ++it)
+		{
+			ret.bad_indices += it->bad_indices;
+			ret.open_faces += it->open_faces;
+			ret.mismatched_faces += it->mismatched_faces;
+			if (it->first_bad_face >= 0 && ret.first_bad_face < 0)
+				ret.first_bad_face = it->first_bad_face;
+		}
+
+		// Edge uses and orientation, over the faces that passed
+		std::vector<uint32_t> uses(nb_edges, 0), forward_uses(nb_edges, 0);
+		for (size_t f = 0; f < nb_faces; ++f)
+		{
+			if (!good_face[f])
+				continue;
+			const auto &face = mesh.faces[f];
+			for (size_t i = 0; i < face.edges.size(); ++i)
+			{
+				++uses[face.edges[i]];
+				forward_uses[face.edges[i]] += forward[offsets[f] + i];
+			}
+		}
+
+		for (int e = 0; e < nb_edges; ++e)
+		{
+			if (bad_edge[e] == 1)
+				continue;
+			if (uses[e] == 0)
+				++ret.unused_edges;
+			else if (uses[e] == 1)
+				++ret.boundary_edges;
+			else if (uses[e] > 2)
+				++ret.non_manifold_edges;
+			else if (forward_uses[e] != 1)
+				++ret.flipped_edges;
+		}
+
+		// Fans: every face corner joins the two (edge, end) slots it sits
+		// between, a vertex is manifold when its used slots form one set
+		std::vector<int> parents(static_cast<size_t>(nb_edges) * 2);
+		for (size_t s = 0; s < parents.size(); ++s)
+			parents[s] = static_cast<int>(s);
+
+		auto slot = [&](int e, int v) { return e * 2 + (mesh.edges[e].vertices[0] == v ? 0 : 1); };
+		for (size_t f = 0; f < nb_faces; ++f)
+		{
+			if (!good_face[f])
+				continue;
+			const auto &face = mesh.faces[f];
+			const size_t n = face.edges.size();
+			for (size_t i = 0; i < n; ++i)
+			{
+				int v = loops[offsets[f] + i];
+				int a = MeshValidate_find(parents, slot(face.edges[(i + n - 1) % n], v));
+				int b = MeshValidate_find(parents, slot(face.edges[i], v));
+				if (a != b)
+					parents[a] = b;
+			}
+		}
+
+		std::vector<uint32_t> fans(nb_vertices, 0);
+		std::vector<char> touched(nb_vertices, 0);
+		for (int e = 0; e < nb_edges; ++e)
+		{
+			if (bad_edge[e] == 1)
+				continue;
+			for (int k = 0; k < 2; ++k)
+			{
+				int v = mesh.edges[e].vertices[k];
+				touched[v] = 1;
+				if (uses[e] > 0 && MeshValidate_find(parents, e * 2 + k) == e * 2 + k)
+					++fans[v];
+			}
+		}
+
+		for (int v = 0; v < nb_vertices; ++v)
+		{
+			ret.non_manifold_vertices += fans[v] > 1 ? 1 : 0;
+			ret.isolated_vertices += touched[v] ? 0 : 1;
+		}
+
+		return ret;
+	}
+}
+
+
+MeshValidation validateMesh(const Mesh &mesh)
+{
+	return meshvalidate_internal::validate(mesh);
+}
+
+MeshValidation validateMesh(const MeshView &mesh)
+{
+	return meshvalidate_internal::validate(mesh);
+}
+
+
+void checkMesh(const Mesh &mesh, bool require_manifold)
+{
+	MeshValidation v = validateMesh(mesh);
+	if (!v.isValid() || (require_manifold && !v.isManifold()))
+		throw std::invalid_argument("Invalid mesh: " + v.describe());
+}
+
+void checkMesh(const MeshView &mesh, bool require_manifold)
+{
+	MeshValidation v = validateMesh(mesh);
+	if (!v.isValid() || (require_manifold && !v.isManifold()))
+		throw std::invalid_argument("Invalid mesh: " + v.describe());
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "MeshUtils.h"
+#include "MeshView.h"
+
+
+// Topology checks run before a mesh reaches the subdivision engines, which
+// assume closed face loops and in range ids and do not check them.
+
+struct MeshValidation
+{
+	// Errors: the engines can not process the mesh
+	size_t bad_indices; // edge or face references out of range
+	size_t degenerate_edges; // edges whose two ends are the same vertex
+	size_t open_faces; // faces with less than 3 edges or whose edges do not close a loop
+	size_t mismatched_faces; // faces whose vertex list is not the loop of their edges
+
+	// Topology: the mesh is usable but not a clean oriented 2-manifold
+	size_t duplicate_edges; // edges joining the same two vertices as another edge
+	size_t unused_edges;
+	size_t boundary_edges;
+	size_t non_manifold_edges; // used by more than two faces
+	size_t non_manifold_vertices; // whose faces form more than one fan
+	size_t flipped_edges; // walked in the same direction by both of their faces
+	size_t isolated_vertices;
+
+	int first_bad_face; // -1 when every face passed the error checks
+
+	MeshValidation() : bad_indices(0), degenerate_edges(0), open_faces(0), mismatched_faces(0), duplicate_edges(0), unused_edges(0),
+		boundary_edges(0), non_manifold_edges(0), non_manifold_vertices(0), flipped_edges(0), isolated_vertices(0), first_bad_face(-1) {}
+
+	bool isValid() const { return bad_indices == 0 && degenerate_edges == 0 && open_faces == 0 && mismatched_faces == 0; }
+
+	bool isManifold() const { return duplicate_edges == 0 && non_manifold_edges == 0 && non_manifold_vertices == 0; }
+
+	bool isClosed() const { return boundary_edges == 0; }
+
+	bool isOriented() const { return flipped_edges == 0; }
+
+	///<summary>
+	///One line listing the non zero counters, "valid" when there are none.
+	///</summary>
+	std::string describe() const;
+};
+
+
+namespace meshvalidate_internal
+{
+	// Union find over the (edge, end) slots of a mesh, with path halving
+	int MeshValidate_find(std::vector<int> &parents, int slot);
+}
+
+
+///<summary>
+///Checks index bounds, edge loops of the faces against their vertex lists,
+///edge use counts, fans around every vertex and orientation of shared edges.
+///Edges and faces are checked in parallel; the whole pass is linear in the size of the mesh.
+///</summary>
+MeshValidation validateMesh(const Mesh &mesh);
+
+MeshValidation validateMesh(const MeshView &mesh);
+
+///<summary>
+///Throws std::invalid_argument with the description of the problems when mesh
+///fails isValid(), or isManifold() if require_manifold is set.
+///</summary>
+void checkMesh(const Mesh &mesh, bool require_manifold = false);
+
+void checkMesh(const MeshView &mesh, bool require_manifold = false);
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "MeshUtils.h"
+
+
+template<typename T>
+struct ArrayView
+{
+	typedef T value_type;
+
+	const T *ptr;
+	size_t count;
+
+	ArrayView() : ptr(nullptr), count(0) {}
+	ArrayView(const T *ptr, size_t count) : ptr(ptr), count(count) {}
+	ArrayView(const std::vector<T> &v) : ptr(v.data()), count(v.size()) {}
+
+	const T &operator[](size_t i) const { return ptr[i]; }
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	const T *data() const { return ptr; }
+	const T *begin() const { return ptr; }
+	const T *end() const { return ptr + count; }
+
+	const T &front() const { return ptr[0]; }
+	const T &back() const { return ptr[count - 1]; }
+};
+
+
+struct FaceView
+{
+	ArrayView<int> vertices;
+	ArrayView<int> edges;
+};
+
+
+///<summary>
+///Faces stored as flat index arrays: face i uses
+///vertex_ids[vertex_offsets[i] .. vertex_offsets[i + 1]) and
+///edge_ids[edge_offsets[i] .. edge_offsets[i + 1]).
+///</summary>
+struct FaceListView
+{
+	const int *vertex_offsets;
+	const int *vertex_ids;
+	const int *edge_offsets;
+	const int *edge_ids;
+	size_t count;
+
+	FaceListView() : vertex_offsets(nullptr), vertex_ids(nullptr), edge_offsets(nullptr), edge_ids(nullptr), count(0) {}
+
+	FaceView operator[](size_t i) const
+	{
+		FaceView f;
+		f.vertices = ArrayView<int>(vertex_ids + vertex_offsets[i], vertex_offsets[i + 1] - vertex_offsets[i]);
+		f.edges = ArrayView<int>(edge_ids + edge_offsets[i], edge_offsets[i + 1] - edge_offsets[i]);
+		return f;
+	}
+
+	size_t size() const { return count; }
+};
+
+
+///<summary>
+///Read-only Mesh over memory owned by someone else, typically a mapped MeshFile.
+///Offers the same read accessors as Mesh so CatMull, Loops, Kobbelt and
+///getRenderableMesh run on it without copying the data into a Mesh first.
+///</summary>
+struct MeshView
+{
+	typedef Vertex vertex_type;
+	typedef Mesh mesh_type; // what the subdivision engines return for a view
+
+	ArrayView<Vertex> vertices;
+	ArrayView<Edge> edges;
+	FaceListView faces;
+
+	MeshView() {}
+
+	std::vector<int> getConnectedVertices(int vert_id) const;
+
+	std::vector<int> getConnectedEdges(int vert_id) const;
+
+	std::vector<int> getConnectedFaces(int vert_id) const;
+
+	std::vector<int> getConnectedFacesToEdge(int edge_id) const;
+
+	///<summary>
+	///Same queries into ids, cleared first, so that a pass reuses one arena
+	///backed buffer instead of getting a new vector per vertex or edge.
+	///</summary>
+	void getConnectedVertices(int vert_id, ArenaVector<int> &ids) const;
+
+	void getConnectedEdges(int vert_id, ArenaVector<int> &ids) const;
+
+	void getConnectedFaces(int vert_id, ArenaVector<int> &ids) const;
+
+	void getConnectedFacesToEdge(int edge_id, ArenaVector<int> &ids) const;
+
+	std::vector<int> getFaceLoop(int face_id) const;
+
+	void getFaceLoop(int face_id, std::vector<int> &loop) const;
+
+	std::vector<uint32_t> faceToIndices(int face_id) const { return faceToIndices(face_id, getBaryCenter()); }
+
+	std::vector<uint32_t> faceToIndices(int face_id, const Vertex &barycenter) const;
+
+	RenderableMesh getRenderableMesh() const;
+
+	Vertex getBaryCenter() const;
+
+	Mesh toMesh() const;
+};
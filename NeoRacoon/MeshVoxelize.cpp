@@ -0,0 +1,253 @@
+#include "MeshVoxelize.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "Parallel.h"
+#include "PointLayout.h"
+#include "VertexCache.h"
+
+
+VoxelGrid::VoxelGrid(const glm::vec3 &origin, float voxel_size, int nx, int ny, int nz) : origin(origin), voxel_size(voxel_size)
+{
+	if (!(voxel_size > 0.0f))
+		throw std::invalid_argument("VoxelGrid: voxel size must be positive");
+	if (nx < 0 || ny < 0 || nz < 0)
+		throw std::invalid_argument("VoxelGrid: negative size");
+
+	dims[0] = nx;
+	dims[1] = ny;
+	dims[2] = nz;
+	voxels.assign(static_cast<size_t>(nx) * ny * nz, 0);
+}
+
+size_t VoxelGrid::filledCount() const
+{
+	return static_cast<size_t>(std::count(voxels.begin(), voxels.end(), 1));
+}
+
+
+bool meshvoxelize_internal::MeshVoxelize_triangle_box(const glm::vec3 &center, const glm::vec3 &half, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+	const glm::vec3 v[3] = { a - center, b - center, c - center };
+	const glm::vec3 edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+
+	// Box face normals
+	for (int k = 0; k < 3; ++k)
+	{
+		if (std::min(v[0][k], std::min(v[1][k], v[2][k])) > half[k] || std::max(v[0][k], std::max(v[1][k], v[2][k])) < -half[k])
+			return false;
+	}
+
+	// Triangle normal
+	const glm::vec3 n = glm::cross(edges[0], edges[1]);
+	if (std::fabs(glm::dot(n, v[0])) > glm::dot(half, glm::abs(n)))
+		return false;
+
+	// Cross products of the box axes with the triangle edges
+	for (int k = 0; k < 3; ++k)
+	{
+		glm::vec3 box_axis(0.0f);
+		box_axis[k] = 1.0f;
+		for (int e = 0; e < 3; ++e)
+		{
+			const glm::vec3 axis = glm::cross(box_axis, edges[e]);
+			const float p0 = glm::dot(axis, v[0]), p1 = glm::dot(axis, v[1]), p2 = glm::dot(axis, v[2]);
+			const float r = glm::dot(half, glm::abs(axis));
+			if (std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+void meshvoxelize_internal::MeshVoxelize_surface(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices, VoxelGrid &grid)
+{
+	const size_t nb_triangles = indices.size() / 3;
+	const float s = grid.voxel_size;
+	const glm::vec3 half(0.5f * s);
+
+	// Voxel range of every triangle's bounds, empty when it misses the grid
+	std::vector<int> ranges(nb_triangles * 6);
+	parallel::parallelFor(0, nb_triangles, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t t = first; t < last; ++t)
+		{
+			const glm::vec3 &a = positions[indices[t * 3]], &b = positions[indices[t * 3 + 1]], &c = positions[indices[t * 3 + 2]];
+			const glm::vec3 lo = (glm::min(a, glm::min(b, c)) - grid.origin) / s;
+			const glm::vec3 hi = (glm::max(a, glm::max(b, c)) - grid.origin) / s;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				ranges[t * 6 + axis] = std::max(static_cast<int>(std::floor(lo[axis])), 0);
+				ranges[t * 6 + 3 + axis] = std::min(static_cast<int>(std::floor(hi[axis])), grid.dims[axis] - 1);
+			}
+		}
+	});
+
+	parallel::parallelFor(0, grid.dims[2], [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t t = 0; t < nb_triangles; ++t)
+		{
+			const int *r = &ranges[t * 6];
+			const int k0 = std::max(r[2], static_cast<int>(first)), k1 = std::min(r[5], static_cast<int>(last) - 1);
+			if (k0 > k1 || r[0] > r[3] || r[1] > r[4])
+				continue;
+
+			const glm::vec3 &a = positions[indices[t * 3]], &b = positions[indices[t * 3 + 1]], &c = positions[indices[t * 3 + 2]];
+			for (int k = k0; k <= k1; ++k)
+			{
+				for (int j = r[1]; j <= r[4]; ++j)
+				{
+					for (int i = r[0]; i <= r[3]; ++i)
+					{
+						uint8_t &voxel = grid.voxels[grid.index(i, j, k)];
+						if (!voxel && MeshVoxelize_triangle_box(grid.center(i, j, k), half, a, b, c))
+							voxel = 1;
+					}
+				}
+			}
+		}
+	}, 1);
+}
+
+
+namespace meshvoxelize_internal
+{
+	// Edges owning the points that lie exactly on them, one of the two
+	// directions of every edge
+	bool inclusive(double dy, double dz)
+	{
+		return dz > 0.0 || (dz == 0.0 && dy < 0.0);
+	}
+
+	bool covers(double w, double dy, double dz)
+	{
+		return w > 0.0 || (w == 0.0 && inclusive(dy, dz));
+	}
+}
+
+void meshvoxelize_internal::MeshVoxelize_fill(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices, VoxelGrid &grid)
+{
+	const size_t nb_triangles = indices.size() / 3;
+	const int nx = grid.dims[0], ny = grid.dims[1];
+	const double s = grid.voxel_size;
+	const glm::dvec3 origin(grid.origin);
+
+	parallel::parallelFor(0, grid.dims[2], [&](size_t first, size_t last, unsigned int)
+	{
+		// Crossings of every row of the block's slices
+		std::vector<std::vector<double>> rows((last - first) * ny);
+
+		for (size_t t = 0; t < nb_triangles; ++t)
+		{
+			glm::dvec3 a(positions[indices[t * 3]]), b(positions[indices[t * 3 + 1]]), c(positions[indices[t * 3 + 2]]);
+			const double area = (b.y - a.y) * (c.z - a.z) - (b.z - a.z) * (c.y - a.y);
+			if (area == 0.0)
+				continue;
+			if (area < 0.0)
+				std::swap(b, c);
+
+			// Rows whose center line may cross the triangle
+			const double lo_y = std::min(a.y, std::min(b.y, c.y)), hi_y = std::max(a.y, std::max(b.y, c.y));
+			const double lo_z = std::min(a.z, std::min(b.z, c.z)), hi_z = std::max(a.z, std::max(b.z, c.z));
+			const int j0 = std::max(static_cast<int>(std::ceil((lo_y - origin.y) / s - 0.5)), 0);
+			const int j1 = std::min(static_cast<int>(std::floor((hi_y - origin.y) / s - 0.5)), ny - 1);
+			const int k0 = std::max(static_cast<int>(std::ceil((lo_z - origin.z) / s - 0.5)), static_cast<int>(first));
+			const int k1 = std::min(static_cast<int>(std::floor((hi_z - origin.z) / s - 0.5)), static_cast<int>(last) - 1);
+			if (j0 > j1 || k0 > k1)
+				continue;
+
+			const glm::dvec3 n = glm::cross(b - a, c - a);
+			for (int k = k0; k <= k1; ++k)
+			{
+				const double z = origin.z + (k + 0.5) * s;
+				for (int j = j0; j <= j1; ++j)
+				{
+					const double y = origin.y + (j + 0.5) * s;
+					const double wa = (c.y - b.y) * (z - b.z) - (c.z - b.z) * (y - b.y);
+					const double wb = (a.y - c.y) * (z - c.z) - (a.z - c.z) * (y - c.y);
+					const double wc = (b.y - a.y) * (z - a.z) - (b.z - a.z) * (y - a.y);
+					if (!covers(wa, c.y - b.y, c.z - b.z) || !covers(wb, a.y - c.y, a.z - c.z) || !covers(wc, b.y - a.y, b.z - a.z))
+						continue;
+
+					rows[(k - first) * ny + j].push_back(a.x - (n.y * (y - a.y) + n.z * (z - a.z)) / n.x);
+				}
+			}
+		}
+
+		for (size_t row = 0; row < rows.size(); ++row)
+		{
+			std::vector<double> &crossings = rows[row];
+			std::sort(crossings.begin(), crossings.end());
+
+			uint8_t *voxels = grid.voxels.data() + (first * ny + row) * nx;
+			for (size_t p = 0; p + 1 < crossings.size(); p += 2)
+			{
+				const int i0 = std::max(static_cast<int>(std::ceil((crossings[p] - origin.x) / s - 0.5)), 0);
+				const int i1 = std::min(static_cast<int>(std::ceil((crossings[p + 1] - origin.x) / s - 0.5)), nx);
+				if (i0 < i1)
+					std::fill(voxels + i0, voxels + i1, 1);
+			}
+		}
+	}, 1);
+}
+
+
+void voxelizeMesh(const RenderableMesh &mesh, VoxelGrid &grid, bool solid)
+{
+	using namespace meshvoxelize_internal;
+
+	std::vector<glm::vec3> positions;
+	copyPoints(mesh.vertices, positions);
+	std::vector<uint32_t> indices = vertexcache_internal::VertexCache_read_indices(mesh);
+	indices.resize(indices.size() / 3 * 3);
+
+	MeshVoxelize_surface(positions, indices, grid);
+	if (solid)
+		MeshVoxelize_fill(positions, indices, grid);
+}
+
+void voxelizeMesh(const Mesh &mesh, VoxelGrid &grid, bool solid)
+{
+	voxelizeMesh(mesh.getRenderableMesh(), grid, solid);
+}
+
+
+VoxelGrid voxelizeMesh(const RenderableMesh &mesh, float voxel_size, bool solid)
+{
+	if (!(voxel_size > 0.0f))
+		throw std::invalid_argument("voxelizeMesh: voxel_size must be positive");
+	if (mesh.vertices.empty())
+		return VoxelGrid();
+
+	ArrayView<glm::vec3> points = viewPoints<glm::vec3>(mesh.vertices);
+	glm::vec3 lo = points[0], hi = points[0];
+	for (auto it = points.begin(); it != points.end(); ++it)
+	{
+		lo = glm::min(lo, *it);
+		hi = glm::max(hi, *it);
+	}
+
+	int dims[3];
+	double nb_voxels = 1.0;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const double extent = std::ceil((hi[axis] - lo[axis]) / voxel_size);
+		nb_voxels *= extent + 2;
+		if (nb_voxels > (1 << 30))
+			throw std::invalid_argument("voxelizeMesh: voxel_size is too small for the mesh bounds");
+		dims[axis] = static_cast<int>(extent) + 2;
+	}
+
+	VoxelGrid grid(lo - voxel_size, voxel_size, dims[0], dims[1], dims[2]);
+	voxelizeMesh(mesh, grid, solid);
+	return grid;
+}
+
+VoxelGrid voxelizeMesh(const Mesh &mesh, float voxel_size, bool solid)
+{
+	return voxelizeMesh(mesh.getRenderableMesh(), voxel_size, solid);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+
+
+// Conversion of triangle meshes to voxels: a conservative surface shell from
+// triangle / box overlap tests, optionally filled by scanline parity.
+
+///<summary>
+///Occupancy of an nx * ny * nz block of voxels, x fastest. Voxel (i, j, k) is the
+///box of side voxel_size whose min corner is origin + voxel_size * (i, j, k).
+///</summary>
+struct VoxelGrid
+{
+	glm::vec3 origin;
+	float voxel_size;
+	int dims[3];
+	std::vector<uint8_t> voxels; // 1 for filled voxels
+
+	VoxelGrid() : origin(0.0f), voxel_size(1.0f) { dims[0] = dims[1] = dims[2] = 0; }
+
+	VoxelGrid(const glm::vec3 &origin, float voxel_size, int nx, int ny, int nz);
+
+	size_t index(int i, int j, int k) const { return (static_cast<size_t>(k) * dims[1] + j) * dims[0] + i; }
+
+	bool at(int i, int j, int k) const { return voxels[index(i, j, k)] != 0; }
+
+	glm::vec3 center(int i, int j, int k) const { return origin + voxel_size * (glm::vec3(static_cast<float>(i), static_cast<float>(j), static_cast<float>(k)) + 0.5f); }
+
+	size_t filledCount() const;
+};
+
+
+namespace meshvoxelize_internal
+{
+	// Separating axis test of the triangle abc against the box center +- half
+	bool MeshVoxelize_triangle_box(const glm::vec3 &center, const glm::vec3 &half, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+
+	// Marks every voxel overlapped by a triangle. Blocks of z slices run in parallel.
+	void MeshVoxelize_surface(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices, VoxelGrid &grid);
+
+	// Fills the voxels whose center is inside the mesh, from the crossings of
+	// every x row through the voxel centers. Shared edges and vertices are
+	// counted once with a top-left rule in the yz plane.
+	void MeshVoxelize_fill(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices, VoxelGrid &grid);
+}
+
+
+///<summary>
+///Adds mesh to grid: its surface, and with solid its interior, which needs a
+///closed mesh. Parts of mesh outside grid are clipped. Filled voxels stay filled,
+///so several meshes can be voxelized into the same grid.
+///</summary>
+void voxelizeMesh(const RenderableMesh &mesh, VoxelGrid &grid, bool solid = true);
+
+void voxelizeMesh(const Mesh &mesh, VoxelGrid &grid, bool solid = true);
+
+///<summary>
+///Voxelizes mesh into a grid fitted to its bounds plus one voxel.
+///Throws std::invalid_argument for a non positive voxel_size or a grid of more than 2^30 voxels.
+///</summary>
+VoxelGrid voxelizeMesh(const RenderableMesh &mesh, float voxel_size, bool solid = true);
+
+VoxelGrid voxelizeMesh(const Mesh &mesh, float voxel_size, bool solid = true);
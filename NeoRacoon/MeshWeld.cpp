@@ -0,0 +1,246 @@
+#include "MeshWeld.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "MeshBuilder.h"
+#include "MeshIslands.h"
+#include "VertexCache.h"
+
+
+namespace meshweld_internal
+{
+	const int BITS = 21; // per axis, 63 bit cell keys
+	const int64_t MAX_CELL = (int64_t(1) << BITS) - 1;
+
+	uint64_t cellKey(int64_t x, int64_t y, int64_t z)
+	{
+		return static_cast<uint64_t>(x) << (2 * BITS) | static_cast<uint64_t>(y) << BITS | static_cast<uint64_t>(z);
+	}
+}
+
+
+size_t meshweld_internal::MeshWeld_weld(const double *xyz, size_t count, double tolerance, std::vector<uint32_t> &remap, std::vector<uint32_t> &firsts)
+{
+	remap.resize(count);
+	firsts.clear();
+	if (count == 0)
+		return 0;
+
+	if (count > static_cast<size_t>(std::numeric_limits<int>::max()))
+		throw std::invalid_argument("weldPoints: too many points");
+	if (!(tolerance >= 0.0))
+		throw std::invalid_argument("weldPoints: tolerance must not be negative");
+
+	double min[3] = { xyz[0], xyz[1], xyz[2] }, max[3] = { xyz[0], xyz[1], xyz[2] };
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			min[k] = std::min(min[k], xyz[i * 3 + k]);
+			max[k] = std::max(max[k], xyz[i * 3 + k]);
+		}
+	}
+
+	// Cells no smaller than the tolerance, and few enough to fit the key
+	double extent = std::max(max[0] - min[0], std::max(max[1] - min[1], max[2] - min[2]));
+	double cell = std::max(tolerance, extent / static_cast<double>(MAX_CELL - 1));
+	if (!(cell > 0.0))
+		cell = 1.0;
+
+	std::vector<int64_t> cells(count * 3);
+	std::vector<uint64_t> keys(count);
+	std::vector<uint32_t> ids(count);
+	parallel::parallelFor(0, count, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+				cells[i * 3 + k] = std::min(MAX_CELL, static_cast<int64_t>(std::floor((xyz[i * 3 + k] - min[k]) / cell)));
+			keys[i] = cellKey(cells[i * 3], cells[i * 3 + 1], cells[i * 3 + 2]);
+			ids[i] = static_cast<uint32_t>(i);
+		}
+	});
+
+	// Points grouped by cell, in input order within a cell as the sort is stable
+	parallel::radixSort(keys, ids);
+
+	std::vector<uint64_t> cell_keys;
+	std::vector<uint32_t> cell_offsets;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i == 0 || keys[i] != keys[i - 1])
+		{
+			cell_keys.push_back(keys[i]);
+			cell_offsets.push_back(static_cast<uint32_t>(i));
+		}
+	}
+	cell_offsets.push_back(static_cast<uint32_t>(count));
+
+	// Every point is united with all the earlier points within tolerance, so
+	// chains merge transitively. Roots are the lowest index of their group
+	const double tolerance2 = tolerance * tolerance;
+	const int reach = tolerance > 0.0 ? 1 : 0;
+	std::vector<std::atomic<int>> parents(count);
+	for (size_t i = 0; i < count; ++i)
+		parents[i].store(static_cast<int>(i));
+	parallel::parallelFor(0, count, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			const double *p = xyz + i * 3;
+			const int64_t *c = &cells[i * 3];
+
+			for (int dx = -reach; dx <= reach; ++dx)
+			for (int dy = -reach; dy <= reach; ++dy)
+			for (int dz = -reach; dz <= reach; ++dz)
+			{
+				int64_t x = c[0] + dx, y = c[1] + dy, z = c[2] + dz;
+				if (x < 0 || y < 0 || z < 0 || x > MAX_CELL || y > MAX_CELL || z > MAX_CELL)
+					continue;
+
+				uint64_t key = cellKey(x, y, z);
+				auto found = std::lower_bound(cell_keys.begin(), cell_keys.end(), key);
+				if (found == cell_keys.end() || *found != key)
+					continue;
+
+				size_t slot = found - cell_keys.begin();
+				for (uint32_t s = cell_offsets[slot]; s < cell_offsets[slot + 1] && ids[s] < i; ++s)
+				{
+					const double *q = xyz + static_cast<size_t>(ids[s]) * 3;
+					double d0 = p[0] - q[0], d1 = p[1] - q[1], d2 = p[2] - q[2];
+					if (d0 * d0 + d1 * d1 + d2 * d2 <= tolerance2)
+						meshislands_internal::MeshIslands_unite(parents, static_cast<int>(i), static_cast<int>(ids[s]));
+				}
+			}
+		}
+	});
+
+	// Roots come before the rest of their group, so one pass in order numbers them
+	for (size_t i = 0; i < count; ++i)
+	{
+		int root = meshislands_internal::MeshIslands_find(parents, static_cast<int>(i));
+		if (root == static_cast<int>(i))
+		{
+			remap[i] = static_cast<uint32_t>(firsts.size());
+			firsts.push_back(static_cast<uint32_t>(i));
+		}
+		else
+			remap[i] = remap[root];
+	}
+
+	return firsts.size();
+}
+
+
+void weldMesh(Mesh &mesh, double tolerance, std::vector<uint32_t> *vertex_remap)
+{
+	std::vector<uint32_t> remap;
+	std::vector<Vertex> positions = weldPoints(mesh.vertices, tolerance, remap);
+
+	std::vector<int> face_indices, face_offsets(1, 0), loop;
+	face_indices.reserve(mesh.faces.size() * 4);
+	for (size_t f = 0; f < mesh.faces.size(); ++f)
+	{
+		mesh.getFaceLoop(static_cast<int>(f), loop);
+
+		size_t start = face_indices.size();
+		for (auto it = loop.begin(); it != loop.end(); ++it)
+		{
+			int v = static_cast<int>(remap[*it]);
+			if (face_indices.size() == start || face_indices.back() != v)
+				face_indices.push_back(v);
+		}
+		while (face_indices.size() > start + 1 && face_indices.back() == face_indices[start])
+			face_indices.pop_back();
+
+		if (face_indices.size() - start < 3)
+			face_indices.resize(start);
+		else
+			face_offsets.push_back(static_cast<int>(face_indices.size()));
+	}
+
+	mesh = buildMesh(positions, face_indices, face_offsets);
+
+	if (vertex_remap)
+		vertex_remap->swap(remap);
+}
+
+void weldMesh(RenderableMesh &mesh, double tolerance, std::vector<uint32_t> *vertex_remap)
+{
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	std::vector<double> xyz(mesh.vertices.begin(), mesh.vertices.end());
+
+	std::vector<uint32_t> remap, firsts;
+	const size_t nb_unique = meshweld_internal::MeshWeld_weld(xyz.data(), nb_vertices, tolerance, remap, firsts);
+
+	const bool has_normals = mesh.normals.size() == mesh.vertices.size();
+	const bool has_occlusion = mesh.occlusion.size() == nb_vertices;
+	std::vector<float> vertices(nb_unique * 3), normals(has_normals ? nb_unique * 3 : 0), occlusion(has_occlusion ? nb_unique : 0);
+	for (size_t u = 0; u < nb_unique; ++u)
+	{
+		std::copy(mesh.vertices.begin() + firsts[u] * 3, mesh.vertices.begin() + firsts[u] * 3 + 3, vertices.begin() + u * 3);
+		if (has_normals)
+			std::copy(mesh.normals.begin() + firsts[u] * 3, mesh.normals.begin() + firsts[u] * 3 + 3, normals.begin() + u * 3);
+		if (has_occlusion)
+			occlusion[u] = mesh.occlusion[firsts[u]];
+	}
+
+	const std::vector<uint32_t> indices = vertexcache_internal::VertexCache_read_indices(mesh);
+	std::vector<uint32_t> welded;
+	welded.reserve(indices.size());
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+		if (a == b || b == c || c == a)
+			continue;
+		welded.push_back(a);
+		welded.push_back(b);
+		welded.push_back(c);
+	}
+
+	mesh.vertices.swap(vertices);
+	// Edges whose ends were merged vanish, edges that became the same one are kept once
+	std::vector<uint64_t> edges;
+	edges.reserve(mesh.lineIndexCount() / 2);
+	for (size_t l = 0; l + 1 < mesh.lineIndexCount(); l += 2)
+	{
+		uint32_t a = remap[mesh.getLineIndex(l)], b = remap[mesh.getLineIndex(l + 1)];
+		if (a == b)
+			continue;
+		if (a > b)
+			std::swap(a, b);
+		edges.push_back(static_cast<uint64_t>(a) << 32 | b);
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	std::vector<uint32_t> lines(edges.size() * 2);
+	for (size_t e = 0; e < edges.size(); ++e)
+	{
+		lines[e * 2] = static_cast<uint32_t>(edges[e] >> 32);
+		lines[e * 2 + 1] = static_cast<uint32_t>(edges[e]);
+	}
+
+	mesh.normals.swap(normals);
+	mesh.occlusion.swap(occlusion);
+	if (nb_unique > std::numeric_limits<uint16_t>::max())
+	{
+		mesh.indices.clear();
+		mesh.indices32.swap(welded);
+		mesh.lines.clear();
+		mesh.lines32.swap(lines);
+	}
+	else
+	{
+		mesh.indices32.clear();
+		mesh.indices.assign(welded.begin(), welded.end());
+		mesh.lines32.clear();
+		mesh.lines.assign(lines.begin(), lines.end());
+	}
+
+	if (vertex_remap)
+		vertex_remap->swap(remap);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "glm.hpp"
+#include "MeshUtils.h"
+#include "Parallel.h"
+
+
+// Tolerance based vertex welding. Points are bucketed in a grid whose cells are
+// at least as wide as the tolerance, so every point within tolerance of another
+// lies in one of the 27 cells around it, and the welding is near linear.
+
+namespace meshweld_internal
+{
+	///<summary>
+	///Welds count packed xyz points: remap[i] is the unique id of point i, ids
+	///numbered in order of first occurrence. Fills firsts with the input index of
+	///every unique point and returns their count.
+	///</summary>
+	size_t MeshWeld_weld(const double *xyz, size_t count, double tolerance, std::vector<uint32_t> &remap, std::vector<uint32_t> &firsts);
+
+	inline double MeshWeld_coord(const Vertex &p, int k) { return (&p.x)[k]; }
+
+	// glm::vec3 and FDMathCore::Point<T, 3>
+	template<typename P>
+	double MeshWeld_coord(const P &p, int k) { return static_cast<double>(p[k]); }
+}
+
+
+///<summary>
+///Merges the points closer than tolerance (exact duplicates when it is 0) and
+///returns the unique ones, in order of first occurrence. remap maps every input
+///index to its index in the returned array. Points chained within tolerance of
+///each other are merged together, even when the ends of the chain are further
+///apart. Works on Vertex, glm::vec3 and any 3D point type with operator[], such
+///as FDMathCore::Point<T, 3>.
+///</summary>
+template<typename P>
+std::vector<P> weldPoints(const std::vector<P> &points, double tolerance, std::vector<uint32_t> &remap)
+{
+	using namespace meshweld_internal;
+
+	std::vector<double> xyz(points.size() * 3);
+	parallel::parallelFor(0, points.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+				xyz[i * 3 + k] = MeshWeld_coord(points[i], k);
+		}
+	});
+
+	std::vector<uint32_t> firsts;
+	MeshWeld_weld(xyz.data(), points.size(), tolerance, remap, firsts);
+
+	std::vector<P> ret;
+	ret.reserve(firsts.size());
+	for (auto it = firsts.begin(); it != firsts.end(); ++it)
+		ret.push_back(points[*it]);
+	return ret;
+}
+
+
+///<summary>
+///Welds the vertices of mesh and rebuilds its edges and faces with buildMesh.
+///Repeated vertices in a face loop collapse, and faces left with less than 3
+///vertices are dropped. vertex_remap, if given, maps old vertex ids to new ones.
+///</summary>
+void weldMesh(Mesh &mesh, double tolerance, std::vector<uint32_t> *vertex_remap = nullptr);
+
+///<summary>
+///Welds the vertices of mesh, remaps its indices and drops the triangles that
+///became degenerate. Normals are kept from the first vertex of every group.
+///Lines whose ends were welded together are dropped, and lines that became
+///the same edge are kept once.
+///</summary>
+void weldMesh(RenderableMesh &mesh, double tolerance, std::vector<uint32_t> *vertex_remap = nullptr);
@@ -0,0 +1,329 @@
+#include "Meshlet.h"
+
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+
+#include "Parallel.h"
+#include "VertexCache.h"
+
+
+namespace meshlet_internal
+{
+	glm::vec3 Meshlet_position(const RenderableMesh &mesh, uint32_t v)
+	{
+		return glm::vec3(mesh.vertices[v * 3], mesh.vertices[v * 3 + 1], mesh.vertices[v * 3 + 2]);
+	}
+}
+
+
+void meshlet_internal::Meshlet_compute_bounds(const RenderableMesh &mesh, const MeshletMesh &meshlets, Meshlet &m)
+{
+	const uint32_t *ids = meshlets.vertices.data() + m.vertex_offset;
+	const uint8_t *tris = meshlets.triangles.data() + m.triangle_offset * 3;
+
+	glm::vec3 center(0.0f);
+	for (uint32_t i = 0; i < m.vertex_count; ++i)
+		center += Meshlet_position(mesh, ids[i]);
+	center /= static_cast<float>(m.vertex_count);
+
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < m.vertex_count; ++i)
+		radius = std::max(radius, glm::length(Meshlet_position(mesh, ids[i]) - center));
+
+	m.center = center;
+	m.radius = radius;
+
+	std::vector<glm::vec3> normals;
+	normals.reserve(m.triangle_count);
+	glm::vec3 axis(0.0f);
+	for (uint32_t t = 0; t < m.triangle_count; ++t)
+	{
+		glm::vec3 a = Meshlet_position(mesh, ids[tris[t * 3]]), b = Meshlet_position(mesh, ids[tris[t * 3 + 1]]), c = Meshlet_position(mesh, ids[tris[t * 3 + 2]]);
+		glm::vec3 n = glm::cross(b - a, c - a);
+		float l = glm::length(n);
+		if (l <= 0.0f)
+			continue;
+		normals.push_back(n / l);
+		axis += normals.back();
+	}
+
+	float l = glm::length(axis);
+	m.cone_axis = l > 0.0f ? axis / l : glm::vec3(0.0f, 0.0f, 1.0f);
+	m.cone_cutoff = 1.0f;
+	if (l <= 0.0f)
+		return;
+
+	float min_dot = 1.0f;
+	for (auto it = normals.begin(); it != normals.end(); ++it)
+		min_dot = std::min(min_dot, glm::dot(*it, m.cone_axis));
+
+	if (min_dot > 0.0f)
+		m.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+}
+
+void meshlet_internal::Meshlet_assign_lines(const RenderableMesh &mesh, const std::vector<uint32_t> &indices, const vertexcache_internal::VertexTriangles &adj, const std::vector<uint32_t> &triangle_meshlets, MeshletMesh &meshlets)
+{
+	const size_t nb_lines = mesh.lineIndexCount() / 2;
+	const uint32_t nb_meshlets = static_cast<uint32_t>(meshlets.meshlets.size());
+
+	// Meshlet of the first triangle around a holding b, nb_meshlets for edges of no triangle
+	std::vector<uint32_t> line_meshlets(nb_lines);
+	parallel::parallelFor(0, nb_lines, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t l = first; l < last; ++l)
+		{
+			const uint32_t a = mesh.getLineIndex(l * 2), b = mesh.getLineIndex(l * 2 + 1);
+			uint32_t found = nb_meshlets;
+			for (uint32_t i = adj.offsets[a]; i < adj.offsets[a + 1] && found == nb_meshlets; ++i)
+			{
+				const uint32_t t = adj.triangles[i];
+				if (indices[t * 3] == b || indices[t * 3 + 1] == b || indices[t * 3 + 2] == b)
+					found = triangle_meshlets[t];
+			}
+			line_meshlets[l] = found;
+		}
+	});
+
+	std::vector<uint32_t> offsets(nb_meshlets + 2, 0);
+	for (size_t l = 0; l < nb_lines; ++l)
+		++offsets[line_meshlets[l] + 1];
+	for (uint32_t m = 0; m <= nb_meshlets; ++m)
+		offsets[m + 1] += offsets[m];
+
+	for (uint32_t m = 0; m < nb_meshlets; ++m)
+	{
+		meshlets.meshlets[m].line_offset = offsets[m];
+		meshlets.meshlets[m].line_count = offsets[m + 1] - offsets[m];
+	}
+
+	// Counting sort, lines keep their order inside a meshlet
+	meshlets.lines.resize(nb_lines * 2);
+	for (size_t l = 0; l < nb_lines; ++l)
+	{
+		const uint32_t to = offsets[line_meshlets[l]]++;
+		meshlets.lines[to * 2] = mesh.getLineIndex(l * 2);
+		meshlets.lines[to * 2 + 1] = mesh.getLineIndex(l * 2 + 1);
+	}
+}
+
+void meshlet_internal::Meshlet_frustum_planes(const glm::mat4 &mvp, glm::vec4 *planes)
+{
+	// Rows of the matrix, glm being column major
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		planes[i * 2] = rows[3] + rows[i];
+		planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+
+	for (int i = 0; i < 6; ++i)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+
+MeshletMesh buildMeshlets(const RenderableMesh &mesh, size_t max_vertices, size_t max_triangles)
+{
+	using namespace meshlet_internal;
+
+	if (max_vertices < 3 || max_vertices > 256 || max_triangles < 1)
+		throw std::invalid_argument("Meshlets need between 3 and 256 vertices and at least one triangle.");
+
+	const std::vector<uint32_t> indices = vertexcache_internal::VertexCache_read_indices(mesh);
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	const size_t nb_triangles = indices.size() / 3;
+	const vertexcache_internal::VertexTriangles adj = vertexcache_internal::VertexCache_adjacency(indices, nb_vertices);
+
+	std::vector<glm::vec3> centroids(nb_triangles);
+	parallel::parallelFor(0, nb_triangles, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t t = first; t < last; ++t)
+			centroids[t] = (Meshlet_position(mesh, indices[t * 3]) + Meshlet_position(mesh, indices[t * 3 + 1]) + Meshlet_position(mesh, indices[t * 3 + 2])) / 3.0f;
+	});
+
+	MeshletMesh ret;
+	ret.triangles.reserve(indices.size());
+
+	std::vector<char> emitted(nb_triangles, 0);
+	std::vector<uint32_t> triangle_meshlets(nb_triangles);
+	std::vector<uint32_t> live(nb_vertices); // triangles not in a meshlet yet, per vertex
+	for (size_t v = 0; v < nb_vertices; ++v)
+		live[v] = adj.offsets[v + 1] - adj.offsets[v];
+	std::vector<int> local(nb_vertices, -1); // vertex id in the meshlet being built
+	std::vector<uint32_t> candidates;
+	glm::vec3 centroid_sum(0.0f);
+	size_t seed = 0;
+
+	Meshlet current = Meshlet();
+
+	auto addTriangle = [&](uint32_t t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = indices[t * 3 + k];
+			if (local[v] < 0)
+			{
+				local[v] = static_cast<int>(current.vertex_count++);
+				ret.vertices.push_back(v);
+				for (uint32_t a = adj.offsets[v]; a < adj.offsets[v + 1]; ++a)
+				{
+					if (!emitted[adj.triangles[a]])
+						candidates.push_back(adj.triangles[a]);
+				}
+			}
+			ret.triangles.push_back(static_cast<uint8_t>(local[v]));
+			--live[v];
+		}
+
+		emitted[t] = 1;
+		triangle_meshlets[t] = static_cast<uint32_t>(ret.meshlets.size());
+		++current.triangle_count;
+		centroid_sum += centroids[t];
+	};
+
+	auto flush = [&]()
+	{
+		for (uint32_t i = 0; i < current.vertex_count; ++i)
+			local[ret.vertices[current.vertex_offset + i]] = -1;
+
+		ret.meshlets.push_back(current);
+		current = Meshlet();
+		current.vertex_offset = static_cast<uint32_t>(ret.vertices.size());
+		current.triangle_offset = static_cast<uint32_t>(ret.triangles.size() / 3);
+		centroid_sum = glm::vec3(0.0f);
+		candidates.clear();
+	};
+
+	for (;;)
+	{
+		int64_t best = -1;
+		if (current.triangle_count < max_triangles && current.triangle_count > 0)
+		{
+			// Fewest new vertices first, then the triangles that would otherwise be
+			// left isolated (vertices with few live triangles), then the closest
+			const glm::vec3 center = centroid_sum / static_cast<float>(current.triangle_count);
+			uint32_t best_new = 4, best_live = std::numeric_limits<uint32_t>::max();
+			float best_distance = std::numeric_limits<float>::max();
+
+			size_t kept = 0;
+			for (size_t i = 0; i < candidates.size(); ++i)
+			{
+				uint32_t t = candidates[i];
+				if (emitted[t])
+					continue;
+				candidates[kept++] = t;
+
+				uint32_t added = (local[indices[t * 3]] < 0) + (local[indices[t * 3 + 1]] < 0) + (local[indices[t * 3 + 2]] < 0);
+				if (current.vertex_count + added > max_vertices)
+					continue;
+
+				uint32_t min_live = std::min(live[indices[t * 3]], std::min(live[indices[t * 3 + 1]], live[indices[t * 3 + 2]]));
+				glm::vec3 d = centroids[t] - center;
+				float distance = glm::dot(d, d);
+				if (added < best_new || (added == best_new && (min_live < best_live || (min_live == best_live && distance < best_distance))))
+				{
+					best = t;
+					best_new = added;
+					best_live = min_live;
+					best_distance = distance;
+				}
+			}
+			candidates.resize(kept);
+		}
+
+		if (best < 0)
+		{
+			if (current.triangle_count > 0)
+				flush();
+
+			while (seed < nb_triangles && emitted[seed])
+				++seed;
+			if (seed == nb_triangles)
+				break;
+			best = static_cast<int64_t>(seed);
+		}
+
+		addTriangle(static_cast<uint32_t>(best));
+	}
+
+	parallel::parallelFor(0, ret.meshlets.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+			Meshlet_compute_bounds(mesh, ret, ret.meshlets[i]);
+	}, 256);
+
+	Meshlet_assign_lines(mesh, indices, adj, triangle_meshlets, ret);
+
+	return ret;
+}
+
+
+void applyMeshletOrder(RenderableMesh &mesh, const MeshletMesh &meshlets)
+{
+	std::vector<uint32_t> indices(meshlets.triangles.size());
+	parallel::parallelFor(0, meshlets.meshlets.size(), [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			const Meshlet &m = meshlets.meshlets[i];
+			for (uint32_t j = m.triangle_offset * 3; j < (m.triangle_offset + m.triangle_count) * 3; ++j)
+				indices[j] = meshlets.vertices[m.vertex_offset + meshlets.triangles[j]];
+		}
+	}, 256);
+
+	vertexcache_internal::VertexCache_write_indices(mesh, indices);
+
+	// Meshlets built before the lines were, the line buffer is left as is
+	if (meshlets.lines.size() != mesh.lineIndexCount())
+		return;
+
+	if (mesh.hasWideLines())
+		mesh.lines32 = meshlets.lines;
+	else
+	{
+		for (size_t i = 0; i < meshlets.lines.size(); ++i)
+			mesh.lines[i] = static_cast<uint16_t>(meshlets.lines[i]);
+	}
+}
+
+
+size_t cullMeshlets(const MeshletMesh &meshlets, const glm::mat4 &mvp, const glm::vec3 &camera, std::vector<uint32_t> &visible, bool cull_backfacing)
+{
+	glm::vec4 planes[6];
+	meshlet_internal::Meshlet_frustum_planes(mvp, planes);
+
+	const size_t nb_meshlets = meshlets.meshlets.size();
+	const size_t grain = 1024;
+	std::vector<std::vector<uint32_t>> blocks(parallel::blockCount(nb_meshlets, grain));
+
+	parallel::parallelFor(0, nb_meshlets, [&](size_t first, size_t last, unsigned int block)
+	{
+		std::vector<uint32_t> &out = blocks[block];
+		for (size_t i = first; i < last; ++i)
+		{
+			const Meshlet &m = meshlets.meshlets[i];
+
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+				inside = glm::dot(glm::vec3(planes[p]), m.center) + planes[p].w >= -m.radius;
+			if (!inside)
+				continue;
+
+			// Back facing when the view direction is within the cone's complement for the whole sphere
+			glm::vec3 view = m.center - camera;
+			if (cull_backfacing && glm::dot(view, m.cone_axis) >= m.cone_cutoff * glm::length(view) + m.radius)
+				continue;
+
+			out.push_back(static_cast<uint32_t>(i));
+		}
+	}, grain);
+
+	visible.clear();
+	for (auto it = blocks.begin(); it != blocks.end(); ++it)
+		visible.insert(visible.end(), it->begin(), it->end());
+
+	return visible.size();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+#include "VertexCache.h"
+
+
+// Clusters of neighbouring triangles with their bounds, so whole groups can be
+// culled on the CPU before issuing draws.
+
+struct Meshlet
+{
+	uint32_t vertex_offset; // in MeshletMesh::vertices
+	uint32_t triangle_offset; // in triangles, MeshletMesh::triangles holds 3 local indices per triangle
+	uint32_t vertex_count;
+	uint32_t triangle_count;
+	uint32_t line_offset; // in lines, RenderableMesh lines holds 2 indices per line
+	uint32_t line_count;
+
+	// Bounding sphere
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone: cone_cutoff is the sine of its half angle, or 1 when the
+	// normals spread over more than a hemisphere and the meshlet is never back facing.
+	glm::vec3 cone_axis;
+	float cone_cutoff;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> vertices; // RenderableMesh vertex ids used by each meshlet
+	std::vector<uint8_t> triangles; // indices into the meshlet's vertices
+	// RenderableMesh vertex ids, 2 per line, grouped by meshlet: each edge goes to
+	// the meshlet of one of its triangles, edges of no triangle come last
+	std::vector<uint32_t> lines;
+};
+
+
+namespace meshlet_internal
+{
+	void Meshlet_compute_bounds(const RenderableMesh &mesh, const MeshletMesh &meshlets, Meshlet &m);
+
+	// Fills meshlets.lines and the line ranges from the meshlet of every triangle
+	void Meshlet_assign_lines(const RenderableMesh &mesh, const std::vector<uint32_t> &indices, const vertexcache_internal::VertexTriangles &adj, const std::vector<uint32_t> &triangle_meshlets, MeshletMesh &meshlets);
+
+	// Planes of the view frustum in the space mvp maps from, model space for a full
+	// model-view-projection, xyz normal pointing inside, w distance
+	void Meshlet_frustum_planes(const glm::mat4 &mvp, glm::vec4 *planes);
+}
+
+
+///<summary>
+///Splits the triangles of a RenderableMesh into meshlets of at most max_vertices
+///(up to 256) vertices and max_triangles triangles. Meshlets are grown greedily
+///from a seed triangle through shared vertices, preferring triangles that add
+///the fewest new vertices, then the closest ones. Running optimizeVertexCache
+///first gives better seeds. Throws std::invalid_argument on bad limits.
+///</summary>
+MeshletMesh buildMeshlets(const RenderableMesh &mesh, size_t max_vertices = 64, size_t max_triangles = 124);
+
+///<summary>
+///Rewrites the index buffer of mesh in meshlet order, so that the triangles of
+///meshlet i start at index meshlets[i].triangle_offset * 3, and the line buffer
+///so that its lines start at line index meshlets[i].line_offset * 2.
+///</summary>
+void applyMeshletOrder(RenderableMesh &mesh, const MeshletMesh &meshlets);
+
+///<summary>
+///Fills visible with the ids of the meshlets that intersect the frustum of mvp
+///and, when cull_backfacing is set, have at least one triangle facing camera.
+///Lines have no facing: a meshlet's edges are shared with back facing
+///neighbours, so line draws cull with the frustum only. Returns visible.size().
+///</summary>
+size_t cullMeshlets(const MeshletMesh &meshlets, const glm::mat4 &mvp, const glm::vec3 &camera, std::vector<uint32_t> &visible, bool cull_backfacing = true);
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace parallel
+{
+	inline unsigned int threadCount()
+	{
+		unsigned int n = std::thread::hardware_concurrency();
+		return n == 0 ? 1 : n;
+	}
+
+
+	// Splits [begin, end) into one contiguous block per thread and calls
+	// fn(block_begin, block_end, block_id) for each of them. Ranges smaller than
+	// grain run on the calling thread.
+	template<typename F>
+	void parallelFor(size_t begin, size_t end, F fn, size_t grain = 4096)
+	{
+		if (end <= begin)
+			return;
+
+		size_t n = end - begin;
+		size_t nb_blocks = std::min<size_t>(threadCount(), (n + grain - 1) / grain);
+		if (nb_blocks <= 1)
+		{
+			fn(begin, end, 0u);
+			return;
+		}
+
+		size_t block_size = (n + nb_blocks - 1) / nb_blocks;
+		std::vector<std::thread> threads;
+		threads.reserve(nb_blocks - 1);
+		for (size_t b = 1; b < nb_blocks; ++b)
+		{
+			size_t first = begin + b * block_size;
+			size_t last = std::min(end, first + block_size);
+			if (first >= last)
+				break;
+			threads.emplace_back(fn, first, last, static_cast<unsigned int>(b));
+		}
+
+		fn(begin, std::min(end, begin + block_size), 0u);
+
+		for (auto it = threads.begin(); it != threads.end(); ++it)
+			it->join();
+	}
+
+
+	// Number of blocks parallelFor will use for a range, so callers can size
+	// per-block scratch buffers up front.
+	inline size_t blockCount(size_t n, size_t grain = 4096)
+	{
+		if (n == 0)
+			return 0;
+		return std::max<size_t>(1, std::min<size_t>(threadCount(), (n + grain - 1) / grain));
+	}
+
+
+	// Stable LSD radix sort of 64-bit keys carrying a 32-bit payload. Byte passes
+	// where every key shares the same digit are skipped, so small key ranges
+	// (vertex ids, quantized positions) only pay for the bytes they use.
+	inline void radixSort(std::vector<uint64_t> &keys, std::vector<uint32_t> &values)
+	{
+		const size_t n = keys.size();
+		if (n < 2)
+			return;
+
+		const size_t grain = 1 << 14;
+		const size_t nb_blocks = blockCount(n, grain);
+
+		std::vector<uint64_t> keys_tmp(n);
+		std::vector<uint32_t> values_tmp(n);
+		std::vector<size_t> histograms(nb_blocks * 256);
+
+		for (unsigned int shift = 0; shift < 64; shift += 8)
+		{
+			std::fill(histograms.begin(), histograms.end(), 0);
+
+			parallelFor(0, n, [&](size_t first, size_t last, unsigned int block)
+			{
+				size_t *h = &histograms[block * 256];
+				for (size_t i = first; i < last; ++i)
+					++h[(keys[i] >> shift) & 0xFF];
+			}, grain);
+
+			// Skip the pass if every key falls in the same bucket
+			bool trivial = false;
+			for (size_t d = 0; d < 256 && !trivial; ++d)
+			{
+				size_t total = 0;
+				for (size_t b = 0; b < nb_blocks; ++b)
+					total += histograms[b * 256 + d];
+				if (total == n)
+					trivial = true;
+				else if (total != 0)
+					break;
+			}
+			if (trivial)
+				continue;
+
+			// Exclusive prefix sum, digit-major then block-major, keeps the sort stable
+			size_t offset = 0;
+			for (size_t d = 0; d < 256; ++d)
+			{
+				for (size_t b = 0; b < nb_blocks; ++b)
+				{
+					size_t count = histograms[b * 256 + d];
+					histograms[b * 256 + d] = offset;
+					offset += count;
+				}
+			}
+
+			parallelFor(0, n, [&](size_t first, size_t last, unsigned int block)
+			{
+				size_t *h = &histograms[block * 256];
+				for (size_t i = first; i < last; ++i)
+				{
+					size_t dst = h[(keys[i] >> shift) & 0xFF]++;
+					keys_tmp[dst] = keys[i];
+					values_tmp[dst] = values[i];
+				}
+			}, grain);
+
+			keys.swap(keys_tmp);
+			values.swap(values_tmp);
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <type_traits>
+
+#include <glm.hpp>
+
+#include "MeshUtils.h"
+#include "MeshView.h"
+
+
+// Vertex, glm::vec3 and FDMathCore::Point<float, 3> all store three packed
+// floats. The asserts below pin that down, so arrays of one can be read as
+// arrays of another through an ArrayView instead of being copied point by point.
+
+///<summary>
+///True for the types laid out as three packed floats x, y, z.
+///</summary>
+template<typename T>
+struct IsPackedPoint3f : std::false_type {};
+
+template<> struct IsPackedPoint3f<Vertex> : std::true_type {};
+template<> struct IsPackedPoint3f<glm::vec3> : std::true_type {};
+
+static_assert(sizeof(Vertex) == 3 * sizeof(float) && std::is_standard_layout<Vertex>::value, "Vertex must be 3 packed floats");
+static_assert(offsetof(Vertex, x) == 0 && offsetof(Vertex, y) == sizeof(float) && offsetof(Vertex, z) == 2 * sizeof(float), "Vertex must store x, y, z in order");
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && std::is_standard_layout<glm::vec3>::value, "glm::vec3 must be 3 packed floats");
+static_assert(alignof(Vertex) == alignof(float) && alignof(glm::vec3) == alignof(float), "Point types must align like float");
+
+// FDMathCore lives in the Racoons project, its Point is only checked when
+// Point.h was included before this header
+#ifdef POINT_H
+template<> struct IsPackedPoint3f<FDMathCore::Point<float, 3>> : std::true_type {};
+
+static_assert(sizeof(FDMathCore::Point<float, 3>) == 3 * sizeof(float) && std::is_standard_layout<FDMathCore::Point<float, 3>>::value, "FDMathCore::Point<float, 3> must be 3 packed floats");
+#endif
+
+
+///<summary>
+///Reads an array of one packed point type as another one, without copying.
+///The view is only valid as long as the source array is.
+///</summary>
+template<typename To, typename From>
+ArrayView<To> viewPoints(ArrayView<From> points)
+{
+	static_assert(IsPackedPoint3f<To>::value && IsPackedPoint3f<From>::value, "viewPoints needs packed 3 float point types");
+	return ArrayView<To>(reinterpret_cast<const To *>(points.data()), points.size());
+}
+
+template<typename To, typename From>
+ArrayView<To> viewPoints(const std::vector<From> &points)
+{
+	return viewPoints<To>(ArrayView<From>(points));
+}
+
+///<summary>
+///Packed xyz floats, such as RenderableMesh::vertices, read as points.
+///</summary>
+template<typename To>
+ArrayView<To> viewPoints(const std::vector<float> &xyz)
+{
+	static_assert(IsPackedPoint3f<To>::value, "viewPoints needs a packed 3 float point type");
+	return ArrayView<To>(reinterpret_cast<const To *>(xyz.data()), xyz.size() / 3);
+}
+
+///<summary>
+///Points read as packed xyz floats, 3 per point, ready for glBufferData.
+///</summary>
+template<typename From>
+ArrayView<float> viewFloats(const std::vector<From> &points)
+{
+	static_assert(IsPackedPoint3f<From>::value, "viewFloats needs a packed 3 float point type");
+	return ArrayView<float>(reinterpret_cast<const float *>(points.data()), points.size() * 3);
+}
+
+
+///<summary>
+///Copies between point arrays of different types. The layouts match, so this
+///is one memcpy rather than a conversion per point.
+///</summary>
+template<typename To, typename From>
+void copyPoints(const std::vector<From> &from, std::vector<To> &to)
+{
+	ArrayView<To> view = viewPoints<To>(from);
+	to.assign(view.begin(), view.end());
+}
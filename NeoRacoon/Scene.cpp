@@ -41,6 +41,7 @@ void Scene::Initialize ( )
 
 	program = LoadShaders ( "..\\shaders\\basic.vs" , "..\\shaders\\basic.fs" );
 	position_location = glGetAttribLocation ( program , "vertexPosition_modelspace" );
+	occlusion_location = glGetAttribLocation ( program , "vertexOcclusion" );
 	mvp_location = glGetUniformLocation ( program , "MVP" );
 	color_location = glGetUniformLocation ( program , "vertexColor" );
 
@@ -50,7 +51,7 @@ void Scene::Initialize ( )
 	glBindBuffer ( GL_ARRAY_BUFFER , vertexBufferPoints );
 	glBufferData ( GL_ARRAY_BUFFER , sizeof ( glm::vec3 ) * vertices.size ( ) , vertices.data ( ) , GL_STATIC_DRAW );
 	glEnableVertexAttribArray ( position_location );
-	glVertexAttribPointer ( 0 , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	glVertexAttribPointer ( position_location , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
 	glBindVertexArray ( 0 );
 
 	glGenVertexArrays ( 1 , &originShapeVertexArrayID );
@@ -59,7 +60,7 @@ void Scene::Initialize ( )
 	glBindBuffer ( GL_ARRAY_BUFFER , originShapeVertexBuffer );
 	glBufferData ( GL_ARRAY_BUFFER , sizeof ( glm::vec3 ) * originShapeVertices.size ( ) , originShapeVertices.data ( ) , GL_STATIC_DRAW );
 	glEnableVertexAttribArray ( position_location );
-	glVertexAttribPointer ( 0 , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	glVertexAttribPointer ( position_location , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
 	glBindVertexArray ( 0 );
 
 
@@ -67,10 +68,40 @@ void Scene::Initialize ( )
 	glBindVertexArray ( catMullVertexArrayID );
 	glGenBuffers ( 1 , &catmullVertexBuffer );
 	glBindBuffer ( GL_ARRAY_BUFFER , catmullVertexBuffer );
-	glBufferData ( GL_ARRAY_BUFFER , sizeof ( glm::vec3 ) * catmullVertices.size ( ) , catmullVertices.data ( ) , GL_STATIC_DRAW );
+	glBufferData ( GL_ARRAY_BUFFER , sizeof ( float ) * catmullMesh.vertices.size ( ) , catmullMesh.vertices.data ( ) , GL_STATIC_DRAW );
 	glEnableVertexAttribArray ( position_location );
-	glVertexAttribPointer ( 0 , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	glVertexAttribPointer ( position_location , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	glGenBuffers ( 1 , &catmullOcclusionBuffer );
+	glBindBuffer ( GL_ARRAY_BUFFER , catmullOcclusionBuffer );
+	glBufferData ( GL_ARRAY_BUFFER , sizeof ( float ) * catmullMesh.occlusion.size ( ) , catmullMesh.occlusion.data ( ) , GL_STATIC_DRAW );
+	if ( occlusion_location >= 0 )
+	{
+		glEnableVertexAttribArray ( occlusion_location );
+		glVertexAttribPointer ( occlusion_location , 1 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	}
+	//The element buffer binding is part of the VAO state
+	glGenBuffers ( 1 , &catmullIndexBuffer );
+	glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER , catmullIndexBuffer );
+	glBindVertexArray ( 0 );
+
+	//A VAO holds a single element buffer, the wireframe gets its own over the same vertex buffers
+	glGenVertexArrays ( 1 , &catMullLinesVertexArrayID );
+	glBindVertexArray ( catMullLinesVertexArrayID );
+	glBindBuffer ( GL_ARRAY_BUFFER , catmullVertexBuffer );
+	glEnableVertexAttribArray ( position_location );
+	glVertexAttribPointer ( position_location , 3 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	glBindBuffer ( GL_ARRAY_BUFFER , catmullOcclusionBuffer );
+	if ( occlusion_location >= 0 )
+	{
+		glEnableVertexAttribArray ( occlusion_location );
+		glVertexAttribPointer ( occlusion_location , 1 , GL_FLOAT , GL_FALSE , 0 , ( void* ) 0 );
+	}
+	glGenBuffers ( 1 , &catmullLineBuffer );
+	glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER , catmullLineBuffer );
 	glBindVertexArray ( 0 );
+	//VAOs without an occlusion array read this constant, fully lit
+	if ( occlusion_location >= 0 )
+		glVertexAttrib1f ( occlusion_location , 1.0f );
 
 	lastTime = glfwGetTime ( );
 
@@ -99,7 +130,25 @@ void Scene::UpdateBuffers ( )
 	glBufferData ( GL_ARRAY_BUFFER , originShapeVertices.size ( ) * sizeof ( glm::vec3 ) , originShapeVertices.data ( ) , GL_STATIC_DRAW );
 
 	glBindBuffer ( GL_ARRAY_BUFFER , catmullVertexBuffer );
-	glBufferData ( GL_ARRAY_BUFFER , catmullVertices.size ( ) * sizeof ( glm::vec3 ) , catmullVertices.data ( ) , GL_STATIC_DRAW );
+	glBufferData ( GL_ARRAY_BUFFER , catmullMesh.vertices.size ( ) * sizeof ( float ) , catmullMesh.vertices.data ( ) , GL_STATIC_DRAW );
+
+	glBindBuffer ( GL_ARRAY_BUFFER , catmullOcclusionBuffer );
+	glBufferData ( GL_ARRAY_BUFFER , catmullMesh.occlusion.size ( ) * sizeof ( float ) , catmullMesh.occlusion.data ( ) , GL_STATIC_DRAW );
+
+	glBindVertexArray ( catMullVertexArrayID );
+	glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER , catmullIndexBuffer );
+	if ( catmullMesh.hasWideIndices ( ) )
+		glBufferData ( GL_ELEMENT_ARRAY_BUFFER , catmullMesh.indices32.size ( ) * sizeof ( uint32_t ) , catmullMesh.indices32.data ( ) , GL_STATIC_DRAW );
+	else
+		glBufferData ( GL_ELEMENT_ARRAY_BUFFER , catmullMesh.indices.size ( ) * sizeof ( uint16_t ) , catmullMesh.indices.data ( ) , GL_STATIC_DRAW );
+
+	glBindVertexArray ( catMullLinesVertexArrayID );
+	glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER , catmullLineBuffer );
+	if ( catmullMesh.hasWideLines ( ) )
+		glBufferData ( GL_ELEMENT_ARRAY_BUFFER , catmullMesh.lines32.size ( ) * sizeof ( uint32_t ) , catmullMesh.lines32.data ( ) , GL_STATIC_DRAW );
+	else
+		glBufferData ( GL_ELEMENT_ARRAY_BUFFER , catmullMesh.lines.size ( ) * sizeof ( uint16_t ) , catmullMesh.lines.data ( ) , GL_STATIC_DRAW );
+	glBindVertexArray ( 0 );
 
 }
 
@@ -212,7 +261,7 @@ void Scene::AddLine ( )
 {
 }
 
-void Scene::AddOriginCornerCutPoints ( std::vector<glm::vec3> v )
+void Scene::AddOriginCornerCutPoints ( const std::vector<glm::vec3> &v )
 {
 	originShapeVertices.insert ( originShapeVertices.end ( ) , v.begin ( ) , v.end ( ) );
 	UpdateBuffers ( );
@@ -220,26 +269,33 @@ void Scene::AddOriginCornerCutPoints ( std::vector<glm::vec3> v )
 
 void Scene::AddCatMullShape (int iter )
 {
-	RenderableMesh mesh = testCatMull ( iter );
-	catmullVertices = mesh.toVec3 ( );
-
-	UpdateBuffers ( );
+	SetSubdividedShape ( testCatMull ( iter , subdivisionArenas[0] , subdivisionArenas[1] ) );
 }
 
 void Scene::AddLoopShape ( int iter )
 {
-	RenderableMesh mesh = testLoops ( iter);
-	catmullVertices = mesh.toVec3 ( );
-
-	UpdateBuffers ( );
+	SetSubdividedShape ( testLoops ( iter , subdivisionArenas[0] , subdivisionArenas[1] ) );
 }
 
 void Scene::AddKobbeltShape(int iter )
 {
-	RenderableMesh mesh = testKobbelt(iter );
-	catmullVertices = mesh.toVec3();
+	SetSubdividedShape ( testKobbelt ( iter , subdivisionArenas[0] , subdivisionArenas[1] ) );
+}
+
+void Scene::SetSubdividedShape ( const RenderableMesh &mesh )
+{
+	catmullMesh = mesh;
 
-	UpdateBuffers();
+	catmullRawCacheStats = analyzeVertexCache ( catmullMesh );
+	optimizeVertexCache ( catmullMesh );
+	optimizeVertexFetch ( catmullMesh );
+	catmullMeshlets = buildMeshlets ( catmullMesh );
+	applyMeshletOrder ( catmullMesh , catmullMeshlets );
+	catmullCacheStats = analyzeVertexCache ( catmullMesh );
+	//Baked on the final vertex order, once per shape instead of every frame
+	bakeAmbientOcclusion ( catmullMesh , catmullOcclusionOptions );
+
+	UpdateBuffers ( );
 }
 
 
@@ -265,12 +321,73 @@ void Scene::GeometryPass ( )
 	glProgramUniform4fv ( program , color_location , 1 , catmullFragmentColor );
 	glBindVertexArray ( catMullVertexArrayID );
 	glPointSize ( 3 );
-	glDrawArrays ( GL_POINTS , 0 , catmullVertices.size ( ) );
-	glDrawArrays ( GL_LINES , 0 , catmullVertices.size ( ) );
+	glDrawArrays ( GL_POINTS , 0 , catmullMesh.vertices.size ( ) / 3 );
+	DrawVisibleMeshlets ( );
 
 	glBindVertexArray ( 0 );
 }
 
+void Scene::DrawVisibleMeshlets ( )
+{
+	//The unique edges of the visible meshlets when there are, every edge once and
+	//no fan diagonals, otherwise their triangles drawn as wireframe
+	const bool lines = catmullMesh.lineIndexCount ( ) > 0 && catmullMeshlets.lines.size ( ) == catmullMesh.lineIndexCount ( );
+
+	//Camera position in model space for the normal cone test. Each edge is stored in
+	//one meshlet only, so lines skip the test: a silhouette edge owned by a back
+	//facing meshlet would be lost while its front facing neighbour is drawn
+	glm::vec3 camera = glm::vec3 ( glm::inverse ( view * model ) [ 3 ] );
+	cullMeshlets ( catmullMeshlets , mvp , camera , visibleMeshlets , !lines );
+	const size_t perPrimitive = lines ? 2 : 3;
+	const size_t indexSize = ( lines ? catmullMesh.hasWideLines ( ) : catmullMesh.hasWideIndices ( ) ) ? sizeof ( uint32_t ) : sizeof ( uint16_t );
+
+	//Meshlets are contiguous in the index buffer, neighbouring visible ones are merged in one range
+	drawCounts.clear ( );
+	drawOffsets.clear ( );
+	size_t rangeEnd = 0;
+	auto addRange = [&] ( size_t first , size_t count )
+	{
+		if ( count == 0 )
+			return;
+		if ( !drawCounts.empty ( ) && first == rangeEnd )
+			drawCounts.back ( ) += static_cast<GLsizei>( count );
+		else
+		{
+			drawCounts.push_back ( static_cast<GLsizei>( count ) );
+			drawOffsets.push_back ( ( const GLvoid* ) ( first * indexSize ) );
+		}
+		rangeEnd = first + count;
+	};
+	for ( auto it = visibleMeshlets.begin ( ); it != visibleMeshlets.end ( ); ++it )
+	{
+		const Meshlet &m = catmullMeshlets.meshlets [ *it ];
+		if ( lines )
+			addRange ( m.line_offset * perPrimitive , m.line_count * perPrimitive );
+		else
+			addRange ( m.triangle_offset * perPrimitive , m.triangle_count * perPrimitive );
+	}
+
+	if ( lines )
+	{
+		//Edges of no triangle follow the last meshlet and are always drawn
+		size_t culled = 0;
+		if ( !catmullMeshlets.meshlets.empty ( ) )
+			culled = ( catmullMeshlets.meshlets.back ( ).line_offset + catmullMeshlets.meshlets.back ( ).line_count ) * perPrimitive;
+		addRange ( culled , catmullMesh.lineIndexCount ( ) - culled );
+
+		glBindVertexArray ( catMullLinesVertexArrayID );
+		if ( !drawCounts.empty ( ) )
+			glMultiDrawElements ( GL_LINES , drawCounts.data ( ) , catmullMesh.hasWideLines ( ) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT , drawOffsets.data ( ) , static_cast<GLsizei>( drawCounts.size ( ) ) );
+	}
+	else
+	{
+		glPolygonMode ( GL_FRONT_AND_BACK , GL_LINE );
+		if ( !drawCounts.empty ( ) )
+			glMultiDrawElements ( GL_TRIANGLES , drawCounts.data ( ) , catmullMesh.hasWideIndices ( ) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT , drawOffsets.data ( ) , static_cast<GLsizei>( drawCounts.size ( ) ) );
+		glPolygonMode ( GL_FRONT_AND_BACK , GL_FILL );
+	}
+}
+
 float Scene::RandomFloat ( float a , float b )
 {
 	float random = ( ( float ) rand ( ) ) / ( float ) RAND_MAX;
@@ -284,7 +401,10 @@ void Scene::resetScene ( )
 	normals.clear ( );
 	positions.clear ( );
 	vertices.clear ( );
-	catmullVertices.clear ( );
+	catmullMesh = RenderableMesh ( );
+	catmullRawCacheStats = catmullCacheStats = VertexCacheStats ( );
+	catmullMeshlets = MeshletMesh ( );
+	visibleMeshlets.clear ( );
 	originShapeVertices.clear ( );
 
 	UpdateBuffers ( );
@@ -294,8 +414,16 @@ void Scene::Destroy ( )
 {
 	glDeleteBuffers ( 1 , &vertexBufferPoints );
 	glDeleteBuffers ( 1 , &normalbuffer );
+	glDeleteBuffers ( 1 , &catmullVertexBuffer );
+	glDeleteBuffers ( 1 , &catmullIndexBuffer );
+	glDeleteBuffers ( 1 , &catmullOcclusionBuffer );
+	glDeleteBuffers ( 1 , &catmullLineBuffer );
 	glDeleteProgram ( program );
 	glDeleteVertexArrays ( 1 , &VertexArrayID );
+	glDeleteVertexArrays ( 1 , &voxelVertexArrayID );
+	glDeleteVertexArrays ( 1 , &originShapeVertexArrayID );
+	glDeleteVertexArrays ( 1 , &catMullVertexArrayID );
+	glDeleteVertexArrays ( 1 , &catMullLinesVertexArrayID );
 }
 
 void Scene::AddPointOriginShapeVertices ( Surface3D surf , glm::vec3 position )
@@ -317,12 +445,14 @@ void Scene::AddPointOriginShapeVertices ( Surface3D surf , glm::vec3 position )
 	UpdateBuffers ( );
 }
 
-void Scene::AddPointVertices ( Surface3D surf , glm::vec3 position )
+void Scene::AddPointVertices ( const Surface3D &surf , glm::vec3 position )
 {
-	for ( int i = 0; i < surf.get_Edges ( ).size ( ); ++i )
+	const std::vector<Edge3D*> &edges = surf.get_Edges ( );
+	vertices.reserve ( vertices.size ( ) + edges.size ( ) * 2 );
+	for ( size_t i = 0; i < edges.size ( ); ++i )
 	{
-		vertices.push_back ( surf.get_Edges ( ) [ i ]->get_A ( ) );
-		vertices.push_back ( surf.get_Edges ( ) [ i ]->get_B ( ) );
+		vertices.push_back ( edges [ i ]->get_A ( ) );
+		vertices.push_back ( edges [ i ]->get_B ( ) );
 	}
 	/*if ( !surf.get_Close ( ) )
 	{
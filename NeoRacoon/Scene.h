@@ -15,6 +15,9 @@
 #include "Surface3D.h"
 #include "BenTest.h"
 #include "Kobbelt.h"
+#include "VertexCache.h"
+#include "Meshlet.h"
+#include "MeshAO.h"
 
 enum CameraDirection {
 	forward,
@@ -36,14 +39,26 @@ private:
 	GLuint normalbuffer;
 	//Other Buffers
 	GLuint catmullVertexBuffer;
+	GLuint catmullIndexBuffer;
+	GLuint catmullOcclusionBuffer;
+	GLuint catmullLineBuffer;
 	GLuint originShapeVertexBuffer;
 
-	std::vector<glm::vec3> normals, positions, vertices, originShapeVertices, catmullVertices;
+	std::vector<glm::vec3> normals, positions, vertices, originShapeVertices;
+	RenderableMesh catmullMesh; //Drawn indexed, vertices and indices uploaded once
+	AOOptions catmullOcclusionOptions; //Ambient occlusion baked per vertex when the shape changes
+	VertexCacheStats catmullRawCacheStats, catmullCacheStats; //Before and after reordering
+	MeshletMesh catmullMeshlets; //Clusters culled on the CPU every frame
+	MonotonicArena subdivisionArenas[2]; //Levels of the subdivisions, blocks kept between shapes
+	std::vector<uint32_t> visibleMeshlets;
+	std::vector<GLsizei> drawCounts;
+	std::vector<const GLvoid*> drawOffsets;
 	std::vector<GLuint> indices;
 
 	//Shader References
 	GLuint program, ssaoProgram;
 	GLuint position_location, color_location, mvp_location, light_location;
+	GLint occlusion_location; //-1 when the shader does not read occlusion
 	GLuint MatrixID, VertexArrayID, LightID, ModelMatrixID, ViewMatrixID, deltaTimeID;
 
 	
@@ -52,6 +67,7 @@ private:
 	GLuint voxelVertexArrayID;
 	GLuint originShapeVertexArrayID;
 	GLuint catMullVertexArrayID;
+	GLuint catMullLinesVertexArrayID; //Same vertices, the unique edges as element buffer
 
 	float lastTime;
 	float currentTime;
@@ -98,6 +114,12 @@ public:
 	void TranslateCamera(glm::vec3 v);
 	void TranslateCamera(CameraDirection direction);
 	int getVertexCount();
+	const VertexCacheStats &getRawCacheStats() const { return catmullRawCacheStats; }
+	const VertexCacheStats &getCacheStats() const { return catmullCacheStats; }
+	size_t getClusterCount() const { return catmullMeshlets.meshlets.size(); }
+	size_t getVisibleClusterCount() const { return visibleMeshlets.size(); }
+	size_t getLineCount() const { return catmullMesh.lineIndexCount() / 2; }
+	MemoryReport getMeshMemoryUsage() const { return catmullMesh.memoryUsage(); }
 	void computeMatrixes(int winWidth, int winHeight, double xPos, double yPos);
 	void zoomFoV(float);
 
@@ -105,20 +127,22 @@ public:
 
 	void AddLine();
 
-	void AddOriginCornerCutPoints(std::vector<glm::vec3>);
+	void AddOriginCornerCutPoints(const std::vector<glm::vec3> &);
 
 	void AddCatMullShape(int iter);
 	void AddLoopShape(int iter);
 	void AddKobbeltShape(int iter);
+	void SetSubdividedShape(const RenderableMesh &mesh);
 	//Render Passes
 	void GeometryPass(); 
+	void DrawVisibleMeshlets();
 
 	float RandomFloat(float a, float b);
 	void resetScene();
 	void Destroy();
 
 
-	void AddPointVertices ( Surface3D surf , glm::vec3 position ); 
+	void AddPointVertices ( const Surface3D &surf , glm::vec3 position ); 
 	void Scene::AddPointOriginShapeVertices ( Surface3D surf , glm::vec3 position );
 };
 
@@ -1,4 +1,5 @@
 #include "SimpleCornerCutting.h"
+#include "MemoryStats.h"
 namespace SimpleCornerCutting
 {
 	Edge3D * eCutting ( Edge3D * e , float uRatio , float vRatio )
@@ -26,6 +27,7 @@ namespace SimpleCornerCutting
 		if ( uRatio + vRatio > 1 )
 			throw std::invalid_argument ( "uRatio + vRatio is higher than 1." );
 
+		AllocationScope scope ( "Corner cutting" );
 		std::vector<Edge3D*> edges = s->get_Edges ( );
 		std::vector<Edge3D*> intermediaireEdges;
 		Edge3D * e;
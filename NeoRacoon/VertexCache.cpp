@@ -0,0 +1,279 @@
+#include "VertexCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Parallel.h"
+
+
+vertexcache_internal::VertexTriangles vertexcache_internal::VertexCache_adjacency(const std::vector<uint32_t> &indices, size_t nb_vertices)
+{
+	VertexTriangles adj;
+	adj.offsets.assign(nb_vertices + 1, 0);
+	for (auto it = indices.begin(); it != indices.end(); ++it)
+		++adj.offsets[*it + 1];
+	for (size_t v = 0; v < nb_vertices; ++v)
+		adj.offsets[v + 1] += adj.offsets[v];
+
+	adj.triangles.resize(indices.size());
+	std::vector<uint32_t> fill(adj.offsets.begin(), adj.offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); ++i)
+		adj.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	return adj;
+}
+
+
+std::vector<uint32_t> vertexcache_internal::VertexCache_tipsify(const std::vector<uint32_t> &indices, size_t nb_vertices, unsigned int cache_size, std::vector<size_t> &cluster_starts)
+{
+	const size_t nb_triangles = indices.size() / 3;
+	const VertexTriangles adj = VertexCache_adjacency(indices, nb_vertices);
+
+	// Live triangle count and last cache insertion time of every vertex. Times
+	// start past cache_size so that no vertex is in the cache at first.
+	std::vector<uint32_t> live(nb_vertices);
+	for (size_t v = 0; v < nb_vertices; ++v)
+		live[v] = adj.offsets[v + 1] - adj.offsets[v];
+	std::vector<uint32_t> cache_time(nb_vertices, 0);
+	std::vector<char> emitted(nb_triangles, 0);
+	uint32_t time = cache_size + 1;
+
+	std::vector<uint32_t> dead_end, candidates, ret;
+	ret.reserve(indices.size());
+	cluster_starts.clear();
+
+	size_t cursor = 0;
+	while (cursor < nb_vertices && live[cursor] == 0)
+		++cursor;
+	int64_t fanning = cursor < nb_vertices ? static_cast<int64_t>(cursor) : -1;
+
+	while (fanning >= 0)
+	{
+		if (time - cache_time[fanning] > cache_size)
+			cluster_starts.push_back(ret.size() / 3);
+
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adj.offsets[fanning]; a < adj.offsets[fanning + 1]; ++a)
+		{
+			uint32_t t = adj.triangles[a];
+			if (emitted[t])
+				continue;
+
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[t * 3 + k];
+				ret.push_back(v);
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+				if (time - cache_time[v] > cache_size)
+					cache_time[v] = time++;
+			}
+			emitted[t] = 1;
+		}
+
+		// Next fanning vertex: the oldest candidate still in the cache once its
+		// own triangles are emitted, else a recent dead end, else the next live vertex
+		int64_t best = -1;
+		int64_t best_priority = -1;
+		for (auto it = candidates.begin(); it != candidates.end(); ++it)
+		{
+			if (live[*it] == 0)
+				continue;
+
+			int64_t priority = 0;
+			if (time - cache_time[*it] + 2 * live[*it] <= cache_size)
+				priority = time - cache_time[*it];
+			if (priority > best_priority)
+			{
+				best_priority = priority;
+				best = *it;
+			}
+		}
+
+		while (best < 0 && !dead_end.empty())
+		{
+			uint32_t v = dead_end.back();
+			dead_end.pop_back();
+			if (live[v] > 0)
+				best = v;
+		}
+
+		while (best < 0 && cursor < nb_vertices)
+		{
+			if (live[cursor] > 0)
+				best = static_cast<int64_t>(cursor);
+			else
+				++cursor;
+		}
+
+		fanning = best;
+	}
+
+	return ret;
+}
+
+
+std::vector<uint32_t> vertexcache_internal::VertexCache_read_indices(const RenderableMesh &mesh)
+{
+	if (mesh.hasWideIndices())
+		return mesh.indices32;
+	return std::vector<uint32_t>(mesh.indices.begin(), mesh.indices.end());
+}
+
+void vertexcache_internal::VertexCache_write_indices(RenderableMesh &mesh, const std::vector<uint32_t> &indices)
+{
+	if (mesh.hasWideIndices())
+		mesh.indices32 = indices;
+	else
+		mesh.indices.assign(indices.begin(), indices.end());
+}
+
+
+VertexCacheStats analyzeVertexCache(const RenderableMesh &mesh, unsigned int cache_size)
+{
+	VertexCacheStats stats;
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	const size_t nb_indices = mesh.indexCount();
+	stats.triangles = nb_indices / 3;
+
+	// A vertex is still in the FIFO while fewer than cache_size misses happened since it entered
+	std::vector<size_t> entered(nb_vertices, 0);
+	std::vector<char> seen(nb_vertices, 0);
+	for (size_t i = 0; i < nb_indices; ++i)
+	{
+		uint32_t v = mesh.getIndex(i);
+		if (!seen[v])
+		{
+			seen[v] = 1;
+			++stats.vertices;
+		}
+		else if (stats.transformed - entered[v] < cache_size)
+			continue;
+
+		entered[v] = stats.transformed++;
+	}
+
+	stats.acmr = stats.triangles ? static_cast<float>(stats.transformed) / stats.triangles : 0.0f;
+	stats.atvr = stats.vertices ? static_cast<float>(stats.transformed) / stats.vertices : 0.0f;
+	return stats;
+}
+
+
+void optimizeVertexCache(RenderableMesh &mesh, unsigned int cache_size, bool sort_clusters)
+{
+	using namespace vertexcache_internal;
+
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	std::vector<size_t> cluster_starts;
+	std::vector<uint32_t> indices = VertexCache_tipsify(VertexCache_read_indices(mesh), nb_vertices, cache_size, cluster_starts);
+
+	if (sort_clusters && cluster_starts.size() > 1)
+	{
+		const size_t nb_triangles = indices.size() / 3;
+		const size_t nb_clusters = cluster_starts.size();
+		cluster_starts.push_back(nb_triangles);
+
+		// Area weighted centroid and normal of every cluster
+		std::vector<glm::vec3> centroids(nb_clusters), normals(nb_clusters);
+		parallel::parallelFor(0, nb_clusters, [&](size_t first, size_t last, unsigned int)
+		{
+			for (size_t c = first; c < last; ++c)
+			{
+				glm::vec3 centroid(0.0f), normal(0.0f);
+				float area = 0.0f;
+				for (size_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t)
+				{
+					const float *a = &mesh.vertices[indices[t * 3] * 3];
+					const float *b = &mesh.vertices[indices[t * 3 + 1] * 3];
+					const float *d = &mesh.vertices[indices[t * 3 + 2] * 3];
+					glm::vec3 A(a[0], a[1], a[2]), B(b[0], b[1], b[2]), D(d[0], d[1], d[2]);
+					glm::vec3 n = glm::cross(B - A, D - A);
+					float l = glm::length(n);
+					centroid += (A + B + D) * (l / 3.0f);
+					normal += n;
+					area += l;
+				}
+				centroids[c] = area > 0.0f ? centroid / area : centroid;
+				normals[c] = normal;
+			}
+		}, 256);
+
+		glm::vec3 center(0.0f);
+		for (size_t c = 0; c < nb_clusters; ++c)
+			center += centroids[c];
+		center /= static_cast<float>(nb_clusters);
+
+		// Clusters facing away from the center are the likely occluders, draw them first
+		std::vector<float> keys(nb_clusters);
+		std::vector<size_t> order(nb_clusters);
+		for (size_t c = 0; c < nb_clusters; ++c)
+		{
+			float l = glm::length(normals[c]);
+			keys[c] = l > 0.0f ? glm::dot(centroids[c] - center, normals[c] / l) : 0.0f;
+			order[c] = c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(indices.size());
+		for (auto it = order.begin(); it != order.end(); ++it)
+			sorted.insert(sorted.end(), indices.begin() + cluster_starts[*it] * 3, indices.begin() + cluster_starts[*it + 1] * 3);
+		indices.swap(sorted);
+	}
+
+	VertexCache_write_indices(mesh, indices);
+}
+
+
+void optimizeVertexFetch(RenderableMesh &mesh)
+{
+	using namespace vertexcache_internal;
+
+	const size_t nb_vertices = mesh.vertices.size() / 3;
+	std::vector<uint32_t> indices = VertexCache_read_indices(mesh);
+
+	const uint32_t unused = static_cast<uint32_t>(-1);
+	std::vector<uint32_t> remap(nb_vertices, unused);
+	uint32_t next = 0;
+	for (auto it = indices.begin(); it != indices.end(); ++it)
+	{
+		if (remap[*it] == unused)
+			remap[*it] = next++;
+		*it = remap[*it];
+	}
+	for (size_t v = 0; v < nb_vertices; ++v)
+	{
+		if (remap[v] == unused)
+			remap[v] = next++;
+	}
+
+	const bool has_normals = mesh.normals.size() == mesh.vertices.size();
+	const bool has_occlusion = mesh.occlusion.size() == nb_vertices;
+	std::vector<float> vertices(mesh.vertices.size()), normals(has_normals ? mesh.normals.size() : 0), occlusion(has_occlusion ? nb_vertices : 0);
+	parallel::parallelFor(0, nb_vertices, [&](size_t first, size_t last, unsigned int)
+	{
+		for (size_t v = first; v < last; ++v)
+		{
+			std::copy(mesh.vertices.begin() + v * 3, mesh.vertices.begin() + v * 3 + 3, vertices.begin() + remap[v] * 3);
+			if (has_normals)
+				std::copy(mesh.normals.begin() + v * 3, mesh.normals.begin() + v * 3 + 3, normals.begin() + remap[v] * 3);
+			if (has_occlusion)
+				occlusion[remap[v]] = mesh.occlusion[v];
+		}
+	});
+
+	mesh.vertices.swap(vertices);
+	if (has_normals)
+		mesh.normals.swap(normals);
+	if (has_occlusion)
+		mesh.occlusion.swap(occlusion);
+	VertexCache_write_indices(mesh, indices);
+
+	// The wireframe references the same vertices, it only needs renumbering
+	for (auto it = mesh.lines.begin(); it != mesh.lines.end(); ++it)
+		*it = static_cast<uint16_t>(remap[*it]);
+	for (auto it = mesh.lines32.begin(); it != mesh.lines32.end(); ++it)
+		*it = remap[*it];
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "MeshUtils.h"
+
+
+// Index and vertex buffer reordering for the GPU caches, applied to a
+// RenderableMesh once getRenderableMesh has built its triangle list.
+
+struct VertexCacheStats
+{
+	size_t triangles;
+	size_t vertices; // vertices referenced by at least one triangle
+	size_t transformed; // cache misses of the simulated FIFO cache
+
+	float acmr; // average cache miss ratio, transformed / triangles (0.5 at best, 3 at worst)
+	float atvr; // average transformed vertex ratio, transformed / vertices (1 at best)
+
+	VertexCacheStats() : triangles(0), vertices(0), transformed(0), acmr(0), atvr(0) {}
+};
+
+
+namespace vertexcache_internal
+{
+	// Triangles using each vertex, as offsets + triangle ids.
+	struct VertexTriangles
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+	};
+
+	VertexTriangles VertexCache_adjacency(const std::vector<uint32_t> &indices, size_t nb_vertices);
+
+	// Tipsify ordering of the triangles; cluster_starts receives the positions in
+	// the returned order where the cache had nothing left to reuse.
+	std::vector<uint32_t> VertexCache_tipsify(const std::vector<uint32_t> &indices, size_t nb_vertices, unsigned int cache_size, std::vector<size_t> &cluster_starts);
+
+	std::vector<uint32_t> VertexCache_read_indices(const RenderableMesh &mesh);
+
+	void VertexCache_write_indices(RenderableMesh &mesh, const std::vector<uint32_t> &indices);
+}
+
+
+///<summary>
+///Simulates a FIFO post-transform cache of cache_size entries over the index buffer.
+///</summary>
+VertexCacheStats analyzeVertexCache(const RenderableMesh &mesh, unsigned int cache_size = 16);
+
+///<summary>
+///Reorders the triangles for the post-transform cache (Tipsify, linear time).
+///With sort_clusters, the runs of triangles Tipsify emits between two cache
+///flushes are then ordered outward facing first, which lowers overdraw for
+///little cost in cache misses.
+///</summary>
+void optimizeVertexCache(RenderableMesh &mesh, unsigned int cache_size = 16, bool sort_clusters = true);
+
+///<summary>
+///Renumbers the vertices in order of first use by the index buffer so vertex
+///fetches walk memory forward; normals, occlusion and lines, when present, follow. Unreferenced
+///vertices are kept at the end.
+///</summary>
+void optimizeVertexFetch(RenderableMesh &mesh);
@@ -1,5 +1,7 @@
 #include "Voxel.h"
 
+#include "MeshWeld.h"
+
 
 
 Voxel::Voxel()
@@ -160,38 +162,16 @@ void Voxel::SetPosition(glm::vec3 pos)
 
 void Voxel::ComputeIndices(int indicesSize)
 {
-	indices = std::vector<GLuint>();
-	std::vector<glm::vec3> out = std::vector<glm::vec3>();
-	bool found = false;
-	GLuint indexFound;
-	for (unsigned int i = 0; i < points.size(); i++)
-	{
-		for (unsigned int j = 0; j < out.size(); j++)
-		{
-			if (points[i] == out[j])
-			{
-				found = true;
-				indexFound = indices[j];
-				break;
-			}
-		}
-		if (found)
-		{
-			indices.push_back(indexFound + indicesSize);
-		}
-		else
-		{
-			out.push_back(points[i]);
-			indices.push_back(out.size()-1 + indicesSize);
-		}
-		found = false;
-	}
-	points.clear();
-	points = out;
+	std::vector<uint32_t> remap;
+	points = weldPoints(points, 0.0, remap);
 
+	indices = std::vector<GLuint>();
+	indices.reserve(remap.size());
+	for (unsigned int i = 0; i < remap.size(); i++)
+		indices.push_back(remap[i] + indicesSize);
 }
 
-std::vector<glm::vec3> Voxel::getPoints()
+const std::vector<glm::vec3> &Voxel::getPoints() const
 {
 	return points;
 }
@@ -201,7 +181,7 @@ std::vector<GLuint> Voxel::getIndices()
 	return indices;
 }
 
-std::vector<glm::vec3> Voxel::getNormals()
+const std::vector<glm::vec3> &Voxel::getNormals() const
 {
 	return normals;
 }
@@ -211,6 +191,16 @@ std::vector<float> Voxel::getOcclusionColors()
 	return occlusionColors; 
 }
 
+MemoryUsage Voxel::memoryUsage() const
+{
+	MemoryUsage ret = vectorMemory(points);
+	ret += vectorMemory(normals);
+	ret += vectorMemory(occlusionColors);
+	ret += vectorMemory(indices);
+	ret += vectorMemory(neighbours);
+	return ret;
+}
+
 void Voxel::setNeighbours()
 {
 }
@@ -5,6 +5,7 @@
 #include <gl3w\GL\gl3w.h>
 #include <glfw\include\GLFW\glfw3.h>
 #include "ShaderManager.h"
+#include "MemoryStats.h"
 #include <glm\glm\gtx\transform.hpp>
 
 class Voxel
@@ -29,11 +30,16 @@ public:
 
 	void SetPosition(glm::vec3 pos);
 	void ComputeIndices(int indicesSize);
-	std::vector<glm::vec3> getPoints();
+	const std::vector<glm::vec3> &getPoints() const;
 	std::vector<GLuint> getIndices();
-	std::vector<glm::vec3> getNormals();
+	const std::vector<glm::vec3> &getNormals() const;
 	std::vector<float> getOcclusionColors();
 
+	///<summary>
+	///Heap of the cube geometry, all parts summed.
+	///</summary>
+	MemoryUsage memoryUsage() const;
+
 	void setNeighbours();
 	std::vector<float> getNeighbours();
 
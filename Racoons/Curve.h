@@ -137,6 +137,9 @@ namespace FDMathCore
 			bool empty() const { return m_controlPoints.empty(); }
 			size_type size() const { return m_controlPoints.size(); }
 
+			// Bytes held by the curve, its control point storage included
+			size_type memoryUsage() const { return sizeof(*this) + m_controlPoints.capacity() * sizeof(point_type); }
+
 #pragma endregion
 
 #pragma region Modifiers
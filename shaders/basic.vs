@@ -1,6 +1,8 @@
 #version 330 core
 
-attribute vec3 vertexPosition_modelspace;
+// Fixed locations, Scene feeds the arrays by these indices
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in float vertexOcclusion; // baked ambient occlusion, 1 when fully lit
 
 uniform mat4 MVP;
 uniform vec4 vertexColor;
@@ -10,5 +12,5 @@ out vec4 fragmentColor;
 void main()
 {
     gl_Position = MVP * vec4(vertexPosition_modelspace, 1.0);
-    fragmentColor = vertexColor;
+    fragmentColor = vec4(vertexColor.rgb * vertexOcclusion, vertexColor.a);
 }
\ No newline at end of file